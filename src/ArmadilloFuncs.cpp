@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 #include <cmath>
+#include <cfloat>
 
 #include <armadillo>
 
@@ -18,18 +19,88 @@
 #include "stats.h"
 
 #include "ArmadilloFuncs.h"
+#include "MatrixIO.h"
 #include "Insilico.h"
 
 using namespace arma;
 using namespace std;
 
 // differential coexpression
-bool armaDcgain(mat& zvals, mat& pvals, bool computeDiagonal) {
+
+// two-sided normal p-value of |Z|: normdist(-|Z|) without branches so the
+// kernel loop vectorizes
+static inline double twoSidedNormalP(double absZ) {
+  return 2 * normdistTail(absZ);
+}
+
+template <typename eT>
+static bool dcgainKernel(const mat& corX, const mat& corY, double nX, 
+                         double nY, Mat<eT>& zvals, Mat<eT>& pvals, 
+                         uint& nanCount, uint& infinityCount, 
+                         uint& totalTests) {
+  uword numVars = corX.n_rows;
+  if((corY.n_rows != numVars) || (nX < 4) || (nY < 4)) {
+    return false;
+  }
+  double se = sqrt(1.0 / (nX - 3.0) + 1.0 / (nY - 3.0));
+  zvals.zeros(numVars, numVars);
+  pvals.ones(numVars, numVars);
+  uint nans = 0;
+  uint infs = 0;
+  uint tests = 0;
+  // upper triangle column j is contiguous in rows 0..j-1; blocks of columns
+  // are balanced by dynamic scheduling
+  #pragma omp parallel for schedule(dynamic, 16) reduction(+:nans,infs,tests)
+  for(uword j=1; j < numVars; ++j) {
+    const double* rX = corX.colptr(j);
+    const double* rY = corY.colptr(j);
+    eT* zCol = zvals.colptr(j);
+    eT* pCol = pvals.colptr(j);
+    #pragma omp simd reduction(+:nans,infs,tests)
+    for(uword i=0; i < j; ++i) {
+      double r_ij_1 = rX[i];
+      double r_ij_2 = rY[i];
+      // perfect correlations are skipped, as before
+      bool perfect = (r_ij_1 == 1) || (r_ij_2 == 1);
+      double z_ij_1 = 0.5 * log(fabs((1 + r_ij_1) / (1 - r_ij_1)));
+      double z_ij_2 = 0.5 * log(fabs((1 + r_ij_2) / (1 - r_ij_2)));
+      double Z_ij = fabs(z_ij_1 - z_ij_2) / se;
+      bool isNan = !perfect && (Z_ij != Z_ij);
+      bool isInf = !perfect && !isNan && (Z_ij > DBL_MAX);
+      bool good = !perfect && !isNan && !isInf;
+      nans += isNan;
+      infs += isInf;
+      tests += !perfect;
+      zCol[i] = good? (eT) Z_ij: (eT) 0;
+      pCol[i] = good? (eT) twoSidedNormalP(Z_ij): (eT) 1;
+    }
+  }
+  zvals = symmatu(zvals);
+  pvals = symmatu(pvals);
+  nanCount = nans;
+  infinityCount = infs;
+  totalTests = tests;
+
+  return true;
+}
+
+bool armaDcgainZ(const mat& corX, const mat& corY, double nX, double nY,
+                 mat& zvals, mat& pvals, uint& nanCount, 
+                 uint& infinityCount, uint& totalTests) {
+  return dcgainKernel(corX, corY, nX, nY, zvals, pvals, 
+                      nanCount, infinityCount, totalTests);
+}
+
+bool armaDcgainZ(const mat& corX, const mat& corY, double nX, double nY,
+                 fmat& zvals, fmat& pvals, uint& nanCount, 
+                 uint& infinityCount, uint& totalTests) {
+  return dcgainKernel(corX, corY, nX, nY, zvals, pvals, 
+                      nanCount, infinityCount, totalTests);
+}
+
+template <typename eT>
+static bool dcgain(Mat<eT>& zvals, Mat<eT>& pvals, bool computeDiagonal) {
   // only works on 'numeric' data types added to PLINK by inbix
-//  if(PP->nl_all) {
-//    PP->printLOG("ERROR: armaDcgain requires 'numeric' attributes only\n");
-//    return false;
-//  }
   // phenotypes
   uint nAff = 0;
   uint nUnaff = 0;
@@ -51,64 +122,26 @@ bool armaDcgain(mat& zvals, mat& pvals, bool computeDiagonal) {
   PP->printLOG(Timestamp() + "Performing z-tests with " + dbl2str(df) + " degrees of freedom\n");
   PP->printLOG(Timestamp() + "NOTE: all main effect (matrix diagonal) p-values are set to 1.\n");
   uint numVars = PP->nlistname.size();
-  bool readyToRun = true;
-  uint infinityCount = 0;
-  uint nanCount = 0;
-  uint totalTests = 0;
   if(computeDiagonal) {
     PP->printLOG(Timestamp() + "Performing Z-tests for zVals and pVals matrix diagonals\n");
   } else {
     PP->printLOG(Timestamp() + "Setting matrix diagonals zVals to 0.0 and pVals to 1.0\n");
   }
-  // main effects loop
-  #pragma omp parallel for
-  for(uint i=0; i < numVars; ++i) {
-    // t-test for diagonals?
-    // double t;
-    // tTest(i, t);
-    // double p = pT(t, df);
-    // zvals(i, i) = t;
-    double z = 0.0;
-    double p = 1.0;
-    if(computeDiagonal) {
-      if(!zTest(i, z)) {
-        error("Z-test failed for variable index [ " + int2str(i) + " ]");
-      }
-    }
-    double newZ = 0.0;
-    double newP = 1.0;
-    if(std::isnan(z)) {
-      ++nanCount;
-    } else {
-      if(std::isinf(z)) {
-        ++infinityCount;
-      } else {
-        newZ = z;
-        newP = p;
-      }
-    }
-    #pragma omp critical
-    {
-      zvals(i, i) = z;
-      pvals(i, i) = p;
-      ++totalTests;
-    }
-  }
   // z-test for off-diagonal elements
   PP->printLOG(Timestamp() + "Computing coexpression and correlation for CASES and CONTROLS.\n");
   mat X;
   mat Y;
   if(!armaGetPlinkNumericToMatrixCaseControl(X, Y)) {
     PP->printLOG(Timestamp() + "WARNING: Cannot read numeric data into case-control matrices");
-    readyToRun = false;
+    return false;
   }
   if(!X.is_finite()) {
     PP->printLOG(Timestamp() + "WARNING: armaGetPlinkNumericToMatrixCaseControl(X, Y) matrix X is not finite\n");
-    readyToRun = false;
+    return false;
   }
   if(!Y.is_finite()) {
     PP->printLOG(Timestamp() + "WARNING: armaGetPlinkNumericToMatrixCaseControl(X, Y) matrix Y is not finite");
-    readyToRun = false;
+    return false;
   }
   if(par::algorithm_verbose) {
     cout << "X: " << X.n_rows << " x " << X.n_cols << endl;
@@ -116,38 +149,16 @@ bool armaDcgain(mat& zvals, mat& pvals, bool computeDiagonal) {
     cout << "X" << endl << X.submat(0,0,4,4) << endl;
     cout << "Y" << endl << Y.submat(0,0,4,4) << endl;
   }
-  // compute covariances/correlations
-  mat covMatrixX;
-  mat corMatrixX;
-  if(readyToRun && !armaComputeCovariance(X, covMatrixX, corMatrixX)) {
-    PP->printLOG(Timestamp() + "WARNING: Could not compute coexpression matrix for cases\n");
-    readyToRun = false;
-  }
-  if(readyToRun && !covMatrixX.is_finite()) {
-    PP->printLOG(Timestamp() + "WARNING: armaComputeCovariance(X, covMatrixX, corMatrixX) covMatrixX matrix is not finite");
-    readyToRun = false;
-  }
-  if(readyToRun && !corMatrixX.is_finite()) {
-    PP->printLOG(Timestamp() + "WARNING: armaComputeCovariance(X, corMatrixX, corMatrixX) corMatrixX matrix is not finite");
-    readyToRun = false;
-  }
-  mat covMatrixY;
-  mat corMatrixY;
-  if(readyToRun && !armaComputeCovariance(Y, covMatrixY, corMatrixY)) {
-    PP->printLOG(Timestamp() + "WARNING: Could not compute coexpression matrix for controls");
-    readyToRun = false;
-  }
-  if(readyToRun && !covMatrixY.is_finite()) {
-    PP->printLOG(Timestamp() + "WARNING: armaComputeCovariance(Y, covMatrixY, corMatrixY) covMatrixX matrix is not finite");
-    readyToRun = false;
-  }
-  if(readyToRun && !corMatrixY.is_finite()) {
-    PP->printLOG(Timestamp() + "WARNING: armaComputeCovariance(Y, covMatrixY, corMatrixY) corMatrixX matrix is not finite");
-    readyToRun = false;
+  // compute correlations, one GEMM per group
+  mat corMatrixX = cor(X);
+  if(!corMatrixX.is_finite()) {
+    PP->printLOG(Timestamp() + "WARNING: correlation matrix for cases is not finite\n");
+    return false;
   }
-  // are all the prerequisites satisfied?
-  if(!readyToRun) {
-    return readyToRun;
+  mat corMatrixY = cor(Y);
+  if(!corMatrixY.is_finite()) {
+    PP->printLOG(Timestamp() + "WARNING: correlation matrix for controls is not finite\n");
+    return false;
   }
   // DEBUG
   if(par::algorithm_verbose) {
@@ -158,39 +169,38 @@ bool armaDcgain(mat& zvals, mat& pvals, bool computeDiagonal) {
 
   // algorithm ported from the R script z_test.R
   PP->printLOG(Timestamp() + "Performing Z-tests for interactions\n");
-  #pragma omp parallel for
+  uint infinityCount = 0;
+  uint nanCount = 0;
+  uint totalTests = 0;
+  if(!dcgainKernel(corMatrixX, corMatrixY, nAff, nUnaff, zvals, pvals,
+                   nanCount, infinityCount, totalTests)) {
+    return false;
+  }
+  // main effects
+  uint diagNanCount = 0;
+  uint diagInfinityCount = 0;
+  #pragma omp parallel for reduction(+:diagNanCount,diagInfinityCount)
   for(uint i=0; i < numVars; ++i) {
-    for(uint j=i + 1; j < numVars; ++j) {
-      double r_ij_1 = corMatrixX(i, j);
-      double r_ij_2 = corMatrixY(i, j);
-      if((r_ij_1 == 1) || (r_ij_2 == 1)) {
-        continue;
+    double z = 0.0;
+    if(computeDiagonal) {
+      if(!zTest(i, z)) {
+        #pragma omp critical
+        error("Z-test failed for variable index [ " + int2str(i) + " ]");
       }
-      double z_ij_1 = 0.5 * log((abs((1 + r_ij_1) / (1 - r_ij_1))));
-      double z_ij_2 = 0.5 * log((abs((1 + r_ij_2) / (1 - r_ij_2))));
-      double Z_ij = abs(z_ij_1 - z_ij_2) / sqrt((1.0 / (nAff - 3.0) + 1.0 / (nUnaff - 3.0)));
-      double p = 2 * normdist(-abs(Z_ij)); 
-      double newZ = 0.0;
-      double newP = 1.0;
-      if(std::isinf(Z_ij)) {
-        ++infinityCount;
-      } else {
-        if(std::isnan(Z_ij)) {
-          ++nanCount;
-        } else {
-          newZ = Z_ij;
-          newP = p;
-        }
+    }
+    if(std::isnan(z)) {
+      ++diagNanCount;
+    } else {
+      if(std::isinf(z)) {
+        ++diagInfinityCount;
       }
-      #pragma omp critical
-      {
-        // update shared memory variables
-        zvals(i, j) = zvals(j, i) = newZ;
-        pvals(i, j) = pvals(j, i) = newP;
-        ++totalTests;
-      } // OpenMP critical section
-    } // numvars inner loop
-  } // numvars outer loop - end OpenMP for loop
+    }
+    zvals(i, i) = z;
+    pvals(i, i) = 1.0;
+  }
+  totalTests += numVars;
+  nanCount += diagNanCount;
+  infinityCount += diagInfinityCount;
   PP->printLOG(Timestamp() + int2str(totalTests) + " tests performed\n");
   bool returnValue = true;
   if(returnValue && infinityCount) {
@@ -202,17 +212,136 @@ bool armaDcgain(mat& zvals, mat& pvals, bool computeDiagonal) {
     returnValue = false;
   }
   if(returnValue && !zvals.is_finite()) {
-    PP->printLOG(Timestamp() + "ERROR(S): armaComputeCovariance(Y, covMatrixY, corMatrixY) covMatrixX matrix is not finite\n");
+    PP->printLOG(Timestamp() + "ERROR(S): dcGAIN Z matrix is not finite\n");
     returnValue = false;
   }
   if(returnValue && !pvals.is_finite()) {
-    PP->printLOG(Timestamp() + "ERROR(S): armaComputeCovariance(Y, covMatrixY, corMatrixY) corMatrixX matrix is not finite\n");
+    PP->printLOG(Timestamp() + "ERROR(S): dcGAIN p-value matrix is not finite\n");
     returnValue = false;
   }
 
   return returnValue;
 }
 
+bool armaDcgain(mat& zvals, mat& pvals, bool computeDiagonal) {
+  return dcgain(zvals, pvals, computeDiagonal);
+}
+
+bool armaDcgain(fmat& zvals, fmat& pvals, bool computeDiagonal) {
+  return dcgain(zvals, pvals, computeDiagonal);
+}
+
+bool armaDmgain(sp_mat& results, mat& pvals) {
+  uint nAff = 0;
+  uint nUnaff = 0;
+  for(uint i=0; i < PP->sample.size(); i++) {
+    if(PP->sample[i]->aff) {
+      ++nAff;
+    }
+    else {
+      ++nUnaff;
+    }
+  }
+  if((nAff < 4) || (nUnaff < 4)) {
+    PP->printLOG(Timestamp() + "WARNING: dmGAIN requires at least 4 individuals in each phenotype group\n");
+    return false;
+  }
+  uint numVars = PP->nlistname.size();
+  PP->printLOG(Timestamp() + "Performing z-tests\n");
+  vec diagZ(numVars);
+  #pragma omp parallel for
+  for(uint i=0; i < numVars; ++i) {
+    double z = 0.0;
+    zTest(i, z);
+    diagZ(i) = z;
+  }
+
+  PP->printLOG(Timestamp() + "Computing coexpression for CASES and CONTROLS.\n");
+  mat X;
+  mat Y;
+  if(!armaGetPlinkNumericToMatrixCaseControl(X, Y)) {
+    PP->printLOG(Timestamp() + "WARNING: Cannot read numeric data into case-control matrices\n");
+    return false;
+  }
+  // algorithm from R script z_test.R, modified by bam email 7/29/14:
+  // modularity-adjusted coexpression corr - k_i k_j / 2m of each group
+  mat Z = cor(X);
+  vec k_1 = sum(Z, 1);
+  Z -= (k_1 * k_1.t()) / accu(k_1);
+  mat zY = cor(Y);
+  vec k_2 = sum(zY, 1);
+  zY -= (k_2 * k_2.t()) / accu(k_2);
+  Z -= zY;
+  zY.reset();
+  Z = abs(Z) / sqrt(1.0 / (nAff - 3.0) + 1.0 / (nUnaff - 3.0));
+
+  PP->printLOG(Timestamp() + "Performing Z-tests for interactions\n");
+  pvals.ones(numVars, numVars);
+  // each thread owns whole columns; the kept entries of every column are
+  // joined into the sparse matrix in one batch
+  vector<vector<uword> > colRows(numVars);
+  vector<vector<double> > colValues(numVars);
+  #pragma omp parallel for schedule(dynamic, 16)
+  for(uint j=0; j < numVars; ++j) {
+    for(uint i=0; i < numVars; ++i) {
+      double z = diagZ(i);
+      double p = 1.0;
+      if(i != j) {
+        z = Z(i, j);
+        p = 2 * normdist(-z);
+        pvals(i, j) = p;
+      }
+      if(par::do_regain_pvalue_threshold && (p > par::regainPvalueThreshold)) {
+        continue;
+      }
+      if(par::do_dmgain_abs) {
+        z = abs(z);
+      }
+      if(z != 0) {
+        colRows[j].push_back(i);
+        colValues[j].push_back(z);
+      }
+    }
+  }
+  uword numNonZero = 0;
+  for(uint j=0; j < numVars; ++j) {
+    numNonZero += colRows[j].size();
+  }
+  umat locations(2, numNonZero);
+  vec values(numNonZero);
+  uword k = 0;
+  for(uint j=0; j < numVars; ++j) {
+    for(uint r=0; r < colRows[j].size(); ++r, ++k) {
+      locations(0, k) = colRows[j][r];
+      locations(1, k) = j;
+      values(k) = colValues[j][r];
+    }
+    vector<uword>().swap(colRows[j]);
+    vector<double>().swap(colValues[j]);
+  }
+  // locations are already in column-major order
+  results = sp_mat(locations, values, numVars, numVars, false, false);
+  PP->printLOG(Timestamp() + int2str(numNonZero) + " non-zero dmGAIN values\n");
+
+  return true;
+}
+
+bool armaDifferentialCorrelationZ(const mat& X, const mat& Y, mat& Z) {
+  if((X.n_cols != Y.n_cols) || (X.n_rows < 4) || (Y.n_rows < 4)) {
+    return false;
+  }
+  double se = sqrt(1.0 / (X.n_rows - 3.0) + 1.0 / (Y.n_rows - 3.0));
+  // Fisher z transforms computed in place to keep one extra n x n matrix
+  Z = cor(X);
+  Z = 0.5 * log(abs((1 + Z) / (1 - Z)));
+  mat zY = cor(Y);
+  zY = 0.5 * log(abs((1 + zY) / (1 - zY)));
+  Z -= zY;
+  Z = abs(Z) / se;
+
+  return true;
+}
+
 bool armaComputeCovariance(mat X, mat& covMatrix, mat& corMatrix) {
 
 //  bcw R implementation:
@@ -353,86 +482,36 @@ bool armaReadMatrix(string mFilename, mat& m, vector<string>& variableNames) {
   return true;
 }
 
-bool armaWriteMatrix(mat& m, string mFilename, vector_s variableNames) {
+template <typename MatrixType>
+static bool writeMatrix(const MatrixType& m, string mFilename, 
+                        vector_s& variableNames) {
+  if(par::matrix_binary) {
+    string binaryFilename = mFilename + ".bmat";
+    PP->printLOG(Timestamp() + "Writing binary matrix [ " + binaryFilename + " ]\n");
+    if(!armaWriteBinaryMatrix(m, binaryFilename, variableNames,
+                              matrixBinaryFlags())) {
+      error("armaWriteMatrix failed");
+    }
+    return true;
+  }
   PP->printLOG(Timestamp() + "Writing matrix [ " + mFilename + " ]\n");
-  ofstream outFile(mFilename);
-  if(outFile.fail()) {
+  if(!armaWriteTextMatrix(m, mFilename, variableNames)) {
     error("armaWriteMatrix failed");
-    //return false;
   }
-  // outFile.precision(6);
-  // outFile.fixed;
-
-  // write the variables header
-  uint hIdx = 0;
-  for(vector_s::const_iterator hIt = variableNames.begin();
-          hIt != variableNames.end(); ++hIt, ++hIdx) {
-    if(hIdx) {
-      outFile << "\t" << *hIt;
-    }
-    else {
-      outFile << *hIt;
-    }
-  }
-  outFile << endl;
-
-  // write the matrix
-  for(uint i=0; i < m.n_rows; ++i) {
-    for(uint j=0; j < m.n_cols; ++j) {
-      if(j) {
-        outFile << "\t" << m(i, j);
-      }
-      else {
-        outFile << m(i, j);
-      }
-    }
-    outFile << endl;
-  }
-  
-  outFile.close();
 
 	return true;
 }
 
-bool armaWriteSparseMatrix(sp_mat& m, string mFilename, vector_s variableNames) {
-  PP->printLOG("Writing matrix [ " + mFilename + " ]\n");
-  ofstream outFile(mFilename);
-  if(outFile.fail()) {
-    error("armaWriteSparseMatrix failed");
-    // return false;
-  }
-  // outFile.precision(6);
-  // outFile.fixed;
-
-  // write the variables header
-  uint hIdx = 0;
-  for(vector_s::const_iterator hIt = variableNames.begin();
-          hIt != variableNames.end(); ++hIt, ++hIdx) {
-    if(hIdx) {
-      outFile << "\t" << *hIt;
-    }
-    else {
-      outFile << *hIt;
-    }
-  }
-  outFile << endl;
+bool armaWriteMatrix(mat& m, string mFilename, vector_s variableNames) {
+  return writeMatrix(m, mFilename, variableNames);
+}
 
-  // write the matrix
-  for(uint i=0; i < m.n_rows; ++i) {
-    for(uint j=0; j < m.n_cols; ++j) {
-      if(j) {
-        outFile << "\t" << m(i, j);
-      }
-      else {
-        outFile << m(i, j);
-      }
-    }
-    outFile << endl;
-  }
-  
-  outFile.close();
+bool armaWriteMatrix(fmat& m, string mFilename, vector_s variableNames) {
+  return writeMatrix(m, mFilename, variableNames);
+}
 
-	return true;
+bool armaWriteSparseMatrix(sp_mat& m, string mFilename, vector_s variableNames) {
+  return writeMatrix(m, mFilename, variableNames);
 }
 
 bool armaGetPlinkNumericToMatrixAll(mat& X) {
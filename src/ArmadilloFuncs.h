@@ -23,6 +23,8 @@ bool armaReadMatrix(std::string mFilename, arma::mat& m,
 // write an Armadillo matrix to a tab-delimited text file
 bool armaWriteMatrix(arma::mat& m, std::string mFilename, 
 				std::vector<std::string> variableNames);
+bool armaWriteMatrix(arma::fmat& m, std::string mFilename, 
+				std::vector<std::string> variableNames);
 bool armaWriteSparseMatrix(arma::sp_mat& m, std::string mFilename, 
 				std::vector<std::string> variableNames);
 
@@ -30,8 +32,28 @@ bool armaWriteSparseMatrix(arma::sp_mat& m, std::string mFilename,
 bool armaGetPlinkNumericToMatrixAll(arma::mat& X);
 bool armaGetPlinkNumericToMatrixCaseControl(arma::mat& X, arma::mat& Y);
 
+// differential correlation Z = |fisherZ(cor(X)) - fisherZ(cor(Y))| / se for
+// all pairs of columns, from one correlation GEMM per group
+bool armaDifferentialCorrelationZ(const arma::mat& X, const arma::mat& Y, 
+				arma::mat& Z);
+
 // sparse matrix is experimental!
 bool armaDcgain(arma::mat& zvals, arma::mat& pvals, bool computeDiagonal=false);
+// single precision results for large variable sets
+bool armaDcgain(arma::fmat& zvals, arma::fmat& pvals, bool computeDiagonal=false);
+// dcGAIN kernel: Z and two-sided p for all pairs from the case and control
+// correlation matrices of nX and nY samples, in one pass over the upper
+// triangle; counts NaN and infinite Z
+bool armaDcgainZ(const arma::mat& corX, const arma::mat& corY, double nX, 
+				double nY, arma::mat& zvals, arma::mat& pvals, unsigned int& nanCount, 
+				unsigned int& infinityCount, unsigned int& totalTests);
+bool armaDcgainZ(const arma::mat& corX, const arma::mat& corY, double nX, 
+				double nY, arma::fmat& zvals, arma::fmat& pvals, unsigned int& nanCount, 
+				unsigned int& infinityCount, unsigned int& totalTests);
 // bool armaDcgainSparse(arma::sp_mat& zvals, arma::mat& pvals, bool computeDiagonal=false);
 
+// differential modularity: Z of the modularity-adjusted coexpression
+// corr - k_i k_j / 2m between cases and controls, diagonal from z-tests
+bool armaDmgain(arma::sp_mat& results, arma::mat& pvals);
+
 #endif	/* ARMADILLOFUNCS_H */
@@ -0,0 +1,61 @@
+/*==============================================================================
+ *
+ * Filename:  BoundedQueue.h
+ *
+ * Description:  Blocking producer/consumer queue with a fixed capacity, used
+ * between pipeline stages so a fast producer cannot buffer unbounded results.
+ * =============================================================================
+ */
+
+#ifndef __BOUNDED_QUEUE_H__
+#define __BOUNDED_QUEUE_H__
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+template <class T>
+class BoundedQueue {
+public:
+  explicit BoundedQueue(size_t maxItems): capacity(maxItems? maxItems: 1),
+    closed(false) {}
+  // blocks while the queue is full; false if the queue was closed
+  bool push(const T& item) {
+    std::unique_lock<std::mutex> guard(lock);
+    notFull.wait(guard, [this] { return closed || (items.size() < capacity); });
+    if(closed) {
+      return false;
+    }
+    items.push_back(item);
+    notEmpty.notify_one();
+    return true;
+  }
+  // blocks while the queue is empty; false once closed and drained
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> guard(lock);
+    notEmpty.wait(guard, [this] { return closed || !items.empty(); });
+    if(items.empty()) {
+      return false;
+    }
+    item = items.front();
+    items.pop_front();
+    notFull.notify_one();
+    return true;
+  }
+  // no more items; consumers drain what is queued
+  void close() {
+    std::lock_guard<std::mutex> guard(lock);
+    closed = true;
+    notFull.notify_all();
+    notEmpty.notify_all();
+  }
+private:
+  std::deque<T> items;
+  size_t capacity;
+  bool closed;
+  std::mutex lock;
+  std::condition_variable notFull;
+  std::condition_variable notEmpty;
+};
+
+#endif
@@ -11,21 +11,274 @@
 #include <limits>
 #include <ios>
 #include <float.h>
+#include <ctime>
+#include <stdint.h>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+
+#include <omp.h>
 
 #include <armadillo>
 
 #include "plink.h"
+#include "options.h"
 #include "stats.h"
 #include "helper.h"
 
 #include "StringUtils.h"
 #include "CentralityRanker.h"
+#include "MatrixIO.h"
 #include "Insilico.h"
 
 using namespace std;
 using namespace arma;
 using namespace insilico;
 
+// ------------------ P O W E R   M E T H O D --------------------------------
+
+// T = gamma * G * D + e * diag_T_nz / Gtrace, Markov chain transition
+// matrix, is never formed: D is the diagonal of 1/colsum (zero when
+// d_j = 0), so each iteration computes
+// T * r = gamma * G * (r ./ colsum) + (diag_T_nz * r) * e / Gtrace
+static void transitionTerms(const mat& mainEffects, const rowvec& degrees,
+		double trace, double gamma, vec& invColsum, vec& diag_T_nz)
+{
+	uword n = degrees.n_elem;
+	invColsum.set_size(n);
+	diag_T_nz.set_size(n);
+#pragma omp parallel for
+	for(uword i=0; i < n; ++i) {
+		invColsum(i) = (degrees(i) != 0)? (1.0 / degrees(i)): 0.0;
+		if(mainEffects(i) != 0) {
+			// (C) for non-zero diag elements, gives (1-gamma)gii/n,
+			// which supercedes (A) and (B)
+			diag_T_nz(i) = (1 - gamma) * mainEffects(i) / n;
+		}
+		else if(degrees(i) != 0) {
+			// (B) if row degree is non-0, gives (1-gamma)/n
+			diag_T_nz(i) = (1 - gamma) / n;
+		}
+		else {
+			// (A) if row degree is 0, this will give 1/n gives more charity
+			// if no incoming connections
+			diag_T_nz(i) = 1.0 / n;
+		}
+	}
+	if(trace != 0.0) {
+		diag_T_nz /= trace;
+	}
+}
+
+// compressed sparse columns, as in arma::sp_mat
+struct RankNetwork {
+	const uword* colPtrs;
+	const uword* rowIndices;
+	const double* values;
+};
+
+static RankNetwork networkColumns(const sp_mat& G)
+{
+	RankNetwork columns = {G.col_ptrs, G.row_indices, G.values};
+	return columns;
+}
+
+// iterate r = T * r / sum(T * r) from the given r; sparse G must be symmetric
+static bool iteratePowerMethod(const RankNetwork* sparseG, const mat& denseG,
+		const vec& invColsum, const vec& diag_T_nz, double gamma, vec& r,
+		int& iterations, double& residual)
+{
+	uword n = r.n_elem;
+	vec scaled(n);
+	vec next(n);
+	// r sums to 1, so the L1 change between iterations is a relative
+	// residual whatever the number of variables
+	bool converged = false;
+	iterations = 0;
+	residual = 0.0;
+	while(!converged && (iterations < par::ranker_max_iterations)) {
+		++iterations;
+		scaled = r % invColsum;
+		double charity = dot(diag_T_nz, r);
+		if(sparseG) {
+			// G is symmetric, so row i of G is read as column i
+			const uword* colPtrs = sparseG->colPtrs;
+			const uword* rowIndices = sparseG->rowIndices;
+			const double* values = sparseG->values;
+#pragma omp parallel for schedule(dynamic, 256)
+			for(uword i=0; i < n; ++i) {
+				double rowTotal = 0;
+				for(uword k=colPtrs[i]; k < colPtrs[i + 1]; ++k) {
+					rowTotal += values[k] * scaled(rowIndices[k]);
+				}
+				next(i) = gamma * rowTotal + charity;
+			}
+		}
+		else {
+			next = gamma * (denseG * scaled) + charity;
+		}
+
+		// normalize eigenvector r so sum(r) == 1
+		next /= accu(next);
+		residual = accu(abs(next - r));
+		r.swap(next);
+		converged = residual < par::ranker_tolerance;
+	}
+
+	return converged;
+}
+
+// ------------------ P E R M U T A T I O N S --------------------------------
+
+// rewiring attempts per edge for the degree-preserving null
+static const unsigned int REWIRE_SWAPS_PER_EDGE = 10;
+// fewer successful swaps per edge than this leave a rewired network close
+// to the observed one
+static const unsigned int REWIRE_MIN_SWAPS_PER_EDGE = 1;
+
+enum RankNull { REWIRE_NULL, WEIGHT_NULL, LABEL_NULL };
+
+struct RankEdge {
+	uword a;
+	uword b;
+	double w;
+};
+
+static uint64_t edgeKey(uword a, uword b, uword n)
+{
+	return (a < b)? ((uint64_t) a * n + b): ((uint64_t) b * n + a);
+}
+
+// a thread's permuted network, reused by all of its permutations
+struct PermutationBuffers {
+	vector<RankEdge> edges;
+	unordered_set<uint64_t> present;
+	vector<uword> colPtrs;
+	vector<uword> nextInColumn;
+	vector<uword> rowIndices;
+	vector<double> values;
+	rowvec degrees;
+};
+
+// swap endpoints of random edge pairs, (a,b),(c,d) -> (a,d),(c,b), keeping
+// every node's number of interactions; weights move with the edges; returns
+// the number of swaps made
+static size_t rewireEdges(vector<RankEdge>& edges,
+		unordered_set<uint64_t>& present, uword n, mt19937& rng)
+{
+	if(edges.size() < 2) {
+		return 0;
+	}
+	present.clear();
+	present.reserve(2 * edges.size());
+	for(size_t e=0; e < edges.size(); ++e) {
+		present.insert(edgeKey(edges[e].a, edges[e].b, n));
+	}
+	uniform_int_distribution<size_t> pickEdge(0, edges.size() - 1);
+	size_t numSwaps = REWIRE_SWAPS_PER_EDGE * edges.size();
+	size_t numSwapped = 0;
+	for(size_t swap=0; swap < numSwaps; ++swap) {
+		RankEdge& first = edges[pickEdge(rng)];
+		RankEdge& second = edges[pickEdge(rng)];
+		if(&first == &second) {
+			continue;
+		}
+		uword c = second.a;
+		uword d = second.b;
+		if(rng() & 1) {
+			std::swap(c, d);
+		}
+		if((first.a == d) || (c == first.b)) {
+			continue;
+		}
+		uint64_t firstKey = edgeKey(first.a, d, n);
+		uint64_t secondKey = edgeKey(c, first.b, n);
+		if((firstKey == secondKey) || present.count(firstKey) || 
+			 present.count(secondKey)) {
+			continue;
+		}
+		present.erase(edgeKey(first.a, first.b, n));
+		present.erase(edgeKey(second.a, second.b, n));
+		present.insert(firstKey);
+		present.insert(secondKey);
+		uword b = first.b;
+		first.b = d;
+		second.a = c;
+		second.b = b;
+		++numSwapped;
+	}
+
+	return numSwapped;
+}
+
+// shuffle the weights among the observed interactions; the topology, and so
+// every node's number of interactions, is unchanged
+static void shuffleWeights(vector<RankEdge>& edges, mt19937& rng)
+{
+	for(size_t e=edges.size(); e > 1; --e) {
+		uniform_int_distribution<size_t> pickEdge(0, e - 1);
+		std::swap(edges[e - 1].w, edges[pickEdge(rng)].w);
+	}
+}
+
+// move the interactions to randomly relabeled nodes; main effects stay
+static void relabelEdges(vector<RankEdge>& edges, uword n, mt19937& rng)
+{
+	vector<uword> order(n);
+	iota(order.begin(), order.end(), 0);
+	shuffle(order.begin(), order.end(), rng);
+	for(size_t e=0; e < edges.size(); ++e) {
+		edges[e].a = order[edges[e].a];
+		edges[e].b = order[edges[e].b];
+	}
+}
+
+// symmetric network in compressed columns, and its column sums, from edges
+// and main effects; row order within a column does not matter to the
+// power method
+static void buildNetwork(const vector<RankEdge>& edges, const mat& mainEffects,
+		PermutationBuffers& network)
+{
+	uword n = mainEffects.n_elem;
+	vector<uword>& colPtrs = network.colPtrs;
+	colPtrs.assign(n + 1, 0);
+	network.degrees.zeros(n);
+	for(uword i=0; i < n; ++i) {
+		if(mainEffects(i) != 0) {
+			++colPtrs[i + 1];
+			network.degrees(i) += mainEffects(i);
+		}
+	}
+	for(size_t e=0; e < edges.size(); ++e) {
+		++colPtrs[edges[e].a + 1];
+		++colPtrs[edges[e].b + 1];
+		network.degrees(edges[e].a) += edges[e].w;
+		network.degrees(edges[e].b) += edges[e].w;
+	}
+	for(uword i=0; i < n; ++i) {
+		colPtrs[i + 1] += colPtrs[i];
+	}
+	network.rowIndices.resize(colPtrs[n]);
+	network.values.resize(colPtrs[n]);
+	vector<uword>& next = network.nextInColumn;
+	next.assign(colPtrs.begin(), colPtrs.end() - 1);
+	for(uword i=0; i < n; ++i) {
+		if(mainEffects(i) != 0) {
+			network.rowIndices[next[i]] = i;
+			network.values[next[i]++] = mainEffects(i);
+		}
+	}
+	for(size_t e=0; e < edges.size(); ++e) {
+		uword a = edges[e].a;
+		uword b = edges[e].b;
+		network.rowIndices[next[a]] = b;
+		network.values[next[a]++] = edges[e].w;
+		network.rowIndices[next[b]] = a;
+		network.values[next[b]++] = edges[e].w;
+	}
+}
+
 CentralityRanker::CentralityRanker(string gainFileParam, bool isUpperTriangular)
 {
 
@@ -41,6 +294,9 @@ CentralityRanker::CentralityRanker(string gainFileParam, bool isUpperTriangular)
 	gainFile = gainFileParam;
 	gamma = 0.0;
 	n = G.n_cols;
+	isSparse = false;
+	numPermutations = 0;
+	solverMethod = POWER_METHOD;
   Gdiag.resize(n, n);
 }
 
@@ -64,6 +320,9 @@ CentralityRanker::CentralityRanker(matrix_t variablesMatrix, unsigned int dim,
 	gainFile = "";
 	gamma = 0.0;
 	n = dim;
+	isSparse = false;
+	numPermutations = 0;
+	solverMethod = POWER_METHOD;
   Gdiag.resize(n, n);
 }
 
@@ -85,28 +344,49 @@ CentralityRanker::CentralityRanker(mat& A, vector<string> varNames)
 	gainFile = "";
 	gamma = 0.0;
 	n = G.n_cols;
+	isSparse = false;
+	numPermutations = 0;
+	solverMethod = POWER_METHOD;
   Gdiag.resize(n, n);
 }
 
 CentralityRanker::CentralityRanker(sp_mat& A, vector<string> varNames)
 {
 	unsigned int dim = A.n_cols;
-	// setup G matrix for SNPrank algorithm
-	G.resize(dim, dim);
-	// copy variable matrix values into G
-	for(unsigned int i=0; i < dim; ++i) {
-		for(unsigned int j=0; j < dim; ++j) {
-			G(i, j) = G(j, i) = A(i, j);
+	// keep G sparse; mirror the lower triangle like the dense copy above
+	vector<uword> locationRows;
+	vector<uword> locationCols;
+	vector<double> locationValues;
+	for(sp_mat::const_iterator it=A.begin(); it != A.end(); ++it) {
+		if(it.row() < it.col()) {
+			continue;
+		}
+		locationRows.push_back(it.row());
+		locationCols.push_back(it.col());
+		locationValues.push_back(*it);
+		if(it.row() != it.col()) {
+			locationRows.push_back(it.col());
+			locationCols.push_back(it.row());
+			locationValues.push_back(*it);
 		}
 	}
+	umat locations(2, locationValues.size());
+	for(uword k=0; k < locationValues.size(); ++k) {
+		locations(0, k) = locationRows[k];
+		locations(1, k) = locationCols[k];
+	}
+	Gsparse = sp_mat(locations, vec(locationValues), dim, dim);
 	for(unsigned int i=0; i < dim; ++i) {
 		variableNames.push_back(varNames[i]);
 	}
 	// set default values
 	gainFile = "";
 	gamma = 0.0;
-	n = G.n_cols;
-  Gdiag.resize(n, n);
+	n = dim;
+	isSparse = true;
+	numPermutations = 0;
+	solverMethod = POWER_METHOD;
+  Gdiag.set_size(n, 1);
 }
 
 CentralityRanker::~CentralityRanker()
@@ -116,6 +396,35 @@ bool CentralityRanker::CalculateCentrality(SolverMethod method)
 {
 	// NOTE: This code attempts to match the original Matlab .m code.
 
+	solverMethod = method;
+	if(isSparse && (method == GAUSS_ELIMINATION)) {
+		// the system of equations is solved on the dense matrix
+		G = mat(Gsparse);
+	}
+	if(isSparse && (method == POWER_METHOD)) {
+		// main effects, trace and degrees from the compressed columns
+		n = Gsparse.n_rows;
+		Gdiag = zeros<vec>(n);
+		colsum = zeros<rowvec>(n);
+		const uword* colPtrs = Gsparse.col_ptrs;
+		const uword* rowIndices = Gsparse.row_indices;
+		const double* values = Gsparse.values;
+#pragma omp parallel for schedule(dynamic, 256)
+		for(uword col=0; col < n; ++col) {
+			double colTotal = 0;
+			for(uword k=colPtrs[col]; k < colPtrs[col + 1]; ++k) {
+				colTotal += values[k];
+				if(rowIndices[k] == col) {
+					Gdiag(col) = values[k];
+				}
+			}
+			colsum(col) = colTotal;
+		}
+		Gtrace = accu(Gdiag);
+
+		return PowerMethodSolver();
+	}
+
 	// G diagonal is main effects
 	Gdiag = G.diag();
 #ifdef DEBUG_CENTRALITY
@@ -178,9 +487,127 @@ bool CentralityRanker::Permute(int numPerms)
 				<< numPerms << endl;
 		return false;
 	}
-	for(int i = 0; i < numPerms; i++) {
+	if(!n || (r.n_elem != n)) {
+		cerr << "CentralityRanker::Permute requires centrality scores" << endl;
+		return false;
+	}
+	if(solverMethod != POWER_METHOD) {
+		// permuted networks are scored with the power method transition
+		// matrix, which is not the Gauss solver's system of equations
+		cerr << "CentralityRanker::Permute requires power method scores" << endl;
+		return false;
+	}
+	if((gamma == 0) || gammaVector.size()) {
+		cerr << "CentralityRanker::Permute requires a global gamma" << endl;
+		return false;
+	}
 
-	}	
+	// observed interactions as upper triangle edges
+	vector<RankEdge> observedEdges;
+	if(isSparse) {
+		for(sp_mat::const_iterator it=Gsparse.begin(); it != Gsparse.end(); ++it) {
+			if(it.row() < it.col()) {
+				RankEdge edge = {it.row(), it.col(), *it};
+				observedEdges.push_back(edge);
+			}
+		}
+	}
+	else {
+		for(uword j=1; j < n; ++j) {
+			for(uword i=0; i < j; ++i) {
+				if(G(i, j) != 0) {
+					RankEdge edge = {i, j, G(i, j)};
+					observedEdges.push_back(edge);
+				}
+			}
+		}
+	}
+	vec observedR = r;
+
+	unsigned long baseSeed = par::random_seed? par::random_seed: time(0);
+	RankNull null = (par::ranker_permute_null == "degree")? REWIRE_NULL: 
+		LABEL_NULL;
+	string nullName = par::ranker_permute_null;
+	if((null == REWIRE_NULL) && (observedEdges.size() > 1)) {
+		// nearly complete networks, as reGAIN and dcGAIN matrices usually are,
+		// leave no swaps that avoid existing interactions
+		PermutationBuffers trial;
+		trial.edges = observedEdges;
+		seed_seq trialSeed{baseSeed};
+		mt19937 rng(trialSeed);
+		size_t numSwapped = rewireEdges(trial.edges, trial.present, n, rng);
+		if(numSwapped < REWIRE_MIN_SWAPS_PER_EDGE * observedEdges.size()) {
+			PP->printLOG("WARNING: network too dense for degree-preserving "
+				"rewiring, [ " + int2str(numSwapped) + " ] swaps for [ " + 
+				int2str(observedEdges.size()) + " ] interactions; "
+				"shuffling interaction weights among edges instead\n");
+			null = WEIGHT_NULL;
+			nullName = "weight";
+		}
+	}
+	PP->printLOG(Timestamp() + "Running [ " + int2str(numPerms) + " ] " + 
+		nullName + " permutations of [ " + 
+		int2str(observedEdges.size()) + " ] interactions\n");
+	vector<PermutationBuffers> threadBuffers(omp_get_max_threads());
+	uvec exceedances = zeros<uvec>(n);
+	uword* counts = exceedances.memptr();
+	int numDone = 0;
+	int numConverged = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+:numDone,numConverged)
+	for(int perm=0; perm < numPerms; ++perm) {
+		// one stream per permutation, independent of the thread running it
+		seed_seq permSeed{(unsigned long) baseSeed, (unsigned long) perm};
+		mt19937 rng(permSeed);
+		PermutationBuffers& network = threadBuffers[omp_get_thread_num()];
+		// copies into the thread's existing capacity
+		network.edges = observedEdges;
+		switch(null) {
+			case REWIRE_NULL:
+				rewireEdges(network.edges, network.present, n, rng);
+				break;
+			case WEIGHT_NULL:
+				shuffleWeights(network.edges, rng);
+				break;
+			case LABEL_NULL:
+				relabelEdges(network.edges, n, rng);
+				break;
+		}
+		buildNetwork(network.edges, Gdiag, network);
+		RankNetwork columns = {&network.colPtrs[0], 
+			network.rowIndices.size()? &network.rowIndices[0]: 0,
+			network.values.size()? &network.values[0]: 0};
+		vec invColsum;
+		vec diag_T_nz;
+		transitionTerms(Gdiag, network.degrees, Gtrace, gamma, invColsum, 
+			diag_T_nz);
+		// same uniform start as the observed scores
+		vec permR(n);
+		permR.fill(1.0 / n);
+		int iterations = 0;
+		double residual = 0.0;
+		if(iteratePowerMethod(&columns, G, invColsum, diag_T_nz, gamma, permR, 
+			 iterations, residual)) {
+			++numConverged;
+		}
+		for(uword i=0; i < n; ++i) {
+			if(permR(i) >= observedR(i)) {
+#pragma omp atomic
+				++counts[i];
+			}
+		}
+		++numDone;
+	}
+	if(numConverged < numDone) {
+		PP->printLOG("WARNING: [ " + int2str(numDone - numConverged) + 
+			" ] permutations reached the iteration limit\n");
+	}
+	permutationPvalues.set_size(n);
+	for(uword i=0; i < n; ++i) {
+		permutationPvalues(i) = (exceedances(i) + 1.0) / (numDone + 1.0);
+	}
+	numPermutations = numDone;
+
+	return numDone > 0;
 }
 
 void CentralityRanker::WriteToFile(string outFile, int topN)
@@ -192,7 +619,12 @@ void CentralityRanker::WriteToFile(string outFile, int topN)
 	ofstream outputFileHandle(outFile.c_str());
 	streamsize savedPrecision = cout.precision();
 	cout.precision(numeric_limits<double>::digits10);
-	outputFileHandle << "SNP\tSNPrank\tdiag\tdegree" << endl;
+	bool writePvalues = numPermutations && (permutationPvalues.n_elem == r.n_elem);
+	outputFileHandle << "SNP\tSNPrank\tdiag\tdegree";
+	if(writePvalues) {
+		outputFileHandle << "\tpvalue";
+	}
+	outputFileHandle << endl;
 	uint numToWrite = static_cast<uint>(r.n_elem);
   if((topN > 0) && (topN <= numToWrite)) {
     numToWrite = topN;
@@ -204,6 +636,9 @@ void CentralityRanker::WriteToFile(string outFile, int topN)
          << r[index] << "\t"
          << Gdiag(index) << "\t"
          << colsum(index);
+    if(writePvalues) {
+      outputFileHandle << "\t" << permutationPvalues(index);
+    }
     outputFileHandle << endl;
 	}
 	outputFileHandle.close();
@@ -232,81 +667,12 @@ void CentralityRanker::WriteToConsole(int topN)
 
 bool CentralityRanker::ReadGainFile(string gainFilename, bool isUpperTriangular)
 {
-	ifstream gainFileHandle(gainFilename.c_str());
-	if(!gainFileHandle.is_open()) {
-		cerr << "ERROR: Could not open (re)GAIN file: " << gainFilename << endl;
+	// text or binary matrix, rows parsed in parallel
+	if(!armaReadGainMatrix(gainFilename, G, variableNames, isUpperTriangular)) {
+		cerr << "ERROR: Could not read (re)GAIN file: " << gainFilename << endl;
 		return false;
 	}
 
-	string line;
-
-	// read first line (header)
-	getline(gainFileHandle, line);
-	string trimmedLine = trim(line);
-
-	// tokenize header
-	split(variableNames, trimmedLine);
-
-	// initialize dimensions of data matrix
-	size_t numVariables = variableNames.size();
-	if(!numVariables) {
-		cerr << "ERROR: Could not parse SNP names from (re)GAIN file header" << endl;
-		return false;
-	}
-	G.set_size(numVariables, numVariables);
-
-	// read numeric data into G
-	size_t row = 0;
-	vector<string> lineTokens;
-	unsigned int tokensExpected = numVariables;
-	while(getline(gainFileHandle, line)) {
-		trim(line);
-		lineTokens.clear();
-		split(lineTokens, line);
-		// cout << "Read " << lineTokens.size() << " expected: " << tokensExpected << endl;
-		if(lineTokens.size() != tokensExpected) {
-			cerr << "ERROR line:" << endl << endl << line << endl << endl;
-			cerr << "ERROR: Could not parse (re)GAIN file row: " << (row+2) << endl
-					<< "Expecting " << tokensExpected << " values, got "
-					<< lineTokens.size() << endl;
-			return false;
-		}
-		size_t startIndex = numVariables - tokensExpected;
-		for (size_t tokenIndex=0, col=startIndex; col < numVariables; ++tokenIndex, ++col) {
-			string token = lineTokens[tokenIndex];
-      trim(token);
-			if(token == "") {
-				cerr << "ERROR: parsing line " << row << " col " << col
-						<< " of (re)Gain file, token [" << token << "]" << endl;
-				return false;
-			}
-			// cout << "row: " << row << ", col: " << col << endl;
-			double t;
-			if(!from_string<double>(t, token, std::dec)) {
-				cerr << "ERROR: parsing line " << row << " col " << col
-						<< " of (re)Gain file, token [" << token << "]" << endl;
-				return false;
-				//error("Parsing REGAIN line\n" + line);
-			}
-			G(row, col) = t;
-			if((row != col) && isUpperTriangular) {
-				if(!from_string<double>(t, token, std::dec)) {
-					cerr << "ERROR: parsing line " << row << " col " << col
-							<< " of (re)Gain file, token [" << token << "]" << endl;
-					return false;
-					//error("Parsing REGAIN line\n" + line);
-				}
-				G(col, row) = t;
-			}
-		}
-		row++;
-		if(isUpperTriangular) {
-			--tokensExpected;
-		}
-	}
-
-	gainFileHandle.close();
-
 	return true;
 }
 
@@ -433,108 +799,32 @@ bool CentralityRanker::GaussEliminationSolver()
 
 bool CentralityRanker::PowerMethodSolver()
 {
-	// compute initial T, Markov chain transition matrix
-	// first term (gamma * G * D) is zero when d_j = 0
-	// for right hand term of T, Gdiag is nx1 and T_nz is 1xn
-	// initialize second term multiplier as a row vector of 1s
-
-	rowvec diag_T_nz;
-	diag_T_nz = ones(1, n) / n;
-	// (A) if row degree is 0, this will give 1/n gives more charity
-  // if no incoming connections
-
-	// (B) if row degree is non-0, gives (1-gamma)/n
-	// indices of colsum vector that are non-zero
-	uvec colsum_nzidx = find(colsum);
-#ifdef DEBUG_CENTRALITY
-	cout << "DEBUG: colsum_nzidx: " << endl << colsum_nzidx << endl;
-#endif
-
-	// D is an n x n sparse matrix with values 1/colsum for nonzero elements
-	// of colsum indices given by colsum_nzidx.  Other elements are zero.
-	D = zeros<mat>(n, n);
-	mat fillD = ones(colsum_nzidx.n_elem, 1) / colsum.elem(colsum_nzidx);
-	for (int i = 0; i < (int) fillD.size(); i++){
-		D(colsum_nzidx[i], colsum_nzidx[i]) = fillD[i];
-	}
-#ifdef DEBUG_CENTRALITY
-	cout << "DEBUG: D: " << endl << D << endl;
-  cout << "DEBUG: Gdiag: " << endl << Gdiag << endl;
-	cout << "DEBUG: G: " << endl << G << endl;
-#endif
-
-	for (int i = 0; i < (int) colsum_nzidx.n_elem; i++){
-		diag_T_nz(colsum_nzidx[i]) = (1 - gamma) / n;
-	}
-
-	// find the diagonal elements that are zero
-	uvec diag_nzidx = find(Gdiag);
-	// (C) for non-zero diag elements, gives (1-gamma)gii/n,
-	// which supercedes (A) and (B)
-
-	// this !replaces! the constant charity term if there are non-zero main effects
-	for (int i = 0; i < (int) diag_nzidx.n_elem; i++){
-		diag_T_nz(diag_nzidx[i]) = (1 - gamma) * Gdiag(diag_nzidx[i]) / n;
-	}
+	vec invColsum;
+	vec diag_T_nz;
+	transitionTerms(Gdiag, colsum, Gtrace, gamma, invColsum, diag_T_nz);
 #ifdef DEBUG_CENTRALITY
 	cout << "DEBUG: diag_T_nz: " << endl << diag_T_nz << endl;
-	cout << "DEBUG: diag_nzidx: " << endl << diag_nzidx << endl;
-#endif
-
-	arma::colvec e = ones(n, 1);
-	mat T = zeros<mat>(n, n);
-  mat GD = G * D;
-  mat ed = (e * diag_T_nz);
-  mat gammaGD = gamma * GD;
-#ifdef DEBUG_CENTRALITY
-	cout << "DEBUG: GD: " << endl << GD << endl;
-	cout << "DEBUG: gammaGD: " << endl << gammaGD << endl;
-	cout << "DEBUG: ed: " << endl << ed << endl;
-#endif
-  
-	if(Gtrace == 0.0) {
-		T = (gamma * G * D) + (e * diag_T_nz);
-	}
-	else {
-		T = (gamma * G * D) + (e * diag_T_nz) / Gtrace;
-	}
-#ifdef DEBUG_CENTRALITY
-	cout << "DEBUG: T: " << endl << T << endl;
 #endif
 
 	// initialize size of vector r to store snprank scores
 	r.set_size(n);
 	r.fill(1.0 / n);
-
-	double threshold = 1.0E-4;
-	double lambda = 0.0;
-	bool converged = false;
-	vec r_old = r;
-
-	// if the absolute value of the difference between old and current r
-	// vector is < threshold, we have converged
-  int iterations = 0;
-  //cout << "Entering convergence loop" << endl;
-	while(!converged) {
-    ++iterations;
-    
-		r_old = r;
-		r = T * r;
-    
-		// sum of r elements
-		lambda = sum(r);
-
-		// normalize eigenvector r so sum(r) == 1
-		r = r / lambda;
-
-		// check convergence, ensure all elements of r - r_old < threshold
-		if(min((uvec) (abs(r - r_old) < threshold)) == 1) {
-			converged = true;
-		}
-		else {
-			converged = false;
+	double residual = 0.0;
+	int iterations = 0;
+	RankNetwork columns = networkColumns(Gsparse);
+	bool converged = iteratePowerMethod(isSparse? &columns: 0, G, invColsum, 
+		diag_T_nz, gamma, r, iterations, residual);
+	if(converged) {
+		if(par::verbose) {
+			PP->printLOG("SNPrank power method converged in " + 
+				int2str(iterations) + " iterations\n");
 		}
 	}
+	else {
+		PP->printLOG("WARNING: SNPrank power method stopped after " + 
+			int2str(iterations) + " iterations, residual " + dbl2str(residual) + 
+			"\n");
+	}
 
-	return converged;
+	return true;
 }
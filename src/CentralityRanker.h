@@ -29,6 +29,7 @@ public:
 	bool CalculateCentrality(SolverMethod method);
 	void SetGlobalGamma(double gammaParam);
 	bool SetGammaVector(vector_t& gammaVectorValues);
+	// degree-preserving or label-permuted networks, p-values in WriteToFile
 	bool Permute(int numPerms);
 	// write results
 	void WriteToFile(std::string outfile, int topN = -1);
@@ -40,7 +41,7 @@ private:
 
 	// use system of equations solver (Gaussian elimination)
 	bool GaussEliminationSolver();
-	// use power method solver
+	// use power method solver; T is applied to r without being formed
 	bool PowerMethodSolver();
 
 	// data file
@@ -54,6 +55,9 @@ private:
 	std::vector<std::string> variableNames;
 	// GAIN matrix
 	arma::mat G;
+	// symmetric GAIN matrix from the sparse constructor; G is not filled
+	arma::sp_mat Gsparse;
+	bool isSparse;
 	// intermediate results of centrality calculations
 	arma::rowvec colsum;
 	size_t n;
@@ -63,6 +67,11 @@ private:
 
 	// centrality rank scores
 	arma::vec r;
+	// solver that produced r
+	SolverMethod solverMethod;
+	// empirical p-values of r from Permute
+	arma::vec permutationPvalues;
+	int numPermutations;
   vector<pair<double, int> > ranks;
   
   int topN;
@@ -0,0 +1,133 @@
+/* =============================================================================
+ * Filename: CovariateProjection.cpp
+ *
+ * Description:  Per-thread cache of covariate QR factorizations.
+ * =============================================================================
+ */
+
+#include <vector>
+
+#include <omp.h>
+
+#include "plink.h"
+#include "options.h"
+#include "helper.h"
+#include "lapackf.h"
+#include "CovariateProjection.h"
+
+using namespace std;
+
+// factorizations kept per thread
+#define COVARIATE_PROJECTION_MAX_ENTRIES 8
+// patterns remembered as seen once; a pattern is factored the second time
+#define COVARIATE_PROJECTION_MAX_PENDING 32
+
+bool CovariateProjection::enabled = false;
+vector<CovariateProjection::ThreadCache> CovariateProjection::caches;
+
+void CovariateProjection::enable() {
+  ThreadCache emptyCache;
+  emptyCache.clock = 0;
+  caches.assign(omp_get_max_threads(), emptyCache);
+  enabled = true;
+}
+
+void CovariateProjection::release() {
+  caches.clear();
+  enabled = false;
+}
+
+CovariateBasis* CovariateProjection::get(const vector<bool>& miss,
+                                         const vector<int>& covariates,
+                                         const matrix_t& X,
+                                         const vector<int>& columns) {
+  // thread numbers restart at 0 in nested teams, which would share a cache;
+  // fit those models directly
+  uint threadIndex = omp_get_thread_num();
+  if(!enabled || (omp_get_level() > 1) || (threadIndex >= caches.size())) {
+    return 0;
+  }
+  ThreadCache& cache = caches[threadIndex];
+  ++cache.clock;
+  int nind = X.size();
+  for(uint i=0; i < cache.entries.size(); ++i) {
+    CovariateBasis& basis = cache.entries[i];
+    if((basis.nind == nind) && (basis.covariates == covariates) && 
+       (basis.miss == miss)) {
+      basis.lastUse = cache.clock;
+      return basis.valid? &basis: 0;
+    }
+  }
+
+  // factor a pattern only when it recurs; one-off patterns, e.g., from 
+  // missing genotypes, are cheaper to fit directly
+  unsigned long thisFingerprint = fingerprint(miss, covariates);
+  bool seenBefore = false;
+  for(uint i=0; i < cache.pending.size(); ++i) {
+    if(cache.pending[i] == thisFingerprint) {
+      seenBefore = true;
+      cache.pending.erase(cache.pending.begin() + i);
+      break;
+    }
+  }
+  if(!seenBefore) {
+    if(cache.pending.size() == COVARIATE_PROJECTION_MAX_PENDING) {
+      cache.pending.erase(cache.pending.begin());
+    }
+    cache.pending.push_back(thisFingerprint);
+    return 0;
+  }
+
+  // replace the least recently used entry when full
+  uint slot = cache.entries.size();
+  if(slot == COVARIATE_PROJECTION_MAX_ENTRIES) {
+    slot = 0;
+    for(uint i=1; i < cache.entries.size(); ++i) {
+      if(cache.entries[i].lastUse < cache.entries[slot].lastUse) {
+        slot = i;
+      }
+    }
+  } else {
+    cache.entries.push_back(CovariateBasis());
+  }
+  CovariateBasis& basis = cache.entries[slot];
+  basis.miss = miss;
+  basis.covariates = covariates;
+  basis.nind = nind;
+  basis.k = columns.size();
+  basis.lastUse = cache.clock;
+  basis.valid = build(basis, X, columns);
+
+  return basis.valid? &basis: 0;
+}
+
+unsigned long CovariateProjection::fingerprint(const vector<bool>& miss,
+                                               const vector<int>& covariates) {
+  // FNV-1a over the missing individuals and the covariates
+  unsigned long hash = 14695981039346656037UL;
+  for(uint i=0; i < miss.size(); ++i) {
+    if(miss[i]) {
+      hash = (hash ^ i) * 1099511628211UL;
+    }
+  }
+  for(uint i=0; i < covariates.size(); ++i) {
+    hash = (hash ^ (unsigned long) (covariates[i] + miss.size())) * 
+      1099511628211UL;
+  }
+
+  return hash;
+}
+
+bool CovariateProjection::build(CovariateBasis& basis, const matrix_t& X,
+                                const vector<int>& columns) {
+  int nind = basis.nind;
+  int k = basis.k;
+  basis.Q.resize(nind * k);
+  for(int c=0; c < k; ++c) {
+    for(int i=0; i < nind; ++i) {
+      basis.Q[i + c * nind] = X[i][columns[c]];
+    }
+  }
+
+  return qr_basis_lapack(nind, k, basis.Q, basis.Rinv);
+}
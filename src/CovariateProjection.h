@@ -0,0 +1,67 @@
+/*==============================================================================
+ *
+ * Filename:  CovariateProjection.h
+ *
+ * Description:  Cache of QR factorizations of the intercept and covariate
+ * columns of linear model design matrices. A factorization depends only on
+ * the covariates and the set of non-missing individuals, so it is computed
+ * once per missingness pattern and reused by all models with that pattern.
+ * LinearModel then fits only the SNP/numeric/interaction terms on
+ * covariate-residualized data (Frisch-Waugh-Lovell) and recovers the full
+ * coefficient vector and covariance matrix, i.e., identical statistics.
+ * Caches are per thread, so lookups need no locking.
+ * =============================================================================
+ */
+
+#ifndef __COVARIATE_PROJECTION_H__
+#define __COVARIATE_PROJECTION_H__
+
+#include <vector>
+
+#include "plink.h"
+
+// QR factorization of the covariate block for one missingness pattern
+struct CovariateBasis {
+  // key: missing individuals and the covariates (clist indices) in the model
+  std::vector<bool> miss;
+  std::vector<int> covariates;
+  // false if the covariate block is rank deficient
+  bool valid;
+  int nind;
+  int k;
+  // orthonormal nind x k basis, column-major
+  vector_t Q;
+  // R^-1, k x k upper triangular, column-major
+  vector_t Rinv;
+  unsigned long lastUse;
+};
+
+class CovariateProjection {
+public:
+  // allow linear models to use the cache
+  static void enable();
+  static bool isEnabled() { return enabled; }
+  // drop all cached factorizations, e.g., after covariates change
+  static void release();
+  // cached basis of the intercept and covariate columns of X for this 
+  // thread; NULL if the pattern is not cached (yet) or rank deficient
+  static CovariateBasis* get(const std::vector<bool>& miss,
+                             const std::vector<int>& covariates,
+                             const matrix_t& X, 
+                             const std::vector<int>& columns);
+private:
+  struct ThreadCache {
+    std::vector<CovariateBasis> entries;
+    // fingerprints of recently seen patterns that are not cached
+    std::vector<unsigned long> pending;
+    unsigned long clock;
+  };
+  static unsigned long fingerprint(const std::vector<bool>& miss,
+                                   const std::vector<int>& covariates);
+  static bool build(CovariateBasis& basis, const matrix_t& X, 
+                    const std::vector<int>& columns);
+  static bool enabled;
+  static std::vector<ThreadCache> caches;
+};
+
+#endif
@@ -0,0 +1,173 @@
+/* =============================================================================
+ * Filename: DcPermutation.cpp
+ *
+ * Description:  Permutation null for differential correlation.
+ * =============================================================================
+ */
+
+#include <cmath>
+#include <ctime>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <omp.h>
+
+#include <armadillo>
+
+#include "plink.h"
+#include "options.h"
+#include "helper.h"
+#include "DcPermutation.h"
+#include "Insilico.h"
+
+using namespace std;
+using namespace arma;
+
+DcPermutation::DcPermutation(const GroupCorrelation& groupCorrelation, 
+                             unsigned int paramNumPermutations, 
+                             unsigned long seed): 
+  groupStats(groupCorrelation) {
+  numPermutations = paramNumPermutations;
+  baseSeed = seed;
+  numCompleted = 0;
+}
+
+DcPermutation::~DcPermutation() {
+}
+
+bool DcPermutation::run(const vector<bool>& isCase, const mat& observedZ) {
+  unsigned int numSamples = groupStats.getNumSamples();
+  if((isCase.size() != numSamples) || 
+     (observedZ.n_rows != observedZ.n_cols)) {
+    return false;
+  }
+  observed = abs(observedZ);
+  uword numVars = observed.n_rows;
+  exceedances.zeros(numVars, numVars);
+  uword* counts = exceedances.memptr();
+  vector<double> permMaxZ(numPermutations, -1.0);
+  unsigned int numDone = 0;
+  #pragma omp parallel for schedule(dynamic, 1) reduction(+:numDone)
+  for(int perm=0; perm < (int) numPermutations; ++perm) {
+    // one stream per permutation, independent of the thread running it
+    seed_seq permSeed{(unsigned long) baseSeed, (unsigned long) perm};
+    mt19937 rng(permSeed);
+    vector<unsigned int> order(numSamples);
+    iota(order.begin(), order.end(), 0);
+    shuffle(order.begin(), order.end(), rng);
+    vector<bool> permCase(numSamples);
+    for(unsigned int i=0; i < numSamples; ++i) {
+      permCase[i] = isCase[order[i]];
+    }
+    mat Z;
+    if(!groupStats.differentialCorrelationZ(permCase, Z)) {
+      continue;
+    }
+    double thisMaxZ = 0;
+    for(uword j=1; j < numVars; ++j) {
+      for(uword i=0; i < j; ++i) {
+        double z = Z(i, j);
+        if(!std::isfinite(z)) {
+          continue;
+        }
+        if(z > thisMaxZ) {
+          thisMaxZ = z;
+        }
+        if(z >= observed(i, j)) {
+          // exceedances of interesting edges are rare
+          #pragma omp atomic
+          ++counts[j * numVars + i];
+        }
+      }
+    }
+    permMaxZ[perm] = thisMaxZ;
+    ++numDone;
+  }
+  maxZ.clear();
+  for(unsigned int perm=0; perm < numPermutations; ++perm) {
+    if(permMaxZ[perm] >= 0) {
+      maxZ.push_back(permMaxZ[perm]);
+    }
+  }
+  numCompleted = numDone;
+
+  return numCompleted > 0;
+}
+
+bool DcPermutation::edgePvalues(mat& pvals) const {
+  if(!numCompleted) {
+    return false;
+  }
+  uword numVars = observed.n_rows;
+  pvals.ones(numVars, numVars);
+  double denominator = numCompleted + 1.0;
+  for(uword j=1; j < numVars; ++j) {
+    for(uword i=0; i < j; ++i) {
+      if(!std::isfinite(observed(i, j))) {
+        continue;
+      }
+      pvals(i, j) = pvals(j, i) = (exceedances(i, j) + 1.0) / denominator;
+    }
+  }
+
+  return true;
+}
+
+bool DcPermutation::familyWisePvalues(mat& pvals) const {
+  if(!numCompleted) {
+    return false;
+  }
+  vector<double> sortedMaxZ(maxZ);
+  sort(sortedMaxZ.begin(), sortedMaxZ.end());
+  uword numVars = observed.n_rows;
+  pvals.ones(numVars, numVars);
+  double denominator = numCompleted + 1.0;
+  for(uword j=1; j < numVars; ++j) {
+    for(uword i=0; i < j; ++i) {
+      if(!std::isfinite(observed(i, j))) {
+        continue;
+      }
+      double numAtLeast = sortedMaxZ.end() - 
+        lower_bound(sortedMaxZ.begin(), sortedMaxZ.end(), observed(i, j));
+      pvals(i, j) = pvals(j, i) = (numAtLeast + 1.0) / denominator;
+    }
+  }
+
+  return true;
+}
+
+bool armaDcgainPermutation(mat& edgePvals, mat& fwerPvals,
+                           unsigned int numPermutations, 
+                           vector<double>& maxZ) {
+  uint numVars = PP->nlistname.size();
+  mat expression(PP->n, numVars);
+  vector<bool> isCase(PP->n, false);
+  for(int i=0; i < PP->n; ++i) {
+    for(uint var=0; var < numVars; ++var) {
+      expression(i, var) = PP->sample[i]->nlist[var];
+    }
+    isCase[i] = PP->sample[i]->aff;
+  }
+  if(!expression.is_finite()) {
+    PP->printLOG("WARNING: numeric data is not finite\n");
+    return false;
+  }
+  GroupCorrelation groupStats;
+  mat observedZ;
+  if(!groupStats.setData(expression) || 
+     !groupStats.differentialCorrelationZ(isCase, observedZ)) {
+    return false;
+  }
+  unsigned long seed = par::random_seed? par::random_seed: time(0);
+  PP->printLOG(Timestamp() + "Running [ " + int2str(numPermutations) + 
+    " ] dcGAIN phenotype permutations\n");
+  DcPermutation permutation(groupStats, numPermutations, seed);
+  if(!permutation.run(isCase, observedZ)) {
+    return false;
+  }
+  maxZ = permutation.getMaxZ();
+  
+  return permutation.edgePvalues(edgePvals) && 
+    permutation.familyWisePvalues(fwerPvals);
+}
@@ -0,0 +1,55 @@
+/*==============================================================================
+ *
+ * Filename:  DcPermutation.h
+ *
+ * Description:  Permutation null for differential correlation (dcGAIN and
+ * dcVar). The expression data are standardized once in a GroupCorrelation;
+ * each permutation shuffles the case/control labels and computes both group
+ * correlation matrices with one GEMM over the smaller group. Permutations run
+ * in parallel, each with its own random stream seeded from the permutation
+ * index, so results do not depend on the number of threads. Per-edge
+ * exceedance counts and the maximum Z of each permutation give empirical
+ * per-edge and family-wise p-values.
+ * =============================================================================
+ */
+
+#ifndef __DC_PERMUTATION_H__
+#define __DC_PERMUTATION_H__
+
+#include <vector>
+
+#include <armadillo>
+
+#include "GroupCorrelation.h"
+
+class DcPermutation {
+public:
+  DcPermutation(const GroupCorrelation& groupCorrelation, 
+                unsigned int numPermutations, unsigned long seed);
+  ~DcPermutation();
+  // permute the isCase labels against the observed |Z| matrix
+  bool run(const std::vector<bool>& isCase, const arma::mat& observedZ);
+  // (exceedances + 1) / (permutations + 1) for each edge, 1 on the diagonal
+  bool edgePvalues(arma::mat& pvals) const;
+  // fraction of permutation maximum Z >= the observed Z of each edge
+  bool familyWisePvalues(arma::mat& pvals) const;
+  // maximum Z of each completed permutation
+  const std::vector<double>& getMaxZ() const { return maxZ; }
+  unsigned int getNumCompleted() const { return numCompleted; }
+private:
+  const GroupCorrelation& groupStats;
+  unsigned int numPermutations;
+  unsigned long baseSeed;
+  arma::mat observed;
+  // upper triangle counts of permutation Z >= observed Z
+  arma::umat exceedances;
+  std::vector<double> maxZ;
+  unsigned int numCompleted;
+};
+
+// dcGAIN permutation p-values for the PLINK numerics and affection status
+bool armaDcgainPermutation(arma::mat& edgePvals, arma::mat& fwerPvals,
+                           unsigned int numPermutations, 
+                           std::vector<double>& maxZ);
+
+#endif
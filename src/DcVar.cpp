@@ -4,6 +4,7 @@
  */
 
 #include <cstdlib>
+#include <ctime>
 #include <iostream>
 #include <iterator>
 #include <fstream>
@@ -29,6 +30,9 @@
 #include "Insilico.h"
 #include "StringUtils.h"
 #include "ArmadilloFuncs.h"
+#include "GroupCorrelation.h"
+#include "DcVarPipeline.h"
+#include "DcPermutation.h"
 
 using namespace std;
 using namespace insilico;
@@ -85,6 +89,10 @@ DcVar::~DcVar() {
 
 bool DcVar::Run() {
   bool runSuccess = false;
+  if(par::dc_permutations && !par::dcvar_group_stats) {
+    PP->printLOG("WARNING: dcVar permutations need group statistics, "
+      "using normal p-values\n");
+  }
   if(snpInputType == SNP_SRC_PLINK) {
     runSuccess = RunPlink();
   }
@@ -208,7 +216,9 @@ bool DcVar::RunPlink() {
     ReadCheckpoint(snpInfo);
     initSnpIdx = snpInfo.first;
     PP->printLOG("Checkpoint resume at SNP index: " + int2str(initSnpIdx) + "\n");
+    LoadPvalueHistogram();
   }
+  DcVarPipeline* pipeline = StartPipeline();
   for(uint snpIdx=initSnpIdx; snpIdx < numSnps; ++snpIdx) {
     string variantName = PP->locus[snpIdx]->name;
     PP->printLOG("\n-----[ " + variantName + 
@@ -229,15 +239,26 @@ bool DcVar::RunPlink() {
     // run dcGAIN for this variant phenotype
     zVals.zeros(numGenes, numGenes);
     pVals.ones(numGenes, numGenes);
-    if(!armaDcgain(zVals, pVals)) {
+    bool dcgainOk = par::dcvar_group_stats? 
+      PlinkGroupDcgain(): armaDcgain(zVals, pVals);
+    if(!dcgainOk) {
       PP->printLOG("WARNING: armaDcgain failed for this variant [ " + variantName + " ]\n");
       continue;
     }
+    // dcGAIN keeps the Z values of all pairs
+    if(par::dc_permutations && par::dcvar_group_stats && 
+       !PermutationPvalues(snpIdx, zVals, 1.0)) {
+      PP->printLOG("WARNING: permutations failed for this variant [ " + variantName + " ]\n");
+      continue;
+    }
     // DEBUG
     // cout << "results" << endl << results.submat(0,0,4,4) << endl;
     // cout << "interactionPvals" << endl << interactionPvals.submat(0,0,4,4) << endl;
     // armaWriteMatrix(results, "DEBUG.dcgain", PP->nlistname);
     // armaWriteMatrix(interactionPvals, "DEBUG.interactionPvals", PP->nlistname);
+    if(par::save_pvalue_histogram) {
+      CountPvalues();
+    }
     // ------------------------------------------------------------------------
     // adjust p-values
     if(par::do_dcvar_pfilter) {
@@ -260,10 +281,17 @@ bool DcVar::RunPlink() {
             par::dcvar_pfilter_type + "." +
             variantName + 
             ".pass.tab";
+    if(pipeline) {
+      // written and checkpointed asynchronously
+      pipeline->submit(CollectResults(snpIdx, variantName, resultsFilename));
+      continue;
+    }
     WriteResults(resultsFilename, variantName);
     // write in case the job fails in this loop; resume with command line flag
     WriteCheckpoint(snpIdx, variantName);
   } // END all variants loop
+  FinishPipeline(pipeline);
+  SavePvalueHistogram(true);
   PP->printLOG("dcVar analysis complete!\n");
 
   return true;
@@ -304,7 +332,9 @@ bool DcVar::RunOMRF() {
     pair <uint, string> snpInfo;
     ReadCheckpoint(snpInfo);
     initSnpIdx = snpInfo.first;
+    LoadPvalueHistogram();
   }
+  DcVarPipeline* pipeline = StartPipeline();
   for(uint snpIdx = initSnpIdx; snpIdx < numSnps; ++snpIdx) {
     string snpName = snpNames[snpIdx];
     if(par::verbose) PP->printLOG("--------------------------------------------------------\n");
@@ -333,21 +363,37 @@ bool DcVar::RunOMRF() {
                    int2str(MIN_NUM_SUBJ_PER_GROUP - 1) + " ], skipping SNP\n");
       continue;
     }
-    mat casesMatrix(numCases, numGenes);
-    mat ctrlsMatrix(numCtrls, numGenes);
-    // split into case-control groups for testing DC
-    if(!SplitExpressionCaseControl(casesMatrix, ctrlsMatrix)) {
-      error("Could not split on case control status");
-    }
     // ------------------------------------------------------------------------
     if(par::verbose) PP->printLOG("\tComputeDifferentialCorrelationZals " 
                  "and first pass p-value filter [ " + 
                  dbl2str(DEFAULT_PVALUE_THRESHOLD) + " ]\n");
-    // sparse matrix of significant p-values
-    if(!ComputeDifferentialCorrelationZsparse(snpName, 
-                                              casesMatrix, 
-                                              ctrlsMatrix)) {
-      error("ComputeDifferentialCorrelationZvals failed");
+    if(par::dcvar_group_stats) {
+      // group correlations from sufficient statistics, no expression split
+      mat dcZ;
+      if(!GroupDifferentialCorrelationZ(dcZ) || 
+         !ComputeDifferentialCorrelationZsparse(snpName, dcZ)) {
+        error("ComputeDifferentialCorrelationZvals failed");
+      }
+      if(par::dc_permutations && 
+         !PermutationPvalues(snpIdx, dcZ, FirstPassPvalueThreshold())) {
+        error("dcVar permutations failed");
+      }
+    } else {
+      mat casesMatrix(numCases, numGenes);
+      mat ctrlsMatrix(numCtrls, numGenes);
+      // split into case-control groups for testing DC
+      if(!SplitExpressionCaseControl(casesMatrix, ctrlsMatrix)) {
+        error("Could not split on case control status");
+      }
+      // sparse matrix of significant p-values
+      if(!ComputeDifferentialCorrelationZsparse(snpName, 
+                                                casesMatrix, 
+                                                ctrlsMatrix)) {
+        error("ComputeDifferentialCorrelationZvals failed");
+      }
+    }
+    if(par::save_pvalue_histogram) {
+      CountPvalues();
     }
     // ------------------------------------------------------------------------
     // adjust p-values
@@ -369,10 +415,17 @@ bool DcVar::RunOMRF() {
             par::dcvar_pfilter_type + "." +
             snpName + 
             ".pass.tab";
+    if(pipeline) {
+      // written and checkpointed asynchronously
+      pipeline->submit(CollectResults(snpIdx, snpName, resultsFilename));
+      continue;
+    }
     WriteResults(resultsFilename, snpName);
     // write in case the job fails in this loop; resume with command line flag
     WriteCheckpoint(snpIdx, snpName);
   } // end for all SNPs
+  FinishPipeline(pipeline);
+  SavePvalueHistogram(true);
   
 //  zout.close();
   
@@ -412,6 +465,7 @@ bool DcVar::RunOMRFChipSeq() {
     pair <uint, string> snpInfo;
     ReadCheckpoint(snpInfo);
     initChipseqIdx = snpInfo.first;
+    LoadPvalueHistogram();
   } else {
       initChipseqIdx = 1;
   }
@@ -419,6 +473,7 @@ bool DcVar::RunOMRFChipSeq() {
   string prevChrom = "";
   string curChrom = chipseqInfo.chrom;
   
+  DcVarPipeline* pipeline = StartPipeline();
   for(uint chipseqIdx = initChipseqIdx; chipseqIdx < numChipseq; ++chipseqIdx) {
     chipseqInfo = chipSeqExpression[chipseqIdx];
     string chipseqSnpName = chipseqInfo.rsnum;
@@ -470,21 +525,33 @@ bool DcVar::RunOMRFChipSeq() {
                      int2str(MIN_NUM_SUBJ_PER_GROUP - 1) + " ], skipping SNP\n");
         continue;
       }
-      mat casesMatrix(numCases, numGenes);
-      mat ctrlsMatrix(numCtrls, numGenes);
-      // split into case-control groups for testing DC
-      if(!SplitExpressionCaseControl(casesMatrix, ctrlsMatrix)) {
-        error("Could not split on case control status");
-      }
       // ------------------------------------------------------------------------
       if(par::verbose) PP->printLOG("\tComputeDifferentialCorrelationZals " 
                    "and first pass p-value filter [ " + 
                    dbl2str(DEFAULT_PVALUE_THRESHOLD) + " ]\n");
-      // sparse matrix of significant p-values
-      if(!ComputeDifferentialCorrelationZsparse(foundSnpName, 
-                                                casesMatrix, 
-                                                ctrlsMatrix)) {
-        error("ComputeDifferentialCorrelationZvals failed");
+      if(par::dcvar_group_stats) {
+        // group correlations from sufficient statistics, no expression split
+        mat dcZ;
+        if(!GroupDifferentialCorrelationZ(dcZ) || 
+           !ComputeDifferentialCorrelationZsparse(foundSnpName, dcZ)) {
+          error("ComputeDifferentialCorrelationZvals failed");
+        }
+      } else {
+        mat casesMatrix(numCases, numGenes);
+        mat ctrlsMatrix(numCtrls, numGenes);
+        // split into case-control groups for testing DC
+        if(!SplitExpressionCaseControl(casesMatrix, ctrlsMatrix)) {
+          error("Could not split on case control status");
+        }
+        // sparse matrix of significant p-values
+        if(!ComputeDifferentialCorrelationZsparse(foundSnpName, 
+                                                  casesMatrix, 
+                                                  ctrlsMatrix)) {
+          error("ComputeDifferentialCorrelationZvals failed");
+        }
+      }
+      if(par::save_pvalue_histogram) {
+        CountPvalues();
       }
       // ------------------------------------------------------------------------
       // adjust p-values
@@ -506,11 +573,19 @@ bool DcVar::RunOMRFChipSeq() {
               par::dcvar_pfilter_type + "." +
               foundSnpName + 
               ".pass.tab";
+      if(pipeline) {
+        // written and checkpointed, by ChIP-Seq index, asynchronously
+        pipeline->submit(CollectResults(chipseqIdx, foundSnpName, 
+                                        resultsFilename));
+        continue;
+      }
       WriteResults(resultsFilename, foundSnpName);
       // write in case the job fails in this loop; resume with command line flag
       WriteCheckpoint(chipseqIdx, foundSnpName);
     } // end for all SNPs found within radius
   } // end for all ChIP-Seq SNPs
+  FinishPipeline(pipeline);
+  SavePvalueHistogram(true);
   
 //  zout.close();
   
@@ -772,12 +847,106 @@ bool DcVar::SplitExpressionCaseControl(mat& caseMatrix,
   return true;
 }
 
+bool DcVar::GroupDifferentialCorrelationZ(mat& dcZ) {
+  if(!groupStats.hasData()) {
+    // subjects x genes, standardized once for all SNPs
+    uint numGenes = geneExprNames.size();
+    uint numSubjects = numGenes? expressionMatrix[0].size(): 0;
+    mat expression(numSubjects, numGenes);
+    for(uint gene=0; gene < numGenes; ++gene) {
+      for(uint subject=0; subject < numSubjects; ++subject) {
+        expression(subject, gene) = expressionMatrix[gene][subject];
+      }
+    }
+    if(!groupStats.setData(expression)) {
+      return false;
+    }
+  }
+  vector<bool> isCase(expressionMatrix[0].size(), false);
+  for(uint i=0; i < caseIdxCol.size(); ++i) {
+    isCase[caseIdxCol[i]] = true;
+  }
+  if(!groupStats.setGroups(isCase)) {
+    return false;
+  }
+  if(par::verbose) {
+    PP->printLOG("\tGroup statistics rebuilds [ " + 
+      int2str(groupStats.getNumRebuilds()) + " ] incremental updates [ " + 
+      int2str(groupStats.getNumUpdates()) + " ]\n");
+  }
+  
+  return groupStats.differentialCorrelationZ(dcZ);
+}
+
+bool DcVar::PlinkGroupDcgain() {
+  if(!groupStats.hasData()) {
+    uint numGenes = PP->nlistname.size();
+    mat expression(PP->n, numGenes);
+    for(uint i=0; i < PP->n; ++i) {
+      for(uint gene=0; gene < numGenes; ++gene) {
+        expression(i, gene) = PP->sample[i]->nlist[gene];
+      }
+    }
+    if(!expression.is_finite()) {
+      PP->printLOG("WARNING: numeric data is not finite\n");
+      return false;
+    }
+    if(!groupStats.setData(expression)) {
+      return false;
+    }
+  }
+  // variant phenotype from MapSnpIndexToPlinkPhenos
+  vector<bool> isCase(PP->n, false);
+  for(uint i=0; i < PP->n; ++i) {
+    isCase[i] = PP->sample[i]->aff;
+  }
+  mat dcZ;
+  umat perfect;
+  if(!groupStats.setGroups(isCase) || 
+     !groupStats.differentialCorrelationZ(dcZ, &perfect)) {
+    return false;
+  }
+  // same results as armaDcgain: symmetric, diagonal Z 0 and p 1
+  uint numGenes = dcZ.n_rows;
+  uint nanCount = 0;
+  uint infinityCount = 0;
+  #pragma omp parallel for schedule(dynamic, 1) reduction(+:nanCount,infinityCount)
+  for(uint i=0; i < numGenes; ++i) {
+    for(uint j=i + 1; j < numGenes; ++j) {
+      // perfect correlations are skipped, as in armaDcgain
+      if(perfect(i, j)) {
+        continue;
+      }
+      double Z_ij = dcZ(i, j);
+      if(std::isnan(Z_ij)) {
+        ++nanCount;
+        continue;
+      }
+      if(std::isinf(Z_ij)) {
+        ++infinityCount;
+        continue;
+      }
+      zVals(i, j) = zVals(j, i) = Z_ij;
+      pVals(i, j) = pVals(j, i) = 2 * normdist(-Z_ij);
+    }
+  }
+  // same errors as armaDcgain
+  if(infinityCount) {
+    PP->printLOG(Timestamp() + "ERROR(S): " + int2str(infinityCount) + " infinite Z values found\n");
+    return false;
+  }
+  if(nanCount) {
+    PP->printLOG(Timestamp() + "ERROR(S): " + int2str(nanCount) + " nan Z values found\n");
+    return false;
+  }
+  
+  return true;
+}
+
 bool DcVar::ComputeDifferentialCorrelationZvals(string snp, 
                                                 mat& cases, 
                                                 mat& ctrls) {
   if(par::verbose) PP->printLOG("\tPerforming Z-tests for all RNA-seq interactions\n");
-  double n1 = static_cast<double>(caseIdxCol.size());
-  double n2 = static_cast<double>(ctrlIdxCol.size());
   uint numGenes = geneExprNames.size();
   double minP = 1.0;
   double maxP = 0.0;
@@ -792,51 +961,36 @@ bool DcVar::ComputeDifferentialCorrelationZvals(string snp,
      dbl2str(pThreshold) + " ]\n");
   if(par::verbose) PP->printLOG("\tEntering OpenMP parallel section for [ ");
   if(par::verbose) PP->printLOG(int2str(numCombs) + " ] dcvar combination\n");
-  zVals.set_size(numGenes, numGenes);
+  // case and control correlation matrices once for all pairs
+  mat dcZ;
+  if(!armaDifferentialCorrelationZ(cases, ctrls, dcZ)) {
+    return false;
+  }
+  zVals.zeros(numGenes, numGenes);
   pVals.ones(numGenes, numGenes);
-#pragma omp parallel for schedule(dynamic, 1)
+  // counters and p-value range are reductions; each (i, j) owns its cells
+#pragma omp parallel for schedule(dynamic, 1) \
+  reduction(+:goodPvalCount,badPvalCount,infCount) \
+  reduction(min:minP) reduction(max:maxP)
   for(uint i=0; i < numGenes; ++i) {
     for(uint j=i + 1; j < numGenes; ++j) {
-      // correlation between this interaction pair (i, j) in cases and controls
-      vec caseVarVals1 = cases.col(i);
-      vec caseVarVals2 = cases.col(j);
-      vec r_ij_1_v = cor(caseVarVals1, caseVarVals2);
-      double r_ij_1 = (double) r_ij_1_v[0];
-      vec ctrlVarVals1 = ctrls.col(i);
-      vec ctrlVarVals2 = ctrls.col(j);
-      vec r_ij_2_v = cor(ctrlVarVals1, ctrlVarVals2);
-      double r_ij_2 = (double) r_ij_2_v[0];
-      // differential correlation Z
-      double z_ij_1 = 0.5 * log((abs((1 + r_ij_1) / (1 - r_ij_1))));
-      double z_ij_2 = 0.5 * log((abs((1 + r_ij_2) / (1 - r_ij_2))));
-      double Z_ij = abs(z_ij_1 - z_ij_2) / sqrt((1.0 / (n1 - 3.0) + 1.0 / (n2 - 3.0)));
-      #pragma omp critical 
-      {
-        // !NOTE! critical section
-        double p = DEFAULT_PVALUE;
-        if(std::isinf(Z_ij)) {
-          // bad Z
-          ++infCount;
-        } else {
-          //matrixElement interactionPvalElement;
-          //pair<uint, uint> indexPair = make_pair(i, j);
-          p = 2 * normdist(-abs(Z_ij));
-          if(p < minP) minP = p;
-          if(p > maxP) maxP = p;
-          if(p <= pThreshold) {
-            ++goodPvalCount;
-            zVals(i, j) = Z_ij;
-            pVals(i, j) = p;
-            string outString = snp +  "\t"  +
-                    geneExprNames[i] + "\t"  +
-                    geneExprNames[j] + "\t"  +
-                    dbl2str(p);
-            //zout.writeLine(outString);
-          } else {
-            ++badPvalCount;
-          } // end else good p
-        } // end else good Z
-      } // end openmp critical section
+      // differential correlation Z for this interaction pair (i, j)
+      double Z_ij = dcZ(i, j);
+      if(std::isinf(Z_ij)) {
+        // bad Z
+        ++infCount;
+        continue;
+      }
+      double p = 2 * normdist(-abs(Z_ij));
+      if(p < minP) minP = p;
+      if(p > maxP) maxP = p;
+      if(p <= pThreshold) {
+        ++goodPvalCount;
+        zVals(i, j) = Z_ij;
+        pVals(i, j) = p;
+      } else {
+        ++badPvalCount;
+      }
     } // end for j cols
   } // end for i rows
   if(par::verbose) PP->printLOG("End OpenMP parallel section");
@@ -857,32 +1011,27 @@ bool DcVar::ComputeDifferentialCorrelationZ(string snp,
                                             mat& ctrls,
                                             double correctedP) {
   PP->printLOG("\tPerforming Z-tests for all rna-seq interactions\n");
-  double n1 = static_cast<double>(caseIdxCol.size());
-  double n2 = static_cast<double>(ctrlIdxCol.size());
   uint numVars = geneExprNames.size();
   double minP = 1.0;
   double maxP = 0.0;
   uint goodPvalCount = 0;
-  zVals.set_size(numVars, numVars);
+  // case and control correlation matrices once for all pairs
+  mat dcZ;
+  if(!armaDifferentialCorrelationZ(cases, ctrls, dcZ)) {
+    return false;
+  }
+  zVals.zeros(numVars, numVars);
   pVals.ones(numVars, numVars);
-#pragma omp parallel for schedule(dynamic, 1)
+  // counters and p-value range are reductions; each (i, j) owns its cells
+#pragma omp parallel for schedule(dynamic, 1) \
+  reduction(+:goodPvalCount) reduction(min:minP) reduction(max:maxP)
   for(uint i=0; i < numVars; ++i) {
     for(uint j=i + 1; j < numVars; ++j) {
-      // correlation between this interaction pair (i, j) in cases and controls
-      vec caseVarVals1 = cases.col(i);
-      vec caseVarVals2 = cases.col(j);
-      vec r_ij_1_v = cor(caseVarVals1, caseVarVals2);
-      double r_ij_1 = (double) r_ij_1_v[0];
-      vec ctrlVarVals1 = ctrls.col(i);
-      vec ctrlVarVals2 = ctrls.col(j);
-      vec r_ij_2_v = cor(ctrlVarVals1, ctrlVarVals2);
-      double r_ij_2 = (double) r_ij_2_v[0];
-      // differential correlation Z
-      double z_ij_1 = 0.5 * log((abs((1 + r_ij_1) / (1 - r_ij_1))));
-      double z_ij_2 = 0.5 * log((abs((1 + r_ij_2) / (1 - r_ij_2))));
-      double Z_ij = abs(z_ij_1 - z_ij_2) / sqrt((1.0 / (n1 - 3.0) + 1.0 / (n2 - 3.0)));
+      // differential correlation Z for this interaction pair (i, j)
+      double Z_ij = dcZ(i, j);
       double p = 2 * normdist(-abs(Z_ij)); 
       if(std::isinf(Z_ij)) {
+        #pragma omp critical
         cerr << "InfiniteZ" << "\t"
                 << snp << "\t"
                 << geneExprNames[i] << "\t" 
@@ -902,14 +1051,13 @@ bool DcVar::ComputeDifferentialCorrelationZ(string snp,
       }
       if(writeResults) {
         ++goodPvalCount;
-#pragma omp critical 
-{
         zVals(i, j) = Z_ij;
         pVals(i, j) = p;
         if(p < minP) minP = p;
         if(p > maxP) maxP = p;
-
         if(par::verbose) {
+          // console output only
+          #pragma omp critical
           cout << snp << "\t"
               << geneExprNames[i] << "\t" 
               << geneExprNames[j] << "\t" 
@@ -917,7 +1065,6 @@ bool DcVar::ComputeDifferentialCorrelationZ(string snp,
               << p 
               << endl;
         }
-}
       }
     }
   }
@@ -930,77 +1077,59 @@ bool DcVar::ComputeDifferentialCorrelationZ(string snp,
 bool DcVar::ComputeDifferentialCorrelationZsparse(string snp, 
                                                   mat& cases, 
                                                   mat& ctrls) {
+  // case and control correlation matrices once for all pairs
+  mat dcZ;
+  if(!armaDifferentialCorrelationZ(cases, ctrls, dcZ)) {
+    return false;
+  }
+  
+  return ComputeDifferentialCorrelationZsparse(snp, dcZ);
+}
+
+bool DcVar::ComputeDifferentialCorrelationZsparse(string snp, mat& dcZ) {
   if(par::verbose) PP->printLOG("\tPerforming Z-tests for all RNA-seq interactions\n");
-  double n1 = static_cast<double>(cases.n_rows);
-  double n2 = static_cast<double>(ctrls.n_rows);
   uint numGenes = geneExprNames.size();
   double minP = 1.0;
   double maxP = 0.0;
   uint goodPvalCount = 0;
   uint badPvalCount = 0;
   uint infCount = 0;
-  double pThreshold = DEFAULT_PVALUE_THRESHOLD;
-  if(par::dcvar_pfilter_type == "custom") {
-    pThreshold = par::dcvar_pfilter_value;
-  }
+  double pThreshold = FirstPassPvalueThreshold();
   if(par::verbose) PP->printLOG("\tFirst pass filter threshold [ " + 
      dbl2str(pThreshold) + " ]\n");
   if(par::verbose) PP->printLOG("\tEntering OpenMP parallel section for [ "+ 
                                 int2str(numCombs) + " ] dcvar combinations\n");
-  zVals.set_size(numGenes, numGenes);
+  zVals.zeros(numGenes, numGenes);
   pVals.ones(numGenes, numGenes);
-#pragma omp parallel for schedule(dynamic, 1)
+  // counters and p-value range are reductions; each (i, j) owns its cells
+#pragma omp parallel for schedule(dynamic, 1) \
+  reduction(+:goodPvalCount,badPvalCount,infCount) \
+  reduction(min:minP) reduction(max:maxP)
   for(uint i=0; i < numGenes; ++i) {
-    for(uint j=0; j < numGenes; ++j) {
-      if(j <= i) continue;
-      // correlation between this interaction pair (i, j) in cases and controls
-      vec caseVarVals1 = cases.col(i);
-      vec caseVarVals2 = cases.col(j);
-      vec r_ij_1_v = cor(caseVarVals1, caseVarVals2);
-      double r_ij_1 = (double) r_ij_1_v[0];
-      vec ctrlVarVals1 = ctrls.col(i);
-      vec ctrlVarVals2 = ctrls.col(j);
-      vec r_ij_2_v = cor(ctrlVarVals1, ctrlVarVals2);
-      double r_ij_2 = (double) r_ij_2_v[0];
-      // differential correlation Z
-      double z_ij_1 = 0.5 * log((abs((1 + r_ij_1) / (1 - r_ij_1))));
-      double z_ij_2 = 0.5 * log((abs((1 + r_ij_2) / (1 - r_ij_2))));
-      double Z_ij = abs(z_ij_1 - z_ij_2) / sqrt((1.0 / (n1 - 3.0) + 1.0 / (n2 - 3.0)));
-      #pragma omp critical 
-      {
-        if(par::verbose) {
-          if(i && ((i % 1000) == 0) && (j == (i + 1))) {
-            PP->printLOG(int2str(i) + " of " + int2str(numGenes) + "\n");
-          }
-        }
-        // !NOTE! critical section for writing to an already opened file 'zout'!
-        // and to keep track of counts, min/max p-values in public scope
-        double p = DEFAULT_PVALUE;
-        if(std::isinf(Z_ij)) {
-          // bad Z
-          ++infCount;
-        } else {
-          //matrixElement interactionPvalElement;
-          //pair<uint, uint> indexPair = make_pair(i, j);
-          p = 2 * normdist(-abs(Z_ij));
-          if(p < minP) minP = p;
-          if(p > maxP) maxP = p;
-          if(p <= pThreshold) {
-            ++goodPvalCount;
-//            string outString = snp +  "\t"  +
-//                    geneExprNames[i] + "\t"  +
-//                    geneExprNames[j] + "\t"  +
-//                    dbl2str(p);
-//            zout.writeLine(outString);
-            zVals(i, j) = Z_ij;
-            pVals(i, j) = p;
-            if(p < minP) minP = p;
-            if(p > maxP) maxP = p;
-          } else {
-            ++badPvalCount;
-          } // end else good p
-        } // end else good Z
-      } // end openmp critical section
+    if(par::verbose && i && ((i % 1000) == 0)) {
+      #pragma omp critical
+      PP->printLOG(int2str(i) + " of " + int2str(numGenes) + "\n");
+    }
+    for(uint j=i + 1; j < numGenes; ++j) {
+      // differential correlation Z for this interaction pair (i, j)
+      double Z_ij = dcZ(i, j);
+      if(std::isinf(Z_ij)) {
+        // bad Z
+        ++infCount;
+        continue;
+      }
+      double p = 2 * normdist(-abs(Z_ij));
+      if(p < minP) minP = p;
+      if(p > maxP) maxP = p;
+      // every tested pair keeps its p-value for the FDR cutoffs and the
+      // p-value histogram; only passing pairs get a Z and are written
+      pVals(i, j) = p;
+      if(p <= pThreshold) {
+        ++goodPvalCount;
+        zVals(i, j) = Z_ij;
+      } else {
+        ++badPvalCount;
+      }
     } // end for j cols
   } // end for i rows
   if(par::verbose) PP->printLOG("End OpenMP parallel section");
@@ -1016,6 +1145,14 @@ bool DcVar::ComputeDifferentialCorrelationZsparse(string snp,
   return true;
 }
 
+double DcVar::FirstPassPvalueThreshold() {
+  if(par::dcvar_pfilter_type == "custom") {
+    return par::dcvar_pfilter_value;
+  }
+  
+  return DEFAULT_PVALUE_THRESHOLD;
+}
+
 bool DcVar::FlattenPvals(vector_t& retPvals) {
   if(par::verbose) PP->printLOG("Flattening p-values list into a vector\n");
   retPvals.clear();
@@ -1113,6 +1250,8 @@ bool DcVar::WriteCheckpoint(uint snpIndex, string snpName) {
   ofstream checkpointFile(CHECKPOINT_FILENAME);
   checkpointFile << snpIndex << endl << snpName << endl;
   checkpointFile.close();
+  // a resumed run recomputes the checkpoint SNP
+  SavePvalueHistogram(false);
   
   return true;
 }
@@ -1132,6 +1271,177 @@ bool DcVar::ReadCheckpoint(std::pair<uint, string>& lastSnp) {
   return true;
 }
 
+bool DcVar::CountPvalues() {
+  // the previous SNP is complete
+  pvalueHistogram.merge(snpHistogram);
+  snpHistogram.clear();
+  uint numThreads = omp_get_max_threads();
+  if(threadHistograms.size() != numThreads) {
+    threadHistograms.resize(numThreads);
+  }
+  for(uint t=0; t < numThreads; ++t) {
+    threadHistograms[t].clear();
+  }
+  uint numGenes = pVals.n_rows;
+  #pragma omp parallel for schedule(dynamic, 16)
+  for(uint i=0; i < numGenes; ++i) {
+    PvalueHistogram& threadHistogram = threadHistograms[omp_get_thread_num()];
+    for(uint j=i + 1; j < numGenes; ++j) {
+      threadHistogram.add(pVals(i, j));
+    }
+  }
+  for(uint t=0; t < numThreads; ++t) {
+    snpHistogram.merge(threadHistograms[t]);
+  }
+  
+  return true;
+}
+
+bool DcVar::SavePvalueHistogram(bool includeCurrent) {
+  if(!par::save_pvalue_histogram) {
+    return true;
+  }
+  if(includeCurrent) {
+    pvalueHistogram.merge(snpHistogram);
+    snpHistogram.clear();
+  }
+  string histogramFilename = par::output_file_name + ".dcvar.phist";
+  if(!pvalueHistogram.save(histogramFilename)) {
+    PP->printLOG("WARNING: could not write p-value histogram [ " + 
+      histogramFilename + " ]\n");
+    return false;
+  }
+  if(includeCurrent) {
+    PP->printLOG("Wrote p-value histogram of [ " + 
+      longint2str(pvalueHistogram.getNumTests()) + " ] tests to [ " + 
+      histogramFilename + " ]\n");
+  }
+  
+  return true;
+}
+
+bool DcVar::LoadPvalueHistogram() {
+  if(!par::save_pvalue_histogram) {
+    return true;
+  }
+  // the pipeline checkpoints after asynchronous writes, so its counts are
+  // not in step with the checkpoint SNP; ChIP-Seq checkpoints found SNPs
+  // but resumes at their ChIP-Seq SNP
+  if((par::dcvar_pipeline_threads > 0) || chipSeqMode) {
+    PP->printLOG("WARNING: p-value histogram counts restart on resume; "
+      "rerun from the first SNP for a global FDR\n");
+    return false;
+  }
+  string histogramFilename = par::output_file_name + ".dcvar.phist";
+  if(!pvalueHistogram.load(histogramFilename)) {
+    PP->printLOG("WARNING: no p-value histogram [ " + histogramFilename + 
+      " ] to resume, counts restart\n");
+    pvalueHistogram.clear();
+    return false;
+  }
+  PP->printLOG("Resuming p-value histogram of [ " + 
+    longint2str(pvalueHistogram.getNumTests()) + " ] tests\n");
+  
+  return true;
+}
+
+bool DcVar::PermutationPvalues(uint snpIndex, const mat& observedZ, 
+                               double pThreshold) {
+  // a different set of permutations for every SNP
+  unsigned long seed = (par::random_seed? par::random_seed: time(0)) + snpIndex;
+  DcPermutation permutation(groupStats, par::dc_permutations, seed);
+  mat edgePvals;
+  if(!permutation.run(groupStats.getGroups(), observedZ) || 
+     !permutation.edgePvalues(edgePvals)) {
+    return false;
+  }
+  // every tested pair gets its empirical p-value, so the p-value histogram
+  // and the BH cutoffs never mix empirical and parametric p-values
+  uint numGenes = observedZ.n_rows;
+  uint numKept = 0;
+  for(uint i=0; i < numGenes; ++i) {
+    for(uint j=i + 1; j < numGenes; ++j) {
+      double Z_ij = observedZ(i, j);
+      if(!std::isfinite(Z_ij)) {
+        continue;
+      }
+      double p = edgePvals(i, j);
+      pVals(i, j) = pVals(j, i) = p;
+      if((p <= pThreshold) && (Z_ij != 0)) {
+        zVals(i, j) = zVals(j, i) = Z_ij;
+        ++numKept;
+      } else {
+        zVals(i, j) = zVals(j, i) = 0;
+      }
+    }
+  }
+  if(par::verbose) {
+    PP->printLOG("\t[ " + int2str(permutation.getNumCompleted()) + 
+      " ] permutations, empirical p-values for all pairs, [ " + 
+      int2str(numKept) + " ] pairs kept\n");
+  }
+  
+  return true;
+}
+
+DcVarPipeline* DcVar::StartPipeline() {
+  if(par::dcvar_pipeline_threads < 1) {
+    return 0;
+  }
+  PP->printLOG("dcVar writing results with [ " + 
+    int2str(par::dcvar_pipeline_threads) + " ] formatter and writer threads\n");
+  // a few SNPs in flight per thread bounds the buffered results
+  DcVarPipeline* pipeline = new DcVarPipeline(geneExprNames, 
+    CHECKPOINT_FILENAME, par::dcvar_pipeline_threads, 
+    2 * par::dcvar_pipeline_threads);
+  pipeline->start();
+  
+  return pipeline;
+}
+
+bool DcVar::FinishPipeline(DcVarPipeline* pipeline) {
+  if(!pipeline) {
+    return true;
+  }
+  pipeline->finish();
+  PP->printLOG("dcVar pipeline wrote results for [ " + 
+    int2str(pipeline->getNumWritten()) + " ] SNPs\n");
+  delete pipeline;
+  
+  return true;
+}
+
+DcVarSnpResult* DcVar::CollectResults(uint snpIndex, string snpName, 
+                                      string filename) {
+  DcVarSnpResult* result = new DcVarSnpResult();
+  result->snpIndex = snpIndex;
+  result->snpName = snpName;
+  result->filename = filename;
+  // nonzero upper triangle Z values in row order, as WriteResults
+  uint numRows = zVals.n_rows;
+  vector<vector<DcVarPairResult> > rowPairs(numRows);
+  #pragma omp parallel for schedule(dynamic, 16)
+  for(uint row=0; row < numRows; ++row) {
+    for(uint col=row+1; col < zVals.n_cols; ++col) {
+      double zvalue = zVals(row, col);
+      if(!((zvalue > -1e-6) && (zvalue < 1e-6))) {
+        DcVarPairResult pairResult;
+        pairResult.gene1 = row;
+        pairResult.gene2 = col;
+        pairResult.z = zvalue;
+        pairResult.p = pVals(row, col);
+        rowPairs[row].push_back(pairResult);
+      }
+    }
+  }
+  for(uint row=0; row < numRows; ++row) {
+    result->pairs.insert(result->pairs.end(), rowPairs[row].begin(), 
+                         rowPairs[row].end());
+  }
+  
+  return result;
+}
+
 bool DcVar::WriteResults(string filename, string curSnp) {
   string newFile = filename + ".gz";
   if(par::verbose) {
@@ -1227,22 +1537,20 @@ bool DcVar::GetSnpsForTranscript(string transcript,
  //   << endl;
   
   // find SNPs matching criteria
-  for(int j=0; j < PP->locus.size(); ++j) {
-    Locus* thisSnp = PP->locus[j];
-    if(thisSnp->chr == chromosome) {
-      if(localCis) {
-        // on the same chromosome and within radius of transcript
-        if((thisSnp->bp >= lowerThreshold) && 
-           (thisSnp->bp <= upperThreshold)) {
-          snpIndices.push_back(j);
-        }
-      }
-      else {
-        // simply on the same chromosome
-        snpIndices.push_back(j);
-      }
-    }
+  if(!locusIndex.isBuilt()) {
+    locusIndex.build(PP->locus);
+  }
+  vector<uint> transcriptSnps;
+  if(localCis) {
+    // on the same chromosome and within radius of transcript
+    locusIndex.query(chromosome, lowerThreshold, upperThreshold, 
+                     transcriptSnps);
+  } else {
+    // simply on the same chromosome
+    locusIndex.queryChromosome(chromosome, transcriptSnps);
   }
+  snpIndices.insert(snpIndices.end(), transcriptSnps.begin(), 
+                    transcriptSnps.end());
 
   return true;
 }
@@ -1251,6 +1559,16 @@ bool DcVar::GetSnpsForTFs(vector<int>& snpIndices, vector<string>& tfs) {
 
   int allSnps = PP->locus.size();
   PP->printLOG("Searching transcription factors in " + int2str(allSnps) + " SNPs\n");
+  // index the TF ranges extended by the search radius
+  tfIndex.clear();
+  TranscriptFactorTableCIt lutIt = transcriptFactorLUT.begin();
+  for(; lutIt != transcriptFactorLUT.end(); ++lutIt) {
+    const vector<uint>& tfInfo = lutIt->second;
+    tfIndex.add(lutIt->first, tfInfo[COORD_CHROM], 
+                (long) tfInfo[COORD_BP_START] - tfRadius,
+                (long) tfInfo[COORD_BP_END] + tfRadius);
+  }
+  tfIndex.build();
   // for all SNPs
   for(int thisSnpIndex=0; thisSnpIndex < allSnps; ++thisSnpIndex) {
     if(thisSnpIndex && (thisSnpIndex % 100000 == 0)) {
@@ -1271,24 +1589,10 @@ bool DcVar::GetSnpsForTFs(vector<int>& snpIndices, vector<string>& tfs) {
 }
 
 bool DcVar::IsSnpInTFs(int chr, int bp, string& tf) {
-  // linear search through the transcription factor lookup table for SNP at
-  // chr/bp, returning the transcription factor if true, else return false
-  bool found = false;
-  TranscriptFactorTableCIt lutIt = transcriptFactorLUT.begin();
-  while((lutIt != transcriptFactorLUT.end()) && (!found)) {
-    string thisTF = (*lutIt).first;
-    int thisTfChr = transcriptFactorLUT[thisTF][COORD_CHROM];
-    int thisTfBpBeg = transcriptFactorLUT[thisTF][COORD_BP_START];
-    int thisTfBpEnd = transcriptFactorLUT[thisTF][COORD_BP_END];
-    int rangeStart = thisTfBpBeg - tfRadius;
-    int rangeEnd = thisTfBpEnd + tfRadius;
-    if((chr == thisTfChr) && ((bp >= rangeStart) &&  (bp <= rangeEnd))) {
-      tf = thisTF;
-      return true;
-    }
-    ++lutIt;
-  }
-  return false;
+  // interval lookup of the SNP at chr/bp in the TF index built by 
+  // GetSnpsForTFs, returning the first transcription factor in name order 
+  // if true, else return false
+  return tfIndex.first(chr, bp, tf);
 }
 
 bool DcVar::GetTFInfo(string tf, vector<int>& tfInfo) {
@@ -17,6 +17,10 @@
 #include "Insilico.h"
 // bcw - 1/3/18/ - for CoordinateTable, TransciptFactorTable
 #include "EpistasisEQtl.h"
+#include "GroupCorrelation.h"
+#include "DcVarPipeline.h"
+#include "PvalueHistogram.h"
+#include "DcPermutation.h"
 
 // handle both PLINK (Caleb, et al paper) BED/BIM/BAM and 
 // OMRF (Courtney Montgomery) separate files
@@ -94,6 +98,19 @@ private:
   bool ComputeDifferentialCorrelationZsparse(std::string snp, 
                                             arma::mat& cases, 
                                             arma::mat& ctrls);
+  bool ComputeDifferentialCorrelationZsparse(std::string snp, arma::mat& dcZ);
+  // p-value threshold of the first pass filter that keeps Z values
+  double FirstPassPvalueThreshold();
+  // differential correlation from the group sufficient statistics for the
+  // current caseIdxCol/ctrlIdxCol split of the expression subjects
+  bool GroupDifferentialCorrelationZ(arma::mat& dcZ);
+  // armaDcgain replacement on PLINK numerics and the variant phenotype
+  bool PlinkGroupDcgain();
+  // replace the p-values of all pairs tested in observedZ with empirical 
+  // p-values from --dc-permutations permutations of the current groups; the
+  // Z values kept are those of pairs with empirical p <= pThreshold
+  bool PermutationPvalues(uint snpIndex, const arma::mat& observedZ, 
+                          double pThreshold);
   bool ComputeDifferentialCorrelationZ(std::string snp, 
                                        arma::mat& cases, 
                                        arma::mat& ctrls, 
@@ -104,9 +121,22 @@ private:
   bool FlattenPvals(vector_t& retPvals);
   bool FilterPvalues(uint& numFiltered);
   double CalculateFdrBHThreshold();
+  // count the current SNP's p-values for --save-pvalue-histogram; the
+  // previous SNP's counts are committed first
+  bool CountPvalues();
+  // histogram of the SNPs before the current one, written with the
+  // checkpoint so a resumed run does not count the checkpoint SNP twice
+  bool SavePvalueHistogram(bool includeCurrent);
+  bool LoadPvalueHistogram();
   bool WriteCheckpoint(uint snpIndex, std::string snpName);
   bool ReadCheckpoint(std::pair<uint, string>& lastSnp);
   bool WriteResults(std::string filename, std::string curSnp);
+  // asynchronous results writing, NULL unless requested
+  DcVarPipeline* StartPipeline();
+  bool FinishPipeline(DcVarPipeline* pipeline);
+  // passing pairs of the current zVals/pVals for the pipeline
+  DcVarSnpResult* CollectResults(uint snpIndex, std::string snpName, 
+                                 std::string filename);
   // INPUTS
   // ChIP-Seq
   bool chipSeqMode;
@@ -127,9 +157,14 @@ private:
   uint totalTests;
   std::vector<uint> caseIdxCol;
   std::vector<uint> ctrlIdxCol;
+  GroupCorrelation groupStats;
   // OUTPUTS
   arma::mat zVals;
   arma::mat pVals;
+  // all tests for a global FDR; snpHistogram holds the current SNP
+  PvalueHistogram pvalueHistogram;
+  PvalueHistogram snpHistogram;
+  std::vector<PvalueHistogram> threadHistograms;
   // added from EpistasisEQtl (iQTL) - bcw - 1/3/18
   bool CheckInputs();
   bool GetSnpsForTranscript(std::string transcript, 
@@ -146,6 +181,9 @@ private:
   bool tfMode;
   int tfRadius;
   TransciptFactorTable transcriptFactorLUT;
+  // position indexes for cis window and TF lookups
+  LocusPositionIndex locusIndex;
+  GenomicIntervalIndex tfIndex;
   std::vector<int> thisTranscriptSnpIndices;
   uint nOuterLoop;
   uint nInnerLoop;
@@ -0,0 +1,129 @@
+/* =============================================================================
+ * Filename: DcVarPipeline.cpp
+ *
+ * Description:  Asynchronous formatter and writer stages for dcVar results.
+ * =============================================================================
+ */
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+
+#include "plink.h"
+#include "helper.h"
+#include "zed.h"
+#include "DcVarPipeline.h"
+#include "Insilico.h"
+
+using namespace std;
+
+DcVarPipeline::DcVarPipeline(const vector<string>& geneNames,
+                             string checkpointFile, unsigned int numThreads,
+                             unsigned int queueSize):
+  genes(geneNames), checkpointFilename(checkpointFile),
+  threadsPerStage(numThreads? numThreads: 1),
+  formatQueue(queueSize), writeQueue(queueSize) {
+  started = false;
+  nextSequence = 0;
+  writtenFrontier = 0;
+  numWritten = 0;
+}
+
+DcVarPipeline::~DcVarPipeline() {
+  finish();
+}
+
+void DcVarPipeline::start() {
+  if(started) {
+    return;
+  }
+  for(unsigned int t=0; t < threadsPerStage; ++t) {
+    formatters.push_back(thread(&DcVarPipeline::formatLoop, this));
+    writers.push_back(thread(&DcVarPipeline::writeLoop, this));
+  }
+  started = true;
+}
+
+bool DcVarPipeline::submit(DcVarSnpResult* result) {
+  result->sequence = nextSequence++;
+  if(!formatQueue.push(result)) {
+    delete result;
+    return false;
+  }
+
+  return true;
+}
+
+void DcVarPipeline::finish() {
+  if(!started) {
+    return;
+  }
+  formatQueue.close();
+  for(unsigned int t=0; t < formatters.size(); ++t) {
+    formatters[t].join();
+  }
+  writeQueue.close();
+  for(unsigned int t=0; t < writers.size(); ++t) {
+    writers[t].join();
+  }
+  formatters.clear();
+  writers.clear();
+  started = false;
+}
+
+void DcVarPipeline::formatLoop() {
+  DcVarSnpResult* result = 0;
+  while(formatQueue.pop(result)) {
+    // same layout as DcVar::WriteResults
+    stringstream ss;
+    ss << "SNP\tGene1\tGene2\tZ\tP\n";
+    for(unsigned int k=0; k < result->pairs.size(); ++k) {
+      const DcVarPairResult& pairResult = result->pairs[k];
+      ss << result->snpName << "\t"
+        << genes[pairResult.gene1] << "\t"
+        << genes[pairResult.gene2] << "\t"
+        << pairResult.z << "\t" << pairResult.p << "\n";
+    }
+    result->text = ss.str();
+    vector<DcVarPairResult>().swap(result->pairs);
+    writeQueue.push(result);
+  }
+}
+
+void DcVarPipeline::writeLoop() {
+  DcVarSnpResult* result = 0;
+  while(writeQueue.pop(result)) {
+    // every SNP gets a file, header only without passing pairs, as with
+    // WriteResults
+    string newFile = result->filename + ".gz";
+    ZOutput resultsFile(newFile, true);
+    resultsFile << result->text;
+    resultsFile.close();
+    markWritten(result);
+    delete result;
+  }
+}
+
+void DcVarPipeline::markWritten(DcVarSnpResult* result) {
+  lock_guard<mutex> guard(checkpointLock);
+  ++numWritten;
+  writtenAhead[result->sequence] = make_pair(result->snpIndex, result->snpName);
+  bool advanced = false;
+  pair<unsigned int, string> lastWritten;
+  map<unsigned int, pair<unsigned int, string> >::iterator it =
+    writtenAhead.find(writtenFrontier);
+  while(it != writtenAhead.end()) {
+    lastWritten = it->second;
+    writtenAhead.erase(it);
+    ++writtenFrontier;
+    advanced = true;
+    it = writtenAhead.find(writtenFrontier);
+  }
+  if(advanced) {
+    // same format as DcVar::WriteCheckpoint
+    ofstream checkpointFile(checkpointFilename.c_str());
+    checkpointFile << lastWritten.first << endl << lastWritten.second << endl;
+    checkpointFile.close();
+  }
+}
@@ -0,0 +1,73 @@
+/*==============================================================================
+ *
+ * Filename:  DcVarPipeline.h
+ *
+ * Description:  Asynchronous output stages for dcVar. The SNP loop hands the
+ * passing gene pairs of each SNP to formatter threads, which build the text
+ * of the results file, and writer threads, which compress and write it, so
+ * the next SNP is computed while earlier ones are written. Bounded queues
+ * between the stages cap the number of SNP results held in memory. The
+ * checkpoint records the last SNP for which all earlier SNPs are written.
+ * =============================================================================
+ */
+
+#ifndef __DCVAR_PIPELINE_H__
+#define __DCVAR_PIPELINE_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+
+#include "BoundedQueue.h"
+
+struct DcVarPairResult {
+  unsigned int gene1;
+  unsigned int gene2;
+  double z;
+  double p;
+};
+
+struct DcVarSnpResult {
+  unsigned int sequence;
+  unsigned int snpIndex;
+  std::string snpName;
+  std::string filename;
+  std::vector<DcVarPairResult> pairs;
+  std::string text;
+};
+
+class DcVarPipeline {
+public:
+  DcVarPipeline(const std::vector<std::string>& geneNames,
+                std::string checkpointFile, unsigned int numThreads,
+                unsigned int queueSize);
+  ~DcVarPipeline();
+  void start();
+  // takes ownership; blocks while the formatter queue is full
+  bool submit(DcVarSnpResult* result);
+  // drain the queues and join all threads
+  void finish();
+  unsigned int getNumWritten() const { return numWritten; }
+private:
+  void formatLoop();
+  void writeLoop();
+  void markWritten(DcVarSnpResult* result);
+  const std::vector<std::string>& genes;
+  std::string checkpointFilename;
+  unsigned int threadsPerStage;
+  BoundedQueue<DcVarSnpResult*> formatQueue;
+  BoundedQueue<DcVarSnpResult*> writeQueue;
+  std::vector<std::thread> formatters;
+  std::vector<std::thread> writers;
+  bool started;
+  unsigned int nextSequence;
+  // written SNPs past the first gap in submission order
+  std::mutex checkpointLock;
+  unsigned int writtenFrontier;
+  std::map<unsigned int, std::pair<unsigned int, std::string> > writtenAhead;
+  unsigned int numWritten;
+};
+
+#endif
@@ -11,22 +11,30 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <map>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 
 #include <armadillo>
 
+#include <omp.h>
+
 #include "plink.h"
 #include "model.h"
 #include "linear.h"
+#include "lapackf.h"
 #include "stats.h"
 #include "helper.h"
+#include "ModelContext.h"
 
 #include "EpistasisEQtl.h"
 #include "Insilico.h"
 
 using namespace std;
 
-EpistasisEQtl::EpistasisEQtl() {
+EpistasisEQtl::EpistasisEQtl(): 
+  modelContext(MODEL_CONTEXT_COVARS_BEFORE_EPI, true) {
   radius = -1;
   localCis = false;
   tfMode = false;
@@ -37,6 +45,12 @@ EpistasisEQtl::EpistasisEQtl() {
   exprFilename = par::iqtl_expression_file;
   cordFilename = par::iqtl_coord_file;
   fullInteraction = par::iqtl_interaction_full;
+  streamResults = false;
+  streamSorted = false;
+  streamRecordsWritten = 0;
+  partitionIndex = 1;
+  numPartitions = 1;
+  resumeRun = false;
 }
 
 EpistasisEQtl::~EpistasisEQtl() {
@@ -124,17 +138,27 @@ bool EpistasisEQtl::Run() {
   PP->printLOG(Timestamp() + "iQTL linear regression loop for all RNA-Seq transcripts\n");
   PrintState();
   
+  // --------------------------------------------------------------------------
+  // partitions write their own summary files and checkpoint
+  runPrefix = par::output_file_name;
+  if(numPartitions > 1) {
+    runPrefix += ".part" + int2str(partitionIndex) + "of" + 
+      int2str(numPartitions);
+  }
+  checkpointFilename = runPrefix + ".iqtl.chk";
+  ios_base::openmode summaryMode = resumeRun? ios::app: ios::out;
+
   // --------------------------------------------------------------------------
   // keep track of loop parameters and number of tests done and write to file
-  string testnumbersFilename = par::output_file_name + ".testnumbers.txt";
+  string testnumbersFilename = runPrefix + ".testnumbers.txt";
   PP->printLOG(Timestamp() + "Writing test results to [ " + testnumbersFilename + " ]\n");
   std::ofstream TESTNUMBERS;
-  TESTNUMBERS.open(testnumbersFilename, ios::out);
+  TESTNUMBERS.open(testnumbersFilename, summaryMode);
 
-  string loopInfoFilename = par::output_file_name + ".loopinfo.txt";
+  string loopInfoFilename = runPrefix + ".loopinfo.txt";
   PP->printLOG(Timestamp() + "Writing loop information to [ " + loopInfoFilename + " ]\n");
   std::ofstream LOOPINFO;
-  LOOPINFO.open(loopInfoFilename, ios::out);
+  LOOPINFO.open(loopInfoFilename, summaryMode);
 
   // --------------------------------------------------------------------------
   // determine SNPs in outer loop; considers transcription factor mode
@@ -159,6 +183,60 @@ bool EpistasisEQtl::Run() {
     PP->printLOG(Timestamp() + "nOuterLoop SNPs: " + int2str(nOuterLoop) + "\n");
   }
 
+  // --------------------------------------------------------------------------
+  // --------------------------------------------------------------------------
+  // transcripts of this partition still to run
+  vector<bool> runTranscript;
+  ScheduleTranscripts(runTranscript);
+
+  // --------------------------------------------------------------------------
+  // one compressed results file for all transcripts instead of dense
+  // per-transcript results matrices and files; a resumed run starts a new 
+  // file so results of completed transcripts are kept
+  string streamFilename = runPrefix + ".iqtl.txt.gz";
+  if(resumeRun) {
+    uint numCompleted = count(runTranscript.begin(), runTranscript.end(), false);
+    streamFilename = runPrefix + ".iqtl.resume" + int2str(numCompleted) + 
+      ".txt.gz";
+  }
+  // p-value counts of the transcripts run here, named like the stream file
+  histogramFilename = runPrefix + ".iqtl.phist";
+  if(resumeRun) {
+    uint numCompleted = count(runTranscript.begin(), runTranscript.end(), false);
+    histogramFilename = runPrefix + ".iqtl.resume" + int2str(numCompleted) + 
+      ".phist";
+  }
+  pvalueHistogram.clear();
+  threadHistograms.assign(omp_get_max_threads(), PvalueHistogram());
+  if(par::save_pvalue_histogram) {
+    PP->printLOG(Timestamp() + "Writing p-value histogram to [ " + 
+      histogramFilename + " ]\n");
+  }
+  if(streamResults) {
+    PP->printLOG(Timestamp() + "Streaming iQTL results to [ " + 
+      streamFilename + " ]\n");
+    streamFile.open(streamFilename, true);
+    if(tfMode) {
+      streamFile << "SnpA\tSnpB\tTranscript\tTF\tCoef\tP\n";
+    } else {
+      streamFile << "SnpA\tSnpB\tTranscript\tCoef\tP\n";
+    }
+    threadRecords.resize(omp_get_max_threads());
+    streamRecordsWritten = 0;
+  }
+
+  // --------------------------------------------------------------------------
+  // cis-trans transcripts with complete expression are fit in blocks: each
+  // SNP pair design is factored once for all transcripts of the block
+  bool batchTranscripts = (par::iqtl_transcript_batch > 1) && !fullInteraction;
+  map<uint, uint> batchSlots;
+  vector<arma::mat> batchBetas;
+  vector<arma::mat> batchPvals;
+  if(batchTranscripts) {
+    PP->printLOG(Timestamp() + "iQTL transcript batch size: " + 
+      int2str(par::iqtl_transcript_batch) + "\n");
+  }
+
   // --------------------------------------------------------------------------
   // for each transcript build main effect and epistasis regression models
   string thisTranscript;
@@ -166,12 +244,16 @@ bool EpistasisEQtl::Run() {
       transcriptIndex < PP->nlistname.size(); 
       ++transcriptIndex) {
     
+    if(!runTranscript[transcriptIndex]) {
+      continue;
+    }
     thisTranscript = PP->nlistname[transcriptIndex];
     PP->printLOG("---------------------------------------------------------\n");
     PP->printLOG(Timestamp() + "Transcript: " + thisTranscript + "\n");
 
     // get SNP indices for the transcript
     nInnerLoop = PP->nl_all;
+    thisTranscriptSnpIndices.clear();
     // GetSnpsForTranscript takes locl-cis into account
     if(!GetSnpsForTranscript(thisTranscript, thisTranscriptSnpIndices)) {
       error("Could not get SNPs for transcript");
@@ -184,6 +266,9 @@ bool EpistasisEQtl::Run() {
     
     if(!(nInnerLoop * nOuterLoop)) {
       PP->printLOG("WARNING: no interactions for: " + thisTranscript + "\n");
+      // resumed runs add up the same test numbers as uninterrupted ones
+      TESTNUMBERS << thisTranscript << "\t" << 0 << endl;
+      WriteTranscriptCheckpoint(thisTranscript);
       continue; // to next transcript
     }
     
@@ -212,36 +297,98 @@ bool EpistasisEQtl::Run() {
 
     // EQTL -------------------------------------------------------------------
     PP->printLOG(Timestamp() + "Running main effects regression models\n");
-    RunEqtl(thisTranscript);
+    RunEqtl(thisTranscript, thisTFSnpNames);
     
     // IQTL -----------------------------------------------------------------
     PP->printLOG(Timestamp() + "Running interaction effects regression models\n");
-    // allocate results matrices
-    resultsMatrixBetas.resize(nOuterLoop, nInnerLoop);
-    resultsMatrixBetas.zeros();
-    resultsMatrixPvals.resize(nOuterLoop, nInnerLoop);
-    resultsMatrixPvals.ones();
+    // allocate results matrices; streamed results are buffered per thread
+    if(streamResults) {
+      resultsMatrixBetas.reset();
+      resultsMatrixPvals.reset();
+    } else {
+      resultsMatrixBetas.resize(nOuterLoop, nInnerLoop);
+      resultsMatrixBetas.zeros();
+      resultsMatrixPvals.resize(nOuterLoop, nInnerLoop);
+      resultsMatrixPvals.ones();
+    }
     if(fullInteraction) {
       RunIqtlFull();
     } else {
-      RunIqtlCisTrans();
+      if(batchTranscripts && !batchSlots.count(transcriptIndex) && 
+         IsExpressionComplete(transcriptIndex)) {
+        // start a new block at this transcript
+        vector<uint> blockTranscripts;
+        for(uint nextIndex = transcriptIndex; 
+            (nextIndex < PP->nlistname.size()) && 
+            (blockTranscripts.size() < (uint) par::iqtl_transcript_batch);
+            ++nextIndex) {
+          if(runTranscript[nextIndex] && IsExpressionComplete(nextIndex)) {
+            blockTranscripts.push_back(nextIndex);
+          }
+        }
+        batchSlots.clear();
+        for(uint slot=0; slot < blockTranscripts.size(); ++slot) {
+          batchSlots[blockTranscripts[slot]] = slot;
+        }
+        if(!RunIqtlCisTransBatch(blockTranscripts, batchBetas, batchPvals)) {
+          error("iQTL transcript batch failed at: " + thisTranscript);
+        }
+      }
+      map<uint, uint>::const_iterator slotIt = batchSlots.find(transcriptIndex);
+      if(slotIt != batchSlots.end()) {
+        if(streamResults) {
+          arma::mat& slotBetas = batchBetas[slotIt->second];
+          arma::mat& slotPvals = batchPvals[slotIt->second];
+          for(uint ii=0; ii < slotPvals.n_rows; ++ii) {
+            for(uint jj=0; jj < slotPvals.n_cols; ++jj) {
+              SetResult(ii, jj, slotBetas(ii, jj), slotPvals(ii, jj));
+            }
+          }
+        } else {
+          resultsMatrixBetas = batchBetas[slotIt->second];
+          resultsMatrixPvals = batchPvals[slotIt->second];
+        }
+        // release the block results as they are consumed
+        batchBetas[slotIt->second].reset();
+        batchPvals[slotIt->second].reset();
+      } else {
+        RunIqtlCisTrans();
+      }
     }
 
     // ------------------------------------------------------------------------
     PP->printLOG(Timestamp() + "write regression results\n");
-    string iqtlFilename = par::output_file_name + "." + 
-      thisTranscript + ".iqtl.txt";
-    if(!WriteResults(iqtlFilename, thisTranscript, thisTFSnpNames)) {
-      error("Failed to write iQTL results file: " + iqtlFilename);
+    if(streamResults) {
+      if(!WriteStreamRecords(thisTranscript, thisTFSnpNames)) {
+        error("Failed to write iQTL results to: " + streamFilename);
+      }
+    } else {
+      string iqtlFilename = par::output_file_name + "." + 
+        thisTranscript + ".iqtl.txt";
+      if(!WriteResults(iqtlFilename, thisTranscript, thisTFSnpNames)) {
+        error("Failed to write iQTL results file: " + iqtlFilename);
+      }
     }
     
     PP->printLOG(Timestamp() + "Writing statistical test numbers to: " + testnumbersFilename + "\n");
     PP->printLOG(Timestamp() + "Total models:\t" + int2str(nOuterLoop * nInnerLoop) + "\n");
     TESTNUMBERS << thisTranscript << "\t" << (nOuterLoop * nInnerLoop) << endl;
+    WriteTranscriptCheckpoint(thisTranscript);
   } // END for each transcript loop
   
   TESTNUMBERS.close();
   LOOPINFO.close();
+  if(streamResults) {
+    streamFile.close();
+    PP->printLOG(Timestamp() + "Wrote [ " + longint2str(streamRecordsWritten) + 
+      " ] iQTL results to [ " + streamFilename + " ]\n");
+  }
+  if(par::save_pvalue_histogram) {
+    pvalueHistogram.save(histogramFilename);
+    PP->printLOG(Timestamp() + "Wrote p-value histogram of [ " + 
+      longint2str(pvalueHistogram.getNumTests()) + " ] tests to [ " + 
+      histogramFilename + " ]\n");
+  }
   
   PP->printLOG(Timestamp() + "iQTL analysis finished\n");
 
@@ -262,81 +409,231 @@ bool EpistasisEQtl::RunIqtlCisTrans() {
   }
   uint badModelsTotal = 0;
   uint goodModelsTotal = 0;
-  uint threadGoodModels = 0;
-  uint threadBadModels = 0;
-  #pragma omp parallel for
-  for(uint ii=0; ii < nOuterLoop; ++ii) {
-    for(uint jj=0; jj < nInnerLoop; ++jj) {
-      // cout << "Looping indices: " << "\t" << ii << "\t" << jj << endl;
-      uint snpAIndex = thisTFSnpIndices[ii];
-      string snpAName = PP->locus[snpAIndex]->name;
-      uint snpBIndex = thisTranscriptSnpIndices[jj];
-      string snpBName = PP->locus[snpBIndex]->name;
-      Model* interactionModel = new LinearModel(PP);
-      interactionModel->setMissing();
-      interactionModel->addAdditiveSNP(snpAIndex);
-      interactionModel->label.push_back(snpAName);
-      interactionModel->addAdditiveSNP(snpBIndex);
-      interactionModel->label.push_back(snpBName);
-      if(par::covar_file) {
-        for(uint kk = 0; kk < par::clist_number; kk++) {
-          interactionModel->addCovariate(kk);
-          interactionModel->label.push_back(PP->clistname[kk]);
-        }
+  // (outer SNP, inner SNP) pairs in one dynamically scheduled loop so small
+  // cis windows or few TF SNPs still keep all threads busy
+  long numPairs = (long) nOuterLoop * nInnerLoop;
+  #pragma omp parallel for schedule(dynamic, 64) \
+    reduction(+:goodModelsTotal,badModelsTotal)
+  for(long k=0; k < numPairs; ++k) {
+    uint ii = k / nInnerLoop;
+    uint jj = k % nInnerLoop;
+    uint snpAIndex = thisTFSnpIndices[ii];
+    uint snpBIndex = thisTranscriptSnpIndices[jj];
+    // testParameter is the interaction term, after any covariates
+    Model* interactionModel = modelContext.reset(snpAIndex, snpBIndex);
+    interactionModel->buildDesignMatrix();
+    interactionModel->fitLM();
+    bool badModel = false;
+    if(!interactionModel->isValid()) {
+      if(par::verbose) {
+        #pragma omp critical
+        PP->printLOG(Timestamp() + "WARNING: outer index " + int2str(ii) + 
+          " inner index " + int2str(jj) + " linear model fitLM(): invalid\n");
       }
-      interactionModel->addInteraction(1, 2);
-      interactionModel->label.push_back("EPI");
-      interactionModel->buildDesignMatrix();
-      uint modelFitParamIdx = 3;
-      // add # covars to test param to get interaction param
-      if(par::covar_file) {
-        modelFitParamIdx += par::clist_number;
+      badModel = true;
+    }
+    if(!interactionModel->fitConverged()) {
+      if(par::verbose) {
+        #pragma omp critical
+        PP->printLOG(Timestamp() + "WARNING: linear model fitLM(): failed to converge: SNP A: " + 
+          PP->locus[snpAIndex]->name + ", SNP B: " + 
+          PP->locus[snpBIndex]->name + "\n");
       }
-      interactionModel->testParameter = modelFitParamIdx; // interaction
-      interactionModel->fitLM();
-      bool badModel = false;
-      if(!interactionModel->isValid()) {
-        if(par::verbose) {
-          PP->printLOG(Timestamp() + "WARNING: outer index " + int2str(ii) + 
-            " inner index " + int2str(jj) + " linear model fitLM(): invalid\n");
-        }
-        badModel = true;
+      badModel = true;
+    }
+    // each pair owns its result cell or appends to its thread's buffer;
+    // the p-values go through dcdflib cdft, which keeps static state
+    if(!badModel) {
+      ++goodModelsTotal;
+      vector_t betaInteractionCoefs = interactionModel->getCoefs();
+      double interactionValue = 
+        betaInteractionCoefs[betaInteractionCoefs.size() - 1];
+      vector_t betaInteractionCoefPVals;
+      #pragma omp critical
+      betaInteractionCoefPVals = interactionModel->getPVals();
+      double interactionPval =
+        betaInteractionCoefPVals[betaInteractionCoefPVals.size() - 1];
+      SetResult(ii, jj, interactionValue, interactionPval);
+    } else {
+      ++badModelsTotal;
+      SetResult(ii, jj, 0.0, 1.0);
+    }
+  }
+  goodModels = goodModelsTotal;
+  badModels = badModelsTotal;
+  PP->printLOG(Timestamp() + "iQTL Cis Trans total good models: " + int2str(goodModels) +
+    ", bad models: " + int2str(badModels) + "\n");
+  
+  return true;
+}
+
+bool EpistasisEQtl::RunIqtlCisTransBatch(vector<uint>& transcriptIndices,
+  vector<arma::mat>& batchBetas, vector<arma::mat>& batchPvals) {
+  uint numTranscripts = transcriptIndices.size();
+  PP->printLOG(Timestamp() + "iQTL Cis-Trans transcript batch: " + 
+    int2str(numTranscripts) + " transcripts starting at " + 
+    PP->nlistname[transcriptIndices[0]] + "\n");
+  
+  // inner loop SNPs of each transcript; each SNP B keeps the list of 
+  // transcripts, and their inner loop columns, that test it
+  map<uint, vector<pair<uint, uint> > > snpTranscripts;
+  batchBetas.resize(numTranscripts);
+  batchPvals.resize(numTranscripts);
+  for(uint t=0; t < numTranscripts; ++t) {
+    vector<uint> transcriptSnps;
+    GetSnpsForTranscript(PP->nlistname[transcriptIndices[t]], transcriptSnps);
+    for(uint jj=0; jj < transcriptSnps.size(); ++jj) {
+      snpTranscripts[transcriptSnps[jj]].push_back(make_pair(t, jj));
+    }
+    batchBetas[t].zeros(nOuterLoop, transcriptSnps.size());
+    batchPvals[t].ones(nOuterLoop, transcriptSnps.size());
+  }
+  vector<uint> innerSnps;
+  vector<arma::uvec> innerColumns;
+  map<uint, vector<pair<uint, uint> > >::const_iterator snpIt;
+  for(snpIt = snpTranscripts.begin(); snpIt != snpTranscripts.end(); ++snpIt) {
+    innerSnps.push_back(snpIt->first);
+    arma::uvec columns(snpIt->second.size());
+    for(uint l=0; l < snpIt->second.size(); ++l) {
+      columns(l) = snpIt->second[l].first;
+    }
+    innerColumns.push_back(columns);
+  }
+  
+  // expression of the block: individuals x transcripts
+  arma::mat expression(PP->n, numTranscripts);
+  for(uint i=0; i < PP->n; ++i) {
+    for(uint t=0; t < numTranscripts; ++t) {
+      expression(i, t) = PP->sample[i]->nlist[transcriptIndices[t]];
+    }
+  }
+
+  long numInner = innerSnps.size();
+  long numPairs = (long) nOuterLoop * numInner;
+  uint goodModelsTotal = 0;
+  uint badModelsTotal = 0;
+  // SNP A, SNP B, covariates, A x B: the design does not depend on the
+  // transcript, all transcripts are complete so missingness does not either
+  #pragma omp parallel for schedule(dynamic, 16) reduction(+:goodModelsTotal,badModelsTotal)
+  for(long k=0; k < numPairs; ++k) {
+    uint ii = k / numInner;
+    uint bb = k % numInner;
+    uint snpAIndex = thisTFSnpIndices[ii];
+    uint snpBIndex = innerSnps[bb];
+    const vector<pair<uint, uint> >& pairColumns = 
+      snpTranscripts.find(snpBIndex)->second;
+    Model* interactionModel = modelContext.reset(snpAIndex, snpBIndex);
+    interactionModel->buildDesignMatrix();
+    vector<bool> missing = interactionModel->getMissing();
+    uint nind = interactionModel->X.size();
+    uint np = nind? interactionModel->X[0].size(): 0;
+    arma::uvec rows(nind);
+    uint nrow = 0;
+    for(uint i=0; (i < missing.size()) && (nrow < nind); ++i) {
+      if(!missing[i]) {
+        rows(nrow++) = i;
       }
-      if(!interactionModel->fitConverged()) {
-        if(par::verbose) {
-          PP->printLOG(Timestamp() + "WARNING: linear model fitLM(): failed to converge: SNP A: " + 
-            snpAName + ", SNP B: " + snpBName + "\n");
-        }
-        badModel = true;
+    }
+    arma::mat X(nind, np);
+    for(uint i=0; i < nind; ++i) {
+      for(uint j=0; j < np; ++j) {
+        X(i, j) = interactionModel->X[i][j];
       }
-      #pragma omp critical
-      {
-        if(!badModel) {
-          ++threadGoodModels;
-          ++goodModelsTotal;
-          vector_t betaInteractionCoefs = interactionModel->getCoefs();
-          double interactionValue = 
-            betaInteractionCoefs[betaInteractionCoefs.size() - 1];
-          vector_t betaInteractionCoefPVals = interactionModel->getPVals();
-          double interactionPval =
-            betaInteractionCoefPVals[betaInteractionCoefPVals.size() - 1];
-          // double interactionPval = ((LinearModel*) interactionModel)->getPValue();
-          resultsMatrixBetas(ii, jj) = interactionValue;
-          resultsMatrixPvals(ii, jj) = interactionPval;
-        } else {
-          ++threadBadModels;
+    }
+    if(!interactionModel->isValid() || (nrow != nind)) {
+      if(par::verbose) {
+        #pragma omp critical
+        PP->printLOG(Timestamp() + "WARNING: linear model batch fit invalid: SNP A: " + 
+          PP->locus[snpAIndex]->name + ", SNP B: " + 
+          PP->locus[snpBIndex]->name + "\n");
+      }
+      badModelsTotal += pairColumns.size();
+      continue;
+    }
+    // the batch uses the Cholesky inverse, and its conditioning test, that 
+    // LinearModel::fitLM tries first; any design it rejects is fit per 
+    // transcript by fitLM and its QR and SVD fallbacks
+    vector_t XtXinvValues;
+    bool batchFit = (par::linear_solver == "cholesky") && (nind > np) && 
+      (np > 0);
+    if(batchFit) {
+      arma::mat XtX = X.t() * X;
+      XtXinvValues.assign(XtX.begin(), XtX.end());
+      batchFit = sym_inverse_lapack(np, XtXinvValues);
+    }
+    if(!batchFit) {
+      LinearModel* linearModel = static_cast<LinearModel*>(interactionModel);
+      vector_t y(nrow);
+      for(uint l=0; l < pairColumns.size(); ++l) {
+        uint t = pairColumns[l].first;
+        uint jj = pairColumns[l].second;
+        for(uint i=0; i < nrow; ++i) {
+          y[i] = expression(rows(i), t);
+        }
+        linearModel->setDependent(y);
+        linearModel->fitLM();
+        if(!linearModel->isValid() || !linearModel->fitConverged()) {
           ++badModelsTotal;
-          resultsMatrixBetas(ii, jj) = 0.0;
-          resultsMatrixPvals(ii, jj) = 1.0;
+          continue;
         }
+        vector_t pairCoefs = linearModel->getCoefs();
+        vector_t pairPvals;
+        #pragma omp critical
+        pairPvals = linearModel->getPVals();
+        batchBetas[t](ii, jj) = pairCoefs[pairCoefs.size() - 1];
+        batchPvals[t](ii, jj) = pairPvals[pairPvals.size() - 1];
+        ++goodModelsTotal;
+      }
+      continue;
+    }
+    arma::mat XtXinv(&XtXinvValues[0], np, np);
+    // coefficients and residual sums of squares for all transcripts at once
+    arma::mat Y = expression.submat(rows, innerColumns[bb]);
+    arma::mat coefs = XtXinv * (X.t() * Y);
+    arma::rowvec rss = arma::sum(arma::square(Y - X * coefs), 0);
+    uint q = np - 1;
+    double df = nind - np;
+    // same test as LinearModel::getPValue; pT goes through dcdflib cdft,
+    // which keeps static state, so all p-values of the block are taken in
+    // one critical section
+    vector<double> tStats(pairColumns.size(), 0);
+    vector<bool> testable(pairColumns.size(), false);
+    for(uint l=0; l < pairColumns.size(); ++l) {
+      double var = XtXinv(q, q) * rss(l) / df;
+      if((var >= 1e-20) && realnum(var)) {
+        tStats[l] = coefs(q, l) / sqrt(var);
+        testable[l] = true;
+      }
+    }
+    vector<double> pvals(pairColumns.size(), 1);
+    #pragma omp critical
+    for(uint l=0; l < pairColumns.size(); ++l) {
+      if(testable[l]) {
+        pvals[l] = pT(tStats[l], df);
       }
-      delete interactionModel;
+    }
+    for(uint l=0; l < pairColumns.size(); ++l) {
+      uint t = pairColumns[l].first;
+      uint jj = pairColumns[l].second;
+      batchBetas[t](ii, jj) = coefs(q, l);
+      batchPvals[t](ii, jj) = pvals[l];
+      ++goodModelsTotal;
     }
   }
   goodModels = goodModelsTotal;
   badModels = badModelsTotal;
-  PP->printLOG(Timestamp() + "iQTL Cis Trans total good models: " + int2str(goodModels) +
-    ", bad models: " + int2str(badModels) + "\n");
+  PP->printLOG(Timestamp() + "iQTL Cis Trans batch total good models: " + 
+    int2str(goodModels) + ", bad models: " + int2str(badModels) + "\n");
+  
+  return true;
+}
+
+bool EpistasisEQtl::IsExpressionComplete(uint transcriptIndex) {
+  for(uint i=0; i < PP->n; ++i) {
+    if(!realnum(PP->sample[i]->nlist[transcriptIndex])) {
+      return false;
+    }
+  }
   
   return true;
 }
@@ -344,97 +641,126 @@ bool EpistasisEQtl::RunIqtlCisTrans() {
 bool EpistasisEQtl::RunIqtlFull() {
   PP->printLOG(Timestamp() + "iQTL linear regression loop: Full SNP x SNP\n");
   uint numSnps = PP->nl_all;
-#pragma omp parallel
-  for(uint ii=0; ii < numSnps; ++ii) {
-    if(ii && (ii % 1000 == 0)) {
-      cout << ii << "/" << numSnps << endl;
+  if((nOuterLoop < numSnps) || (nInnerLoop < numSnps)) {
+    error("iQTL full interaction mode requires all SNPs in both loops");
+  }
+  if(numSnps < 2) {
+    return true;
+  }
+  // all pairs ii < jj, triangular loop manually expanded as in Regain::run:
+  // fold the n' x n' lower triangle (with diagonal), n' = numSnps - 1, and
+  // shift the column; dynamic chunks balance the uneven model fits
+  long numFolded = numSnps - 1;
+  long numPairs = numFolded * (numFolded + 1) / 2;
+  long progressStep = numPairs / 100;
+  if(progressStep < 1) {
+    progressStep = 1;
+  }
+  long pairsDone = 0;
+  uint goodModelsTotal = 0;
+  uint badModelsTotal = 0;
+  #pragma omp parallel for schedule(dynamic, 256) \
+    reduction(+:goodModelsTotal,badModelsTotal)
+  for(long k=0; k < numPairs; ++k) {
+    uint snpBIndex = k / (numFolded + 1);
+    uint snpAIndex = k % (numFolded + 1);
+    if(snpAIndex > snpBIndex) {
+      snpBIndex = numFolded - snpBIndex - 1;
+      snpAIndex = numFolded - snpAIndex;
     }
-    for(uint jj=ii+1; jj < numSnps; ++jj) {
-      uint snpAIndex = ii;
-      string snpAName = PP->locus[snpAIndex]->name;
-      uint snpBIndex = jj;
-      string snpBName = PP->locus[snpBIndex]->name;
-      Model* interactionModel = new LinearModel(PP);
-      interactionModel->setMissing();
-      interactionModel->addAdditiveSNP(snpAIndex);
-      interactionModel->label.push_back(snpAName);
-      interactionModel->addAdditiveSNP(snpBIndex);
-      interactionModel->label.push_back(snpBName);
-      if(par::covar_file) {
-        for(uint kk = 0; kk < par::clist_number; kk++) {
-          interactionModel->addCovariate(kk);
-          interactionModel->label.push_back(PP->clistname[kk]);
-        }
-      }
-      interactionModel->addInteraction(1, 2);
-      interactionModel->label.push_back("EPI");
-      interactionModel->buildDesignMatrix();
-      uint modelFitParamIdx = 3;
-      // add # covars to test param to get interaction param
-      if(par::covar_file) {
-        modelFitParamIdx += par::clist_number;
-      }
-      interactionModel->testParameter = modelFitParamIdx; // interaction
-      interactionModel->fitLM();
-#pragma omp critical
-{          
+    ++snpBIndex;
+    Model* interactionModel = modelContext.reset(snpAIndex, snpBIndex);
+    interactionModel->buildDesignMatrix();
+    interactionModel->fitLM();
+    // each pair owns its result cells; only the p-values, from dcdflib 
+    // cdft with its static state, need the critical section
+    if(interactionModel->isValid() && interactionModel->fitConverged()) {
+      ++goodModelsTotal;
       vector_t betaInteractionCoefs = interactionModel->getCoefs();
-      double interactionValue = 
-        betaInteractionCoefs[betaInteractionCoefs.size() - 1];
-      vector_t betaInteractionCoefPVals = interactionModel->getPVals();
-      double interactionPval =
-        betaInteractionCoefPVals[betaInteractionCoefPVals.size() - 1];
-      resultsMatrixBetas(ii, jj) = interactionValue;
-      resultsMatrixPvals(ii, jj) = interactionPval;
-}
-      delete interactionModel;
+      vector_t betaInteractionCoefPVals;
+      #pragma omp critical
+      betaInteractionCoefPVals = interactionModel->getPVals();
+      SetResult(snpAIndex, snpBIndex, 
+        betaInteractionCoefs[betaInteractionCoefs.size() - 1],
+        betaInteractionCoefPVals[betaInteractionCoefPVals.size() - 1]);
+    } else {
+      ++badModelsTotal;
+      SetResult(snpAIndex, snpBIndex, 0.0, 1.0);
+    }
+    long thisPairsDone;
+    #pragma omp atomic capture
+    thisPairsDone = ++pairsDone;
+    if(thisPairsDone % progressStep == 0) {
+      #pragma omp critical
+      PP->printLOG(Timestamp() + "iQTL full: " + 
+                   int2str(thisPairsDone * 100 / numPairs) + "% of " +
+                   longint2str(numPairs) + " SNP pairs\n");
     }
   }
+  goodModels = goodModelsTotal;
+  badModels = badModelsTotal;
+  PP->printLOG(Timestamp() + "iQTL full total good models: " + 
+               int2str(goodModels) + ", bad models: " + 
+               int2str(badModels) + "\n");
     
   return true;
 }
 
-bool EpistasisEQtl::RunEqtl(string transcript) {
+bool EpistasisEQtl::RunEqtl(string transcript, vector<string>& tfSnpNames) {
+  // main effect models: SNP, covariates
+  uint numSnps = thisTFSnpIndices.size();
+  vector<double> mainEffectValues(numSnps, 0);
+  vector<double> mainEffectPValues(numSnps, 1);
+  #pragma omp parallel for schedule(dynamic, 64)
+  for(uint i=0; i < numSnps; ++i) {
+    Model* mainEffectModel = modelContext.reset(thisTFSnpIndices[i]);
+    mainEffectModel->buildDesignMatrix();
+    mainEffectModel->fitLM();
+    // obtain estimates and statistics
+    uint modelFitParamIdx = mainEffectModel->testParameter;
+    vector_t betaMainEffectCoefs = mainEffectModel->getCoefs();
+    mainEffectValues[i] = betaMainEffectCoefs[modelFitParamIdx];
+    // p-values don't include intercept term; pT is not reentrant
+    vector_t betaMainEffectCoefPvals;
+    #pragma omp critical
+    betaMainEffectCoefPvals = mainEffectModel->getPVals();
+    mainEffectPValues[i] = betaMainEffectCoefPvals[modelFitParamIdx-1];
+  }
+
+  if(streamResults) {
+    // same columns as the interaction records, without a SNP B
+    uint numStreamed = 0;
+    for(uint i=0; i < numSnps; ++i) {
+      if(!PassesThreshold(mainEffectPValues[i])) {
+        continue;
+      }
+      stringstream ss;
+      ss << PP->locus[thisTFSnpIndices[i]]->name << "\tNA\t" 
+        << transcript << "\t";
+      if(tfMode) {
+        ss << tfSnpNames[i] << "\t";
+      }
+      ss << mainEffectValues[i] << "\t" << mainEffectPValues[i] << "\n";
+      streamFile << ss.str();
+      ++numStreamed;
+    }
+    streamRecordsWritten += numStreamed;
+    PP->printLOG(Timestamp() + "Streamed [ " + int2str(numStreamed) + 
+      " ] eQTL results for " + transcript + "\n");
+    return true;
+  }
+
   string eqtlFilename = par::output_file_name + "." + 
     transcript + ".eqtl.txt";
   PP->printLOG(Timestamp() + "RunEqtl writing eQTL results to [ " + eqtlFilename + " ]\n");
   std::ofstream EQTL;
   EQTL.open(eqtlFilename, ios::out);
-  for(uint i=0; i < thisTFSnpIndices.size(); ++i) {
-    uint thisSnpIndex = thisTFSnpIndices[i];
-    string thisSnpName = PP->locus[thisSnpIndex]->name;
-
-    Model* mainEffectModel = new LinearModel(PP);
-    mainEffectModel->setMissing();
-    mainEffectModel->addAdditiveSNP(thisSnpIndex);
-    mainEffectModel->label.push_back(thisSnpName);
-    // add covariates if specified
-    if(par::covar_file) {
-      for(uint k=0; k < par::clist_number; k++) {
-        // add covariate to the model
-        mainEffectModel->addCovariate(k);
-        mainEffectModel->label.push_back(PP->clistname[k]);
-      }
-    }
-    // Build design matrix
-    mainEffectModel->buildDesignMatrix();
-    // Fit linear model
-    uint modelFitParamIdx = 1; 
-    // single variable main effect
-    mainEffectModel->testParameter = modelFitParamIdx; 
-    mainEffectModel->fitLM();
-    // obtain estimates and statistics
-    vector_t betaMainEffectCoefs = mainEffectModel->getCoefs();
-    double mainEffectValue = betaMainEffectCoefs[modelFitParamIdx];
-    // p-values don't include intercept term
-    vector_t betaMainEffectCoefPvals = mainEffectModel->getPVals();
-    double mainEffectPValue = betaMainEffectCoefPvals[modelFitParamIdx-1];
+  for(uint i=0; i < numSnps; ++i) {
     EQTL 
-      << thisSnpName << "\t"
+      << PP->locus[thisTFSnpIndices[i]]->name << "\t"
       << transcript << "\t"
-      << mainEffectValue << "\t"
-      << mainEffectPValue << endl;
-    delete mainEffectModel;
+      << mainEffectValues[i] << "\t"
+      << mainEffectPValues[i] << endl;
   }
   EQTL.close();
 
@@ -619,15 +945,17 @@ bool EpistasisEQtl::SetTF(bool tfFlag) {
 }
 
 bool EpistasisEQtl::GetSnpsForTranscript(string transcript, 
-  vector<uint>& snpIndices) {
-  PP->printLOG(Timestamp() + "Searching for SNPs in transcript [" + transcript + "]\n");
+  vector<uint>& snpIndices, bool logSearch) {
+  if(logSearch) {
+    PP->printLOG(Timestamp() + "Searching for SNPs in transcript [" + transcript + "]\n");
+  }
 
   // get transcript info
   uint chromosome = coordinates[transcript][COORD_CHROM];
   uint bpStart = coordinates[transcript][COORD_BP_START];
   uint bpEnd = coordinates[transcript][COORD_BP_END];
-  uint lowerThreshold = bpStart - radius;
-  uint upperThreshold = bpEnd + radius;
+  long lowerThreshold = (long) bpStart - (long) radius;
+  long upperThreshold = (long) bpEnd + (long) radius;
   
   if(par::algorithm_verbose) {
     cout 
@@ -641,21 +969,15 @@ bool EpistasisEQtl::GetSnpsForTranscript(string transcript,
   }
   
   // find SNPs matching criteria
-  for(uint j=0; j < PP->locus.size(); ++j) {
-    Locus* thisSnp = PP->locus[j];
-    if(thisSnp->chr == chromosome) {
-      if(localCis) {
-        // on the same chromosome and within radius of transcript
-        if((thisSnp->bp >= lowerThreshold) && 
-           (thisSnp->bp <= upperThreshold)) {
-          snpIndices.push_back(j);
-        }
-      }
-      else {
-        // simply on the same chromosome
-        snpIndices.push_back(j);
-      }
-    }
+  if(!locusIndex.isBuilt()) {
+    locusIndex.build(PP->locus);
+  }
+  if(localCis) {
+    // on the same chromosome and within radius of transcript
+    locusIndex.query(chromosome, lowerThreshold, upperThreshold, snpIndices);
+  } else {
+    // simply on the same chromosome
+    locusIndex.queryChromosome(chromosome, snpIndices);
   }
 
   return true;
@@ -665,6 +987,16 @@ bool EpistasisEQtl::GetSnpsForTFs(vector<uint>& snpIndices, vector<string>& tfs)
 
   uint allSnps = PP->locus.size();
   PP->printLOG(Timestamp() + "Searching transcription factors in " + int2str(allSnps) + " SNPs\n");
+  // index the TF ranges extended by the search radius
+  tfIndex.clear();
+  TranscriptFactorTableCIt lutIt = transcriptFactorLUT.begin();
+  for(; lutIt != transcriptFactorLUT.end(); ++lutIt) {
+    const vector<uint>& tfInfo = lutIt->second;
+    tfIndex.add(lutIt->first, tfInfo[COORD_CHROM], 
+                (long) tfInfo[COORD_BP_START] - (long) tfRadius,
+                (long) tfInfo[COORD_BP_END] + (long) tfRadius);
+  }
+  tfIndex.build();
   // for all SNPs
   for(uint thisSnpIndex=0; thisSnpIndex < allSnps; ++thisSnpIndex) {
     if(thisSnpIndex && (thisSnpIndex % 100000 == 0)) {
@@ -685,24 +1017,10 @@ bool EpistasisEQtl::GetSnpsForTFs(vector<uint>& snpIndices, vector<string>& tfs)
 }
 
 bool EpistasisEQtl::IsSnpInTFs(uint chr, uint bp, string& tf) {
-  // linear search through the transcription factor lookup table for SNP at
-  // chr/bp, returning the transcription factor if true, else return false
-  bool found = false;
-  TranscriptFactorTableCIt lutIt = transcriptFactorLUT.begin();
-  while((lutIt != transcriptFactorLUT.end()) && (!found)) {
-    string thisTF = (*lutIt).first;
-    uint thisTfChr = transcriptFactorLUT[thisTF][COORD_CHROM];
-    uint thisTfBpBeg = transcriptFactorLUT[thisTF][COORD_BP_START];
-    uint thisTfBpEnd = transcriptFactorLUT[thisTF][COORD_BP_END];
-    uint rangeStart = thisTfBpBeg - tfRadius;
-    uint rangeEnd = thisTfBpEnd + tfRadius;
-    if((chr == thisTfChr) && ((bp >= rangeStart) &&  (bp <= rangeEnd))) {
-      tf = thisTF;
-      return true;
-    }
-    ++lutIt;
-  }
-  return false;
+  // interval lookup of the SNP at chr/bp in the TF index built by 
+  // GetSnpsForTFs, returning the first transcription factor in name order 
+  // if true, else return false
+  return tfIndex.first(chr, bp, tf);
 }
 
 bool EpistasisEQtl::GetTFInfo(string tf, vector<uint>& tfInfo) {
@@ -731,35 +1049,12 @@ bool EpistasisEQtl::WriteResults(string saveFilename,
     for(uint kk=0; kk < nOuterLoop; ++kk) {
       for(uint ll=0; ll < nInnerLoop; ++ll) {
         double thisInteractionPval = resultsMatrixPvals(kk, ll);
-        if((thisInteractionPval > 0) && 
-           (thisInteractionPval < par::iqtl_pvalue)) {
-          string snpTF = "NA";
-          uint snpAIndex = -1;
-          if(tfMode) {
-            snpAIndex = thisTFSnpIndices[kk];
-            snpTF = saveTFSnpNames[kk];
-          } else {
-            snpAIndex = thisTranscriptSnpIndices[kk];
-          }
-          string snpAName = PP->locus[snpAIndex]->name;
-          uint snpBIndex = thisTranscriptSnpIndices[ll];
-          string snpBName = PP->locus[snpBIndex]->name;
-          if(tfMode) {
-            IQTL_OUT
-              << snpAName << "\t" 
-              << snpBName << "\t"
-              << saveTranscript << "\t"
-              << snpTF << "\t"
-              << resultsMatrixBetas(kk, ll) << "\t"
-              << thisInteractionPval << endl;
-          } else {
-            IQTL_OUT
-              << snpAName << "\t" 
-              << snpBName << "\t"
-              << saveTranscript << "\t"
-              << resultsMatrixBetas(kk, ll) << "\t"
-              << thisInteractionPval << endl;
-          }
+        if(par::save_pvalue_histogram) {
+          pvalueHistogram.add(thisInteractionPval);
+        }
+        if(PassesThreshold(thisInteractionPval)) {
+          IQTL_OUT << FormatResult(kk, ll, resultsMatrixBetas(kk, ll), 
+            thisInteractionPval, saveTranscript, saveTFSnpNames);
         }
       } // nInnerLoop
     } // nOuterLoop
@@ -768,6 +1063,212 @@ bool EpistasisEQtl::WriteResults(string saveFilename,
     return true;
 }
 
+bool EpistasisEQtl::SetStreamResults(bool streamFlag, bool sortFlag) {
+  streamResults = streamFlag;
+  streamSorted = streamFlag && sortFlag;
+  
+  return true;
+}
+
+bool EpistasisEQtl::SetPartition(uint partIndex, uint numParts, bool resume) {
+  if(!numParts || !partIndex || (partIndex > numParts)) {
+    error("iQTL partition must be i/N with 1 <= i <= N, got " + 
+          int2str(partIndex) + "/" + int2str(numParts));
+  }
+  partitionIndex = partIndex;
+  numPartitions = numParts;
+  resumeRun = resume;
+  
+  return true;
+}
+
+static bool transcriptCostOrder(const pair<double, uint>& a, 
+                                const pair<double, uint>& b) {
+  if(a.first != b.first) {
+    return a.first > b.first;
+  }
+  return a.second < b.second;
+}
+
+bool EpistasisEQtl::ScheduleTranscripts(vector<bool>& runTranscript) {
+  uint numTranscripts = PP->nlistname.size();
+  runTranscript.assign(numTranscripts, true);
+  if(numPartitions > 1) {
+    // balance the partitions by the estimated cost nOuterLoop x nInnerLoop:
+    // most expensive transcripts first, each to the least loaded partition;
+    // every job computes the same deterministic assignment
+    vector<pair<double, uint> > transcriptCosts(numTranscripts);
+    for(uint t=0; t < numTranscripts; ++t) {
+      double innerSnps = PP->nl_all;
+      if(!fullInteraction) {
+        vector<uint> transcriptSnps;
+        GetSnpsForTranscript(PP->nlistname[t], transcriptSnps, false);
+        innerSnps = transcriptSnps.size();
+      }
+      // every transcript also costs its eQTL models
+      transcriptCosts[t] = make_pair((double) nOuterLoop * (innerSnps + 1), t);
+    }
+    sort(transcriptCosts.begin(), transcriptCosts.end(), transcriptCostOrder);
+    vector<double> partitionLoads(numPartitions, 0);
+    double thisPartitionLoad = 0;
+    for(uint t=0; t < numTranscripts; ++t) {
+      uint leastLoaded = min_element(partitionLoads.begin(), 
+        partitionLoads.end()) - partitionLoads.begin();
+      partitionLoads[leastLoaded] += transcriptCosts[t].first;
+      if(leastLoaded != (partitionIndex - 1)) {
+        runTranscript[transcriptCosts[t].second] = false;
+      } else {
+        thisPartitionLoad += transcriptCosts[t].first;
+      }
+    }
+    PP->printLOG(Timestamp() + "iQTL partition [ " + int2str(partitionIndex) + 
+      " / " + int2str(numPartitions) + " ] estimated models: " + 
+      dbl2str(thisPartitionLoad) + "\n");
+  }
+  if(resumeRun) {
+    set<string> completedTranscripts;
+    ReadTranscriptCheckpoint(completedTranscripts);
+    for(uint t=0; t < numTranscripts; ++t) {
+      if(completedTranscripts.count(PP->nlistname[t])) {
+        runTranscript[t] = false;
+      }
+    }
+    PP->printLOG(Timestamp() + "Resuming from checkpoint [ " + 
+      checkpointFilename + " ] with [ " + 
+      int2str(completedTranscripts.size()) + " ] completed transcripts\n");
+  } else {
+    // start a fresh checkpoint
+    ofstream checkpointFile(checkpointFilename);
+    checkpointFile.close();
+  }
+  PP->printLOG(Timestamp() + "iQTL transcripts to run: " + 
+    int2str(count(runTranscript.begin(), runTranscript.end(), true)) + 
+    " of " + int2str(numTranscripts) + "\n");
+  
+  return true;
+}
+
+bool EpistasisEQtl::WriteTranscriptCheckpoint(string transcript) {
+  // counts include this transcript, as do the results already written
+  if(par::save_pvalue_histogram && !pvalueHistogram.save(histogramFilename)) {
+    PP->printLOG("WARNING: could not write p-value histogram [ " + 
+      histogramFilename + " ]\n");
+  }
+  ofstream checkpointFile(checkpointFilename, ios::app);
+  if(checkpointFile.fail()) {
+    return false;
+  }
+  checkpointFile << transcript << endl;
+  checkpointFile.close();
+  
+  return true;
+}
+
+bool EpistasisEQtl::ReadTranscriptCheckpoint(set<string>& completedTranscripts) {
+  completedTranscripts.clear();
+  ifstream checkpointFile(checkpointFilename);
+  if(checkpointFile.fail()) {
+    PP->printLOG("WARNING: no checkpoint file [ " + checkpointFilename + 
+                 " ], starting from the beginning\n");
+    return false;
+  }
+  string transcript;
+  while(checkpointFile >> transcript) {
+    completedTranscripts.insert(transcript);
+  }
+  checkpointFile.close();
+  
+  return true;
+}
+
+bool EpistasisEQtl::PassesThreshold(double pvalue) {
+  return (pvalue > 0) && (pvalue < par::iqtl_pvalue);
+}
+
+void EpistasisEQtl::SetResult(uint outerIndex, uint innerIndex, 
+                              double beta, double pvalue) {
+  if(streamResults) {
+    if(par::save_pvalue_histogram) {
+      threadHistograms[omp_get_thread_num()].add(pvalue);
+    }
+    if(PassesThreshold(pvalue)) {
+      threadRecords[omp_get_thread_num()].push_back(
+        IqtlRecord(outerIndex, innerIndex, beta, pvalue));
+    }
+  } else {
+    resultsMatrixBetas(outerIndex, innerIndex) = beta;
+    resultsMatrixPvals(outerIndex, innerIndex) = pvalue;
+  }
+}
+
+string EpistasisEQtl::FormatResult(uint outerIndex, uint innerIndex, 
+                                   double beta, double pvalue, 
+                                   string& transcript, 
+                                   vector<string>& tfSnpNames) {
+  uint snpAIndex = -1;
+  if(tfMode) {
+    snpAIndex = thisTFSnpIndices[outerIndex];
+  } else {
+    snpAIndex = thisTranscriptSnpIndices[outerIndex];
+  }
+  uint snpBIndex = thisTranscriptSnpIndices[innerIndex];
+  stringstream ss;
+  ss << PP->locus[snpAIndex]->name << "\t" 
+    << PP->locus[snpBIndex]->name << "\t"
+    << transcript << "\t";
+  if(tfMode) {
+    ss << tfSnpNames[outerIndex] << "\t";
+  }
+  ss << beta << "\t" << pvalue << "\n";
+  
+  return ss.str();
+}
+
+static bool iqtlRecordLoopOrder(const IqtlRecord& a, const IqtlRecord& b) {
+  if(a.outerIndex != b.outerIndex) {
+    return a.outerIndex < b.outerIndex;
+  }
+  return a.innerIndex < b.innerIndex;
+}
+
+static bool iqtlRecordPvalueOrder(const IqtlRecord& a, const IqtlRecord& b) {
+  if(a.pvalue != b.pvalue) {
+    return a.pvalue < b.pvalue;
+  }
+  return iqtlRecordLoopOrder(a, b);
+}
+
+bool EpistasisEQtl::WriteStreamRecords(string transcript, 
+                                       vector<string>& tfSnpNames) {
+  // gather the thread buffers; loop order matches the per-transcript files
+  vector<IqtlRecord> records;
+  for(uint t=0; t < threadRecords.size(); ++t) {
+    records.insert(records.end(), threadRecords[t].begin(), 
+      threadRecords[t].end());
+    vector<IqtlRecord>().swap(threadRecords[t]);
+  }
+  for(uint t=0; t < threadHistograms.size(); ++t) {
+    pvalueHistogram.merge(threadHistograms[t]);
+    threadHistograms[t].clear();
+  }
+  // each transcript is written, and checkpointed, as it completes, so the
+  // p-value order is within the transcript only
+  if(streamSorted) {
+    sort(records.begin(), records.end(), iqtlRecordPvalueOrder);
+  } else {
+    sort(records.begin(), records.end(), iqtlRecordLoopOrder);
+  }
+  for(uint r=0; r < records.size(); ++r) {
+    streamFile << FormatResult(records[r].outerIndex, records[r].innerIndex,
+      records[r].beta, records[r].pvalue, transcript, tfSnpNames);
+  }
+  streamRecordsWritten += records.size();
+  PP->printLOG(Timestamp() + "Streamed [ " + int2str(records.size()) + 
+    " ] iQTL results for " + transcript + "\n");
+  
+  return true;
+}
+
 bool EpistasisEQtl::LoadDefaultTranscriptionFactorLUT() {
   transcriptFactorLUT["ADNP"] = {20, 49505454, 49547527};
   transcriptFactorLUT["AFF1"] = {4, 87856153, 88062206};
@@ -16,6 +16,11 @@
 
 #include <armadillo>
 
+#include "zed.h"
+#include "GenomicIndex.h"
+#include "PvalueHistogram.h"
+#include "ModelContext.h"
+
 typedef std::map<std::string, std::vector<uint> > CoordinateTable;
 typedef std::map<std::string, std::vector<uint> >::const_iterator CoordinateTableCIt;
 
@@ -26,15 +31,29 @@ enum COORD_FIELDS {
   COORD_CHROM, COORD_BP_START, COORD_BP_END
 };
 
+// one streamed interaction result: outer and inner loop indices as in the
+// dense results matrices
+struct IqtlRecord {
+  IqtlRecord(uint outer, uint inner, double coef, double p):
+    outerIndex(outer), innerIndex(inner), beta(coef), pvalue(p) {}
+  uint outerIndex;
+  uint innerIndex;
+  double beta;
+  double pvalue;
+};
+
 class EpistasisEQtl {
 public:
   EpistasisEQtl();
   virtual ~EpistasisEQtl();
   void PrintState();
   bool Run();
-  bool RunEqtl(std::string transcript);
+  bool RunEqtl(std::string transcript, std::vector<std::string>& tfSnpNames);
   bool RunIqtlFull();
   bool RunIqtlCisTrans();
+  // cis-trans iQTL for a block of transcripts sharing each SNP pair design
+  bool RunIqtlCisTransBatch(std::vector<uint>& transcriptIndices,
+    std::vector<arma::mat>& batchBetas, std::vector<arma::mat>& batchPvals);
   bool ReadTranscriptCoordinates(std::string coordinatesFile);
   bool ReadTranscriptFactorCoordinates(std::string coordinatesFile);
   bool SetDebugMode(bool debugFlag=true);
@@ -50,13 +69,36 @@ public:
   bool GetTFInfo(std::string tf, std::vector<uint>& tfInfo);
   bool WriteResults(std::string saveFilename, std::string saveTranscript,
     std::vector<std::string> saveTFSnpNames);
+  // stream thresholded results of all transcripts into one compressed file;
+  // records are grouped by transcript in run order, eQTL main effects (SnpB
+  // NA) first, and sortFlag orders each transcript's interaction records by
+  // p-value instead of loop order
+  bool SetStreamResults(bool streamFlag, bool sortFlag=false);
+  // run partition partIndex of numParts (1-based) and/or resume from the
+  // transcript checkpoint
+  bool SetPartition(uint partIndex, uint numParts, bool resume=false);
 private:
   bool CheckInputs();
   bool GetSnpsForTranscript(std::string transcript, 
-    std::vector<uint>& snpIndices);
+    std::vector<uint>& snpIndices, bool logSearch=true);
   bool GetSnpsForTFs(std::vector<uint>& snpIndices, std::vector<std::string>& tfs);
   bool LoadDefaultTranscriptionFactorLUT();
   bool IsSnpInTFs(uint chr, uint bp, std::string& tf);
+  bool IsExpressionComplete(uint transcriptIndex);
+  // store one interaction result in the matrices or the thread's stream buffer
+  void SetResult(uint outerIndex, uint innerIndex, double beta, double pvalue);
+  bool PassesThreshold(double pvalue);
+  std::string FormatResult(uint outerIndex, uint innerIndex, double beta,
+    double pvalue, std::string& transcript, 
+    std::vector<std::string>& tfSnpNames);
+  bool WriteStreamRecords(std::string transcript, 
+    std::vector<std::string>& tfSnpNames);
+  // transcripts of this partition not already in the checkpoint; partitions
+  // are a static cost-balanced split, and within a job threads share the
+  // work of a transcript through the dynamically scheduled pair loop
+  bool ScheduleTranscripts(std::vector<bool>& runTranscript);
+  bool WriteTranscriptCheckpoint(std::string transcript);
+  bool ReadTranscriptCheckpoint(std::set<std::string>& completedTranscripts);
   std::string exprFilename;
   std::string cordFilename;
   bool fullInteraction;
@@ -68,6 +110,9 @@ private:
   bool tfMode;
   uint tfRadius;
   TransciptFactorTable transcriptFactorLUT;
+  // position indexes for cis window and TF lookups
+  LocusPositionIndex locusIndex;
+  GenomicIntervalIndex tfIndex;
   // algorithm
   std::vector<uint> thisTranscriptSnpIndices;
   std::vector<uint> thisTFSnpIndices;
@@ -79,6 +124,24 @@ private:
   std::vector<uint> innerLoopSnps;
   arma::mat resultsMatrixBetas;
   arma::mat resultsMatrixPvals;
+  // reusable per-thread linear models: SNP A, SNP B, covariates, A x B
+  ModelContext modelContext;
+  // streamed output
+  bool streamResults;
+  bool streamSorted;
+  ZOutput streamFile;
+  std::vector<std::vector<IqtlRecord> > threadRecords;
+  unsigned long streamRecordsWritten;
+  // all tests for a global FDR, saved with each transcript checkpoint
+  PvalueHistogram pvalueHistogram;
+  std::vector<PvalueHistogram> threadHistograms;
+  std::string histogramFilename;
+  // job array partitions and checkpoint/resume
+  uint partitionIndex;
+  uint numPartitions;
+  bool resumeRun;
+  std::string runPrefix;
+  std::string checkpointFilename;
 };
 
 #endif	/* EPISTASISEQTL_H */
@@ -0,0 +1,217 @@
+/* =============================================================================
+ * Filename: EpistasisScreen.cpp
+ *
+ * Description:  Fast pairwise interaction prescreen for reGAIN.
+ * =============================================================================
+ */
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <omp.h>
+
+#include "plink.h"
+#include "options.h"
+#include "stats.h"
+#include "helper.h"
+#include "EpistasisScreen.h"
+#include "Insilico.h"
+
+using namespace std;
+
+EpistasisScreen::EpistasisScreen() {
+  isBuilt = false;
+  binaryPhenotype = false;
+  numAttributes = 0;
+  numSamples = 0;
+  numCases = 0;
+  numControls = 0;
+}
+
+EpistasisScreen::~EpistasisScreen() {
+}
+
+bool EpistasisScreen::build() {
+  numAttributes = PP->nl_all + PP->nlistname.size();
+  binaryPhenotype = par::bt;
+  vector<uint> sampleIdx;
+  vector<uint> caseIdx;
+  vector<uint> controlIdx;
+  for(uint i=0; i < PP->n; ++i) {
+    Individual* person = PP->sample[i];
+    if(person->missing || person->missing2) {
+      continue;
+    }
+    sampleIdx.push_back(i);
+    if(person->aff) {
+      caseIdx.push_back(i);
+    } else {
+      controlIdx.push_back(i);
+    }
+  }
+  numSamples = sampleIdx.size();
+  numCases = caseIdx.size();
+  numControls = controlIdx.size();
+  if(numSamples < 4) {
+    PP->printLOG("WARNING: too few samples for the epistasis prescreen\n");
+    return false;
+  }
+
+  // standardized phenotype
+  phenotype.resize(numSamples);
+  double phenoMean = 0;
+  for(uint i=0; i < numSamples; ++i) {
+    phenotype[i] = PP->sample[sampleIdx[i]]->phenotype;
+    phenoMean += phenotype[i];
+  }
+  phenoMean /= numSamples;
+  double phenoSS = 0;
+  for(uint i=0; i < numSamples; ++i) {
+    phenotype[i] -= phenoMean;
+    phenoSS += phenotype[i] * phenotype[i];
+  }
+  double phenoSD = sqrt(phenoSS / (numSamples - 1));
+  for(uint i=0; i < numSamples; ++i) {
+    phenotype[i] = (phenoSD > 0)? phenotype[i] / phenoSD: 0;
+  }
+
+  standardized.resize((size_t) numAttributes * numSamples);
+  if(binaryPhenotype) {
+    caseStandardized.resize((size_t) PP->nl_all * numCases);
+    controlStandardized.resize((size_t) PP->nl_all * numControls);
+  }
+  #pragma omp parallel for
+  for(int k=0; k < numAttributes; ++k) {
+    standardizeColumn(k, sampleIdx, &standardized[(size_t) k * numSamples]);
+    if(binaryPhenotype && (k < PP->nl_all)) {
+      standardizeColumn(k, caseIdx, &caseStandardized[(size_t) k * numCases]);
+      standardizeColumn(k, controlIdx,
+                        &controlStandardized[(size_t) k * numControls]);
+    }
+  }
+  isBuilt = true;
+
+  return true;
+}
+
+double EpistasisScreen::pairPvalue(uint varIndex1, uint varIndex2) {
+  if(!isBuilt) {
+    return 0;
+  }
+  bool bothSnps = (varIndex1 < PP->nl_all) && (varIndex2 < PP->nl_all);
+  if(binaryPhenotype && bothSnps && (numCases > 3) && (numControls > 3)) {
+    return caseControlPvalue(varIndex1, varIndex2);
+  }
+
+  return productTermPvalue(varIndex1, varIndex2);
+}
+
+void EpistasisScreen::standardizeColumn(uint varIndex, vector<uint>& sampleIdx,
+                                        double* column) {
+  uint n = sampleIdx.size();
+  vector<bool> isMissing(n, false);
+  double sum = 0;
+  uint numPresent = 0;
+  for(uint i=0; i < n; ++i) {
+    bool thisMissing = false;
+    column[i] = attributeValue(PP->sample[sampleIdx[i]], varIndex, thisMissing);
+    isMissing[i] = thisMissing;
+    if(!thisMissing) {
+      sum += column[i];
+      ++numPresent;
+    }
+  }
+  double mean = numPresent? sum / numPresent: 0;
+  double ss = 0;
+  for(uint i=0; i < n; ++i) {
+    // mean imputation: missing values become 0 after centering
+    column[i] = isMissing[i]? 0: column[i] - mean;
+    ss += column[i] * column[i];
+  }
+  double sd = (n > 1)? sqrt(ss / (n - 1)): 0;
+  for(uint i=0; i < n; ++i) {
+    column[i] = (sd > 0)? column[i] / sd: 0;
+  }
+}
+
+double EpistasisScreen::attributeValue(Individual* person, uint varIndex,
+                                       bool& isMissing) {
+  isMissing = false;
+  if(varIndex >= PP->nl_all) {
+    uint numericIndex = varIndex - PP->nl_all;
+    isMissing = person->nlistMissing[numericIndex];
+    return person->nlist[numericIndex];
+  }
+  // additive autosomal coding, see Model::buildAdditive
+  bool i1 = person->one[varIndex];
+  bool i2 = person->two[varIndex];
+  if(i1) {
+    if(!i2) {
+      isMissing = true;
+      return 0;
+    }
+    return 0;
+  }
+
+  return i2? 1: 2;
+}
+
+double EpistasisScreen::caseControlPvalue(uint varIndex1, uint varIndex2) {
+  const double* case1 = &caseStandardized[(size_t) varIndex1 * numCases];
+  const double* case2 = &caseStandardized[(size_t) varIndex2 * numCases];
+  const double* ctrl1 = &controlStandardized[(size_t) varIndex1 * numControls];
+  const double* ctrl2 = &controlStandardized[(size_t) varIndex2 * numControls];
+  double caseSum = 0;
+  for(uint i=0; i < numCases; ++i) {
+    caseSum += case1[i] * case2[i];
+  }
+  double controlSum = 0;
+  for(uint i=0; i < numControls; ++i) {
+    controlSum += ctrl1[i] * ctrl2[i];
+  }
+  // correlations of standardized columns; clamp away from +/-1 for Fisher z
+  double rCases = caseSum / (numCases - 1);
+  double rControls = controlSum / (numControls - 1);
+  double maxR = 1.0 - 1e-12;
+  rCases = max(-maxR, min(maxR, rCases));
+  rControls = max(-maxR, min(maxR, rControls));
+  double zCases = 0.5 * log((1.0 + rCases) / (1.0 - rCases));
+  double zControls = 0.5 * log((1.0 + rControls) / (1.0 - rControls));
+  double Z = (zCases - zControls) /
+    sqrt(1.0 / (numCases - 3) + 1.0 / (numControls - 3));
+
+  return 2.0 * normdist(-fabs(Z));
+}
+
+double EpistasisScreen::productTermPvalue(uint varIndex1, uint varIndex2) {
+  const double* x1 = &standardized[(size_t) varIndex1 * numSamples];
+  const double* x2 = &standardized[(size_t) varIndex2 * numSamples];
+  const double* y = &phenotype[0];
+  double sumP = 0;
+  double sumPP = 0;
+  double sumPY = 0;
+  for(uint i=0; i < numSamples; ++i) {
+    double p = x1[i] * x2[i];
+    sumP += p;
+    sumPP += p * p;
+    sumPY += p * y[i];
+  }
+  // y is standardized: sum(y) = 0, sum(y^2) = n - 1
+  double varP = sumPP - sumP * sumP / numSamples;
+  if(varP <= 0) {
+    return 1.0;
+  }
+  double r = sumPY / sqrt(varP * (numSamples - 1));
+  if(fabs(r) >= 1.0) {
+    return 0;
+  }
+  double df = numSamples - 2;
+  double t = r * sqrt(df / (1.0 - r * r));
+  // pT calls dcdflib cdft, which keeps static state
+  double p = 1.0;
+  #pragma omp critical
+  p = pT(t, df);
+
+  return (p < 0)? 1.0: p;
+}
@@ -0,0 +1,56 @@
+/*==============================================================================
+ *
+ * Filename:  EpistasisScreen.h
+ *
+ * Description:  Fast pairwise interaction prescreen for reGAIN. Attributes
+ * are standardized once into contiguous columns; each pair is then scored
+ * with a single pass over the samples instead of a full regression fit.
+ *   - binary phenotype, SNP x SNP: case/control difference of the Fisher
+ *     z-transformed dosage correlations (fast epistasis style Z test)
+ *   - otherwise: correlation of the product term x1*x2 with the phenotype
+ * Missing genotypes and numeric values are mean imputed for the screen.
+ * =============================================================================
+ */
+
+#ifndef __EPISTASIS_SCREEN_H__
+#define __EPISTASIS_SCREEN_H__
+
+#include <vector>
+
+#include "plink.h"
+
+class EpistasisScreen {
+public:
+  EpistasisScreen();
+  ~EpistasisScreen();
+  // standardize all SNP and numeric attributes; requires individual-major
+  // genotypes, i.e., after SNP2Ind()
+  bool build();
+  // screening p-value for the pair of attributes; the t CDF runs in the
+  // unnamed omp critical section, so do not call from inside one
+  double pairPvalue(uint varIndex1, uint varIndex2);
+  bool passes(uint varIndex1, uint varIndex2, double threshold) {
+    return pairPvalue(varIndex1, varIndex2) <= threshold;
+  }
+private:
+  // standardize the attribute values of the selected samples into column
+  void standardizeColumn(uint varIndex, std::vector<uint>& sampleIdx,
+                         double* column);
+  double attributeValue(Individual* person, uint varIndex, bool& isMissing);
+  double caseControlPvalue(uint varIndex1, uint varIndex2);
+  double productTermPvalue(uint varIndex1, uint varIndex2);
+  bool isBuilt;
+  bool binaryPhenotype;
+  uint numAttributes;
+  // samples with a non-missing phenotype
+  uint numSamples;
+  std::vector<double> phenotype;
+  std::vector<double> standardized;
+  // binary phenotype: attributes standardized within cases and controls
+  uint numCases;
+  uint numControls;
+  std::vector<double> caseStandardized;
+  std::vector<double> controlStandardized;
+};
+
+#endif
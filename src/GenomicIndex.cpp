@@ -0,0 +1,149 @@
+/* =============================================================================
+ * Filename: GenomicIndex.cpp
+ *
+ * Description:  Locus position and genomic interval indexes.
+ * =============================================================================
+ */
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+
+#include "plink.h"
+#include "GenomicIndex.h"
+
+using namespace std;
+
+LocusPositionIndex::LocusPositionIndex() {
+  built = false;
+}
+
+LocusPositionIndex::~LocusPositionIndex() {
+}
+
+void LocusPositionIndex::build(const vector<Locus*>& loci) {
+  positions.clear();
+  chromosomeLoci.clear();
+  for(uint i=0; i < loci.size(); ++i) {
+    positions[loci[i]->chr].push_back(make_pair((long) loci[i]->bp, i));
+    chromosomeLoci[loci[i]->chr].push_back(i);
+  }
+  map<int, vector<pair<long, uint> > >::iterator chrIt = positions.begin();
+  for(; chrIt != positions.end(); ++chrIt) {
+    sort(chrIt->second.begin(), chrIt->second.end());
+  }
+  built = true;
+}
+
+void LocusPositionIndex::query(int chr, long start, long end, 
+                               vector<uint>& hits) const {
+  map<int, vector<pair<long, uint> > >::const_iterator chrIt = 
+    positions.find(chr);
+  if((chrIt == positions.end()) || (start > end)) {
+    return;
+  }
+  const vector<pair<long, uint> >& chrPositions = chrIt->second;
+  vector<pair<long, uint> >::const_iterator lo = 
+    lower_bound(chrPositions.begin(), chrPositions.end(), make_pair(start, 0U));
+  vector<uint> windowHits;
+  for(; (lo != chrPositions.end()) && (lo->first <= end); ++lo) {
+    windowHits.push_back(lo->second);
+  }
+  sort(windowHits.begin(), windowHits.end());
+  hits.insert(hits.end(), windowHits.begin(), windowHits.end());
+}
+
+void LocusPositionIndex::queryChromosome(int chr, vector<uint>& hits) const {
+  map<int, vector<uint> >::const_iterator chrIt = chromosomeLoci.find(chr);
+  if(chrIt != chromosomeLoci.end()) {
+    hits.insert(hits.end(), chrIt->second.begin(), chrIt->second.end());
+  }
+}
+
+GenomicIntervalIndex::GenomicIntervalIndex() {
+}
+
+GenomicIntervalIndex::~GenomicIntervalIndex() {
+}
+
+void GenomicIntervalIndex::clear() {
+  trees.clear();
+}
+
+void GenomicIntervalIndex::add(string name, int chr, long start, long end) {
+  Interval newInterval;
+  newInterval.start = start;
+  newInterval.end = end;
+  newInterval.name = name;
+  trees[chr].intervals.push_back(newInterval);
+}
+
+void GenomicIntervalIndex::build() {
+  map<int, ChromosomeTree>::iterator treeIt = trees.begin();
+  for(; treeIt != trees.end(); ++treeIt) {
+    ChromosomeTree& tree = treeIt->second;
+    sort(tree.intervals.begin(), tree.intervals.end());
+    tree.maxEnd.resize(tree.intervals.size());
+    buildTree(tree, 0, tree.intervals.size());
+  }
+}
+
+long GenomicIntervalIndex::buildTree(ChromosomeTree& tree, uint lo, uint hi) {
+  // node at the middle of [lo, hi), left and right halves as subtrees
+  uint mid = lo + (hi - lo) / 2;
+  long maxEnd = tree.intervals[mid].end;
+  if(lo < mid) {
+    maxEnd = max(maxEnd, buildTree(tree, lo, mid));
+  }
+  if(mid + 1 < hi) {
+    maxEnd = max(maxEnd, buildTree(tree, mid + 1, hi));
+  }
+  tree.maxEnd[mid] = maxEnd;
+
+  return maxEnd;
+}
+
+void GenomicIntervalIndex::queryTree(const ChromosomeTree& tree, 
+                                     uint lo, uint hi, long bp,
+                                     vector<string>& hits) const {
+  if(lo >= hi) {
+    return;
+  }
+  uint mid = lo + (hi - lo) / 2;
+  // nothing in this subtree reaches bp
+  if(tree.maxEnd[mid] < bp) {
+    return;
+  }
+  queryTree(tree, lo, mid, bp, hits);
+  // intervals to the right start after bp
+  if(tree.intervals[mid].start > bp) {
+    return;
+  }
+  if(tree.intervals[mid].end >= bp) {
+    hits.push_back(tree.intervals[mid].name);
+  }
+  queryTree(tree, mid + 1, hi, bp, hits);
+}
+
+void GenomicIntervalIndex::query(int chr, long bp, vector<string>& hits) const {
+  map<int, ChromosomeTree>::const_iterator treeIt = trees.find(chr);
+  if(treeIt == trees.end()) {
+    return;
+  }
+  vector<string> treeHits;
+  queryTree(treeIt->second, 0, treeIt->second.intervals.size(), bp, treeHits);
+  sort(treeHits.begin(), treeHits.end());
+  hits.insert(hits.end(), treeHits.begin(), treeHits.end());
+}
+
+bool GenomicIntervalIndex::first(int chr, long bp, string& name) const {
+  vector<string> hits;
+  query(chr, bp, hits);
+  if(hits.empty()) {
+    return false;
+  }
+  name = hits[0];
+
+  return true;
+}
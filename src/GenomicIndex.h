@@ -0,0 +1,76 @@
+/*==============================================================================
+ *
+ * Filename:  GenomicIndex.h
+ *
+ * Description:  Position indexes for cis-window and transcription factor 
+ * lookups shared by iQTL and dcVar.
+ *   - LocusPositionIndex: loci sorted by base pair per chromosome; window 
+ *     queries are a binary search plus the hits
+ *   - GenomicIntervalIndex: named intervals (TFs, transcripts) per 
+ *     chromosome in an implicit interval tree (intervals sorted by start, 
+ *     subtree maximum end); overlap queries are O(log n + hits)
+ * Queries return loci in locus (file) order and intervals in name order, so
+ * results match the previous linear scans.
+ * =============================================================================
+ */
+
+#ifndef __GENOMIC_INDEX_H__
+#define __GENOMIC_INDEX_H__
+
+#include <vector>
+#include <string>
+#include <map>
+#include <utility>
+
+#include "plink.h"
+
+class LocusPositionIndex {
+public:
+  LocusPositionIndex();
+  ~LocusPositionIndex();
+  void build(const std::vector<Locus*>& loci);
+  bool isBuilt() const { return built; }
+  // append the indices of loci on chr with start <= bp <= end, in locus order
+  void query(int chr, long start, long end, std::vector<uint>& hits) const;
+  // append the indices of all loci on chr, in locus order
+  void queryChromosome(int chr, std::vector<uint>& hits) const;
+private:
+  bool built;
+  // per chromosome: (bp, locus index) sorted by bp
+  std::map<int, std::vector<std::pair<long, uint> > > positions;
+  // per chromosome: locus indices in locus order
+  std::map<int, std::vector<uint> > chromosomeLoci;
+};
+
+class GenomicIntervalIndex {
+public:
+  GenomicIntervalIndex();
+  ~GenomicIntervalIndex();
+  void clear();
+  // intervals are closed [start, end]
+  void add(std::string name, int chr, long start, long end);
+  // sort and build the interval trees; call after the last add()
+  void build();
+  // append the names of intervals containing chr:bp, in name order
+  void query(int chr, long bp, std::vector<std::string>& hits) const;
+  // first interval name containing chr:bp in name order, as std::map order
+  bool first(int chr, long bp, std::string& name) const;
+private:
+  struct Interval {
+    long start;
+    long end;
+    std::string name;
+    bool operator<(const Interval& other) const { return start < other.start; }
+  };
+  struct ChromosomeTree {
+    std::vector<Interval> intervals;
+    // maximum end of the implicit subtree rooted at each interval
+    std::vector<long> maxEnd;
+  };
+  long buildTree(ChromosomeTree& tree, uint lo, uint hi);
+  void queryTree(const ChromosomeTree& tree, uint lo, uint hi, long bp,
+                 std::vector<std::string>& hits) const;
+  std::map<int, ChromosomeTree> trees;
+};
+
+#endif
@@ -0,0 +1,115 @@
+/* =============================================================================
+ * Filename: GenotypeDosages.cpp
+ *
+ * Description:  Shared column-major table of decoded genotype classes.
+ * =============================================================================
+ */
+
+#include <vector>
+
+#include <omp.h>
+
+#include "plink.h"
+#include "options.h"
+#include "helper.h"
+#include "GenotypeDosages.h"
+#include "Insilico.h"
+
+using namespace std;
+
+atomic<bool> GenotypeDosages::enabled(false);
+atomic<GenotypeDosages*> GenotypeDosages::sharedDosages(0);
+
+void GenotypeDosages::enable() {
+  enabled.store(true, memory_order_release);
+}
+
+void GenotypeDosages::release() {
+  #pragma omp critical(genotype_dosages)
+  {
+    GenotypeDosages* oldDosages = 
+      sharedDosages.exchange(0, memory_order_acq_rel);
+    delete oldDosages;
+  }
+}
+
+GenotypeDosages* GenotypeDosages::get() {
+  if(!enabled.load(memory_order_acquire)) {
+    return 0;
+  }
+  // the acquire load sees a fully built table or none at all
+  GenotypeDosages* dosages = sharedDosages.load(memory_order_acquire);
+  if(!dosages) {
+    #pragma omp critical(genotype_dosages)
+    {
+      dosages = sharedDosages.load(memory_order_relaxed);
+      if(!dosages) {
+        GenotypeDosages* newDosages = new GenotypeDosages();
+        if(newDosages->build()) {
+          dosages = newDosages;
+          sharedDosages.store(dosages, memory_order_release);
+        } else {
+          delete newDosages;
+          enabled.store(false, memory_order_release);
+        }
+      }
+    }
+  }
+
+  return dosages;
+}
+
+GenotypeDosages::GenotypeDosages() {
+  numSnps = 0;
+  numIndividuals = 0;
+}
+
+GenotypeDosages::~GenotypeDosages() {
+}
+
+bool GenotypeDosages::build() {
+  if(par::SNP_major) {
+    PP->printLOG("WARNING: genotype dosage table requires individual-major "
+                 "mode, using per-model genotype decoding\n");
+    return false;
+  }
+  numSnps = PP->nl_all;
+  numIndividuals = PP->n;
+  PP->printLOG("Building genotype dosage table for [ " + int2str(numSnps) +
+               " ] SNPs and [ " + int2str(numIndividuals) +
+               " ] individuals\n");
+  codes.resize((size_t) numSnps * numIndividuals);
+  #pragma omp parallel for
+  for(int s=0; s < (int) numSnps; ++s) {
+    bool isX = par::chr_sex[PP->locus[s]->chr];
+    bool isHaploid = par::chr_haploid[PP->locus[s]->chr];
+    signed char* snpCodes = &codes[(size_t) s * numIndividuals];
+    for(uint i=0; i < numIndividuals; ++i) {
+      Individual* person = PP->sample[i];
+      bool i1 = person->one[s];
+      bool i2 = person->two[s];
+      signed char code = DOSAGE_MISSING;
+      // same coding branches as Model::buildAdditive
+      if(isX && person->sex) {
+        if(i1 == i2) {
+          code = i1? DOSAGE_MALE_X_A1: DOSAGE_MALE_X_A2;
+        }
+      } else if(!isX && isHaploid) {
+        if(i1 == i2) {
+          code = i1? DOSAGE_HAPLOID_A1: DOSAGE_HAPLOID_A2;
+        }
+      } else {
+        if(i1) {
+          if(i2) {
+            code = DOSAGE_HOM_A1;
+          }
+        } else {
+          code = i2? DOSAGE_HET: DOSAGE_HOM_A2;
+        }
+      }
+      snpCodes[i] = code;
+    }
+  }
+
+  return true;
+}
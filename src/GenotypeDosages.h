@@ -0,0 +1,62 @@
+/*==============================================================================
+ *
+ * Filename:  GenotypeDosages.h
+ *
+ * Description:  Shared, column-major (SNP-major) table of genotype classes
+ * decoded once from the PLINK individual-major one/two bit vectors. Models
+ * map a class to a dosage with a lookup table instead of re-decoding the
+ * bits, and re-testing the X chromosome/haploid/sex branches, for every
+ * individual of every model.
+ * =============================================================================
+ */
+
+#ifndef __GENOTYPE_DOSAGES_H__
+#define __GENOTYPE_DOSAGES_H__
+
+#include <atomic>
+#include <vector>
+
+#include "plink.h"
+
+// genotype class codes; negative codes are missing
+enum GenotypeDosageClass {
+  DOSAGE_MISSING = -1,
+  DOSAGE_HOM_A1 = 0,
+  DOSAGE_HET = 1,
+  DOSAGE_HOM_A2 = 2,
+  DOSAGE_MALE_X_A1 = 3,
+  DOSAGE_MALE_X_A2 = 4,
+  DOSAGE_HAPLOID_A1 = 5,
+  DOSAGE_HAPLOID_A2 = 6,
+  DOSAGE_NUM_CLASSES = 7
+};
+
+class GenotypeDosages {
+public:
+  // allow models to use the shared table; it is built on first use
+  static void enable();
+  // release the table, e.g., after genotypes or samples change
+  static void release();
+  // the shared table or NULL if not enabled
+  static GenotypeDosages* get();
+  // genotype classes of all individuals for one SNP
+  const signed char* column(uint snpIndex) const {
+    return &codes[(size_t) snpIndex * numIndividuals];
+  }
+  uint getNumSnps() const { return numSnps; }
+  uint getNumIndividuals() const { return numIndividuals; }
+private:
+  GenotypeDosages();
+  ~GenotypeDosages();
+  // decode all genotypes; requires individual-major mode
+  bool build();
+  // read without the lock by model threads, so published with release and
+  // read with acquire ordering
+  static std::atomic<bool> enabled;
+  static std::atomic<GenotypeDosages*> sharedDosages;
+  uint numSnps;
+  uint numIndividuals;
+  std::vector<signed char> codes;
+};
+
+#endif
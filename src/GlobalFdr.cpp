@@ -0,0 +1,295 @@
+/* =============================================================================
+ * Filename: GlobalFdr.cpp
+ *
+ * Description:  Two-pass global Benjamini-Hochberg FDR for results files.
+ * =============================================================================
+ */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+#include "plink.h"
+#include "helper.h"
+#include "zed.h"
+#include "GlobalFdr.h"
+#include "MatrixIO.h"
+#include "Insilico.h"
+
+using namespace std;
+
+GlobalFdr::GlobalFdr() {
+  threshold = 0;
+}
+
+GlobalFdr::~GlobalFdr() {
+}
+
+bool GlobalFdr::run(double fdr, string histogramsListFilename, 
+                    string matricesListFilename, string resultsListFilename,
+                    unsigned int pvalueColumn) {
+  vector<string> histogramFiles;
+  vector<string> matrixFiles;
+  vector<string> resultsFiles;
+  if(!readFileList(histogramsListFilename, histogramFiles) ||
+     !readFileList(matricesListFilename, matrixFiles) ||
+     !readFileList(resultsListFilename, resultsFiles)) {
+    return false;
+  }
+
+  // pass one
+  PP->printLOG(Timestamp() + "Global FDR pass one: [ " + 
+    int2str(histogramFiles.size()) + " ] p-value histograms, [ " + 
+    int2str(matrixFiles.size()) + " ] p-value matrices\n");
+  for(unsigned int i=0; i < histogramFiles.size(); ++i) {
+    if(!addHistogramFile(histogramFiles[i])) {
+      return false;
+    }
+  }
+  for(unsigned int i=0; i < matrixFiles.size(); ++i) {
+    if(!addMatrixFile(matrixFiles[i])) {
+      return false;
+    }
+  }
+  string mergedFilename = par::output_file_name + ".fdr.phist";
+  PP->printLOG(Timestamp() + "Writing merged p-value histogram [ " + 
+    mergedFilename + " ]\n");
+  if(!saveHistogram(mergedFilename)) {
+    PP->printLOG("Could not write [ " + mergedFilename + " ]\n");
+    return false;
+  }
+  if(computeThreshold(fdr) == 0) {
+    PP->printLOG("No p-value meets BH threshold criteria, so nothing written\n");
+    return true;
+  }
+
+  // pass two
+  uint64_t totalKept = 0;
+  uint64_t numKept = 0;
+  for(unsigned int i=0; i < resultsFiles.size(); ++i) {
+    if(!filterRecordFile(resultsFiles[i], filteredFilename(resultsFiles[i]),
+                         pvalueColumn, numKept)) {
+      return false;
+    }
+    totalKept += numKept;
+  }
+  for(unsigned int i=0; i < matrixFiles.size(); ++i) {
+    if(!filterMatrixFile(matrixFiles[i], filteredFilename(matrixFiles[i]), 
+                         numKept)) {
+      return false;
+    }
+    totalKept += numKept;
+  }
+  PP->printLOG(Timestamp() + "Kept [ " + longint2str(totalKept) + 
+    " ] results after global FDR filtering\n");
+
+  return true;
+}
+
+bool GlobalFdr::addHistogramFile(string histogramFilename) {
+  checkFileExists(histogramFilename);
+  PvalueHistogram fileHistogram;
+  if(!fileHistogram.load(histogramFilename)) {
+    PP->printLOG("Error reading p-value histogram [ " + histogramFilename + 
+      " ]\n");
+    return false;
+  }
+  if(!histogram.merge(fileHistogram)) {
+    PP->printLOG("P-value histogram [ " + histogramFilename + 
+      " ] has different bins than the others\n");
+    return false;
+  }
+  if(par::verbose) {
+    PP->printLOG("\tMerged [ " + longint2str(fileHistogram.getNumTests()) + 
+      " ] tests from [ " + histogramFilename + " ]\n");
+  }
+
+  return true;
+}
+
+bool GlobalFdr::addMatrixFile(string matrixFilename) {
+  checkFileExists(matrixFilename);
+  if(armaIsBinaryMatrixFile(matrixFilename)) {
+    arma::mat pvalues;
+    vector<string> varNames;
+    if(!armaReadBinaryMatrix(matrixFilename, pvalues, varNames)) {
+      return false;
+    }
+    for(unsigned int row=0; row < pvalues.n_rows; ++row) {
+      for(unsigned int col=row + 1; col < pvalues.n_cols; ++col) {
+        histogram.add(pvalues(row, col));
+      }
+    }
+    return true;
+  }
+  ifstream matrixFile(matrixFilename.c_str());
+  string line;
+  // variable names header
+  getline(matrixFile, line);
+  unsigned int numVars = tokenizeLine(line).size();
+  unsigned int row = 0;
+  double pvalue = 1.0;
+  while(getline(matrixFile, line)) {
+    if(line == "") {
+      continue;
+    }
+    vector<string> tok = tokenizeLine(line);
+    if(tok.size() != numVars) {
+      PP->printLOG("Matrix file [ " + matrixFilename + " ] row [ " + 
+        int2str(row + 1) + " ] does not have [ " + int2str(numVars) + 
+        " ] values\n");
+      return false;
+    }
+    for(unsigned int col=row + 1; col < numVars; ++col) {
+      if(!from_string<double>(pvalue, tok[col], std::dec)) {
+        PP->printLOG("Error parsing p-value token:" + tok[col] + "\n");
+        return false;
+      }
+      histogram.add(pvalue);
+    }
+    ++row;
+  }
+  matrixFile.close();
+
+  return true;
+}
+
+bool GlobalFdr::saveHistogram(string histogramFilename) const {
+  return histogram.save(histogramFilename);
+}
+
+double GlobalFdr::computeThreshold(double fdr) {
+  PP->printLOG("Calculating Benjamini Hochberg FDR from p-value histogram\n");
+  threshold = histogram.getBHThreshold(fdr);
+  PP->printLOG("BH rejection threshold: T = " + dbl2str(threshold) + 
+    " for FDR " + dbl2str(fdr) + " over [ " + 
+    longint2str(histogram.getNumTests()) + " ] tests\n");
+
+  return threshold;
+}
+
+bool GlobalFdr::filterRecordFile(string inFilename, string outFilename,
+                                 unsigned int pvalueColumn, uint64_t& numKept) {
+  numKept = 0;
+  checkFileExists(inFilename);
+  ZInput zin(inFilename, compressed(inFilename));
+  ZOutput zout(outFilename, true);
+  // copy header line
+  string line = zin.readLine();
+  zout << line + "\n";
+  double pvalue = 1.0;
+  while(!zin.endOfFile()) {
+    line = zin.readLine();
+    vector<string> tok = tokenizeLine(line);
+    if(!tok.size()) {
+      continue;
+    }
+    unsigned int pvalueIndex = pvalueColumn? pvalueColumn - 1: tok.size() - 1;
+    if((pvalueIndex >= tok.size()) || 
+       !from_string<double>(pvalue, tok[pvalueIndex], std::dec)) {
+      PP->printLOG("Error parsing p-value in [ " + inFilename + " ] line:\n" + 
+        line + "\n");
+      zin.close();
+      zout.close();
+      return false;
+    }
+    if(pvalue <= threshold) {
+      zout << line + "\n";
+      ++numKept;
+    }
+  }
+  zin.close();
+  zout.close();
+  if(par::verbose) {
+    PP->printLOG("\tKept [ " + longint2str(numKept) + " ] records of [ " + 
+      inFilename + " ] in [ " + outFilename + " ]\n");
+  }
+
+  return true;
+}
+
+bool GlobalFdr::filterMatrixFile(string inFilename, string outFilename,
+                                 uint64_t& numKept) {
+  numKept = 0;
+  checkFileExists(inFilename);
+  if(armaIsBinaryMatrixFile(inFilename)) {
+    arma::mat pvalues;
+    vector<string> varNames;
+    if(!armaReadBinaryMatrix(inFilename, pvalues, varNames)) {
+      return false;
+    }
+    ZOutput zout(outFilename, true);
+    zout << "VAR1\tVAR2\tPVALUE\n";
+    for(unsigned int row=0; row < pvalues.n_rows; ++row) {
+      for(unsigned int col=row + 1; col < pvalues.n_cols; ++col) {
+        if(pvalues(row, col) <= threshold) {
+          zout << varNames[row] + "\t" + varNames[col] + "\t" + 
+            dbl2str(pvalues(row, col)) + "\n";
+          ++numKept;
+        }
+      }
+    }
+    zout.close();
+    return true;
+  }
+  ifstream matrixFile(inFilename.c_str());
+  string line;
+  getline(matrixFile, line);
+  vector<string> varNames = tokenizeLine(line);
+  ZOutput zout(outFilename, true);
+  zout << "VAR1\tVAR2\tPVALUE\n";
+  unsigned int row = 0;
+  double pvalue = 1.0;
+  while(getline(matrixFile, line) && (row < varNames.size())) {
+    if(line == "") {
+      continue;
+    }
+    vector<string> tok = tokenizeLine(line);
+    for(unsigned int col=row + 1; col < tok.size(); ++col) {
+      if(from_string<double>(pvalue, tok[col], std::dec) && 
+         (pvalue <= threshold)) {
+        zout << varNames[row] + "\t" + varNames[col] + "\t" + tok[col] + "\n";
+        ++numKept;
+      }
+    }
+    ++row;
+  }
+  matrixFile.close();
+  zout.close();
+  if(par::verbose) {
+    PP->printLOG("\tKept [ " + longint2str(numKept) + " ] pairs of [ " + 
+      inFilename + " ] in [ " + outFilename + " ]\n");
+  }
+
+  return true;
+}
+
+bool GlobalFdr::readFileList(string listFilename, vector<string>& filenames) {
+  filenames.clear();
+  if(listFilename == "") {
+    return true;
+  }
+  checkFileExists(listFilename);
+  ifstream listFile(listFilename.c_str());
+  string line;
+  while(getline(listFile, line)) {
+    vector<string> tok = tokenizeLine(line);
+    if(tok.size()) {
+      filenames.push_back(tok[0]);
+    }
+  }
+  listFile.close();
+
+  return true;
+}
+
+string GlobalFdr::filteredFilename(string inFilename) {
+  string baseFilename = inFilename;
+  if((baseFilename.size() > 3) && 
+     (baseFilename.substr(baseFilename.size() - 3) == ".gz")) {
+    baseFilename = baseFilename.substr(0, baseFilename.size() - 3);
+  }
+
+  return baseFilename + ".fdr.gz";
+}
@@ -0,0 +1,56 @@
+/*==============================================================================
+ *
+ * Filename:  GlobalFdr.h
+ *
+ * Description:  Two-pass Benjamini-Hochberg FDR over all tests of one or more
+ * runs without holding every p-value in memory. Pass one merges the p-value
+ * histograms saved by dcVar, iQTL and sparse reGAIN runs (or their shards)
+ * and counts square p-value matrix files (dcGAIN, reGAIN); pass two computes
+ * the global BH threshold and filters the stored results files with it.
+ * Filtering only removes records, so runs must store results with a p-value
+ * cutoff at least as loose as the global threshold.
+ * =============================================================================
+ */
+
+#ifndef __GLOBAL_FDR_H__
+#define __GLOBAL_FDR_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "PvalueHistogram.h"
+
+class GlobalFdr {
+public:
+  GlobalFdr();
+  ~GlobalFdr();
+  // both passes from list files with one filename per line; empty list
+  // filenames are skipped
+  bool run(double fdr, std::string histogramsListFilename, 
+           std::string matricesListFilename, std::string resultsListFilename,
+           unsigned int pvalueColumn);
+  // pass one: merge a histogram saved with --save-pvalue-histogram
+  bool addHistogramFile(std::string histogramFilename);
+  // pass one: count the upper triangle of a square p-value matrix file
+  bool addMatrixFile(std::string matrixFilename);
+  bool saveHistogram(std::string histogramFilename) const;
+  // global BH threshold, 0 if nothing is rejected
+  double computeThreshold(double fdr);
+  uint64_t getNumTests() const { return histogram.getNumTests(); }
+  // pass two: copy the header and the records with p-value <= threshold;
+  // pvalueColumn is 1-based, 0 for the last column
+  bool filterRecordFile(std::string inFilename, std::string outFilename,
+                        unsigned int pvalueColumn, uint64_t& numKept);
+  // pass two: edge list of the upper triangle entries <= threshold
+  bool filterMatrixFile(std::string inFilename, std::string outFilename,
+                        uint64_t& numKept);
+private:
+  bool readFileList(std::string listFilename, 
+                    std::vector<std::string>& filenames);
+  std::string filteredFilename(std::string inFilename);
+  PvalueHistogram histogram;
+  double threshold;
+};
+
+#endif
@@ -0,0 +1,190 @@
+/* =============================================================================
+ * Filename: GroupCorrelation.cpp
+ *
+ * Description:  Two-group correlation matrices from sufficient statistics.
+ * =============================================================================
+ */
+
+#include <cmath>
+#include <vector>
+
+#include <armadillo>
+
+#include "GroupCorrelation.h"
+
+using namespace std;
+using namespace arma;
+
+// full rebuild after this many incremental updates
+const static unsigned int MAX_UPDATES_PER_REBUILD = 64;
+
+GroupCorrelation::GroupCorrelation() {
+  haveData = false;
+  numSamples = 0;
+  haveCases = false;
+  numCases = 0;
+  updatesSinceRebuild = 0;
+  numRebuilds = 0;
+  numUpdates = 0;
+}
+
+GroupCorrelation::~GroupCorrelation() {
+}
+
+bool GroupCorrelation::setData(const mat& data) {
+  if(data.n_rows < 2) {
+    return false;
+  }
+  numSamples = data.n_rows;
+  // correlations are invariant to centering and scaling; standardized
+  // columns keep the cross-product differences well conditioned
+  standardized = data;
+  standardized.each_row() -= mean(standardized, 0);
+  rowvec sd = stddev(standardized, 0, 0);
+  for(uword j=0; j < standardized.n_cols; ++j) {
+    if(sd(j) > 0) {
+      standardized.col(j) /= sd(j);
+    }
+  }
+  totalCross = standardized.t() * standardized;
+  totalSums = sum(standardized, 0);
+  haveData = true;
+  haveCases = false;
+  caseMask.clear();
+
+  return true;
+}
+
+bool GroupCorrelation::setGroups(const vector<bool>& isCase) {
+  if(!haveData || (isCase.size() != numSamples)) {
+    return false;
+  }
+  unsigned int newNumCases = 0;
+  vector<uword> added;
+  vector<uword> removed;
+  for(unsigned int i=0; i < numSamples; ++i) {
+    if(isCase[i]) {
+      ++newNumCases;
+    }
+    if(haveCases && (isCase[i] != caseMask[i])) {
+      if(isCase[i]) {
+        added.push_back(i);
+      } else {
+        removed.push_back(i);
+      }
+    }
+  }
+  unsigned int newNumControls = numSamples - newNumCases;
+  unsigned int numChanged = added.size() + removed.size();
+  unsigned int smallerGroup = min(newNumCases, newNumControls);
+  if(!haveCases || (numChanged >= smallerGroup) ||
+     (updatesSinceRebuild >= MAX_UPDATES_PER_REBUILD)) {
+    // one GEMM over the smaller group; the other is the difference
+    bool fromCases = newNumCases <= newNumControls;
+    vector<uword> groupRows;
+    for(unsigned int i=0; i < numSamples; ++i) {
+      if(isCase[i] == fromCases) {
+        groupRows.push_back(i);
+      }
+    }
+    mat groupData = standardized.rows(conv_to<uvec>::from(groupRows));
+    caseCross = groupData.t() * groupData;
+    caseSums = sum(groupData, 0);
+    if(!fromCases) {
+      caseCross = totalCross - caseCross;
+      caseSums = totalSums - caseSums;
+    }
+    updatesSinceRebuild = 0;
+    ++numRebuilds;
+  } else {
+    if(numChanged) {
+      // rank-k update with the samples that changed group
+      if(added.size()) {
+        mat addedData = standardized.rows(conv_to<uvec>::from(added));
+        caseCross += addedData.t() * addedData;
+        caseSums += sum(addedData, 0);
+      }
+      if(removed.size()) {
+        mat removedData = standardized.rows(conv_to<uvec>::from(removed));
+        caseCross -= removedData.t() * removedData;
+        caseSums -= sum(removedData, 0);
+      }
+      ++updatesSinceRebuild;
+      ++numUpdates;
+    }
+  }
+  caseMask = isCase;
+  numCases = newNumCases;
+  haveCases = true;
+
+  return true;
+}
+
+bool GroupCorrelation::differentialCorrelationZ(mat& Z, umat* perfect) {
+  double n1 = numCases;
+  double n2 = numSamples - numCases;
+  if(!haveCases || (n1 < 4) || (n2 < 4)) {
+    return false;
+  }
+  double se = sqrt(1.0 / (n1 - 3.0) + 1.0 / (n2 - 3.0));
+  fisherZFromStats(caseCross, caseSums, n1, Z);
+  mat zControls;
+  fisherZFromStats(totalCross - caseCross, totalSums - caseSums, n2, zControls);
+  if(perfect) {
+    // fisherZ(1) is +inf
+    *perfect = (Z == datum::inf) + (zControls == datum::inf);
+  }
+  Z -= zControls;
+  Z = abs(Z) / se;
+
+  return true;
+}
+
+bool GroupCorrelation::differentialCorrelationZ(const vector<bool>& isCase, 
+                                                mat& Z) const {
+  if(!haveData || (isCase.size() != numSamples)) {
+    return false;
+  }
+  vector<uword> caseRows;
+  vector<uword> ctrlRows;
+  for(unsigned int i=0; i < numSamples; ++i) {
+    if(isCase[i]) {
+      caseRows.push_back(i);
+    } else {
+      ctrlRows.push_back(i);
+    }
+  }
+  double n1 = caseRows.size();
+  double n2 = ctrlRows.size();
+  if((n1 < 4) || (n2 < 4)) {
+    return false;
+  }
+  // one GEMM over the smaller group, as setGroups
+  bool fromCases = n1 <= n2;
+  mat groupData = standardized.rows(conv_to<uvec>::from(fromCases? 
+                                                        caseRows: ctrlRows));
+  mat cross = groupData.t() * groupData;
+  rowvec sums = sum(groupData, 0);
+  if(!fromCases) {
+    cross = totalCross - cross;
+    sums = totalSums - sums;
+  }
+  double se = sqrt(1.0 / (n1 - 3.0) + 1.0 / (n2 - 3.0));
+  fisherZFromStats(cross, sums, n1, Z);
+  mat zControls;
+  fisherZFromStats(totalCross - cross, totalSums - sums, n2, zControls);
+  Z -= zControls;
+  Z = abs(Z) / se;
+
+  return true;
+}
+
+void GroupCorrelation::fisherZFromStats(const mat& cross, const rowvec& sums,
+                                        double n, mat& z) const {
+  // (n - 1) x covariance; the factor cancels in the correlation
+  z = cross - (sums.t() * sums) / n;
+  vec sd = sqrt(z.diag());
+  z.each_col() /= sd;
+  z.each_row() /= sd.t();
+  z = 0.5 * log(abs((1 + z) / (1 - z)));
+}
@@ -0,0 +1,67 @@
+/*==============================================================================
+ *
+ * Filename:  GroupCorrelation.h
+ *
+ * Description:  Two-group (case/control) correlation matrices from sufficient
+ * statistics. The samples x variables data are standardized once and the
+ * total sums and cross-products X'X are kept. For each new grouping only the
+ * case statistics are computed, as one masked GEMM or, when few samples
+ * changed group since the last call (e.g., SNPs in LD), as a rank-k update
+ * adding and removing those samples; control statistics are the difference
+ * from the totals.
+ * =============================================================================
+ */
+
+#ifndef __GROUP_CORRELATION_H__
+#define __GROUP_CORRELATION_H__
+
+#include <vector>
+
+#include <armadillo>
+
+class GroupCorrelation {
+public:
+  GroupCorrelation();
+  ~GroupCorrelation();
+  // samples x variables data
+  bool setData(const arma::mat& data);
+  bool hasData() const { return haveData; }
+  // case membership of every sample, updates the case statistics
+  bool setGroups(const std::vector<bool>& isCase);
+  unsigned int getNumCases() const { return numCases; }
+  unsigned int getNumControls() const { return numSamples - numCases; }
+  // differential correlation Z = |fisherZ(r cases) - fisherZ(r controls)| / se
+  // for all pairs of variables, as armaDifferentialCorrelationZ; perfect, if
+  // given, is nonzero for pairs with r == 1 in either group, which dcGAIN
+  // skips
+  bool differentialCorrelationZ(arma::mat& Z, arma::umat* perfect=0);
+  // differential correlation for any grouping, without changing the current
+  // case statistics; safe to call from several threads (permutations)
+  bool differentialCorrelationZ(const std::vector<bool>& isCase, 
+                                arma::mat& Z) const;
+  const std::vector<bool>& getGroups() const { return caseMask; }
+  unsigned int getNumSamples() const { return numSamples; }
+  unsigned int getNumRebuilds() const { return numRebuilds; }
+  unsigned int getNumUpdates() const { return numUpdates; }
+private:
+  // Fisher z of the correlation matrix from group sums and cross-products
+  void fisherZFromStats(const arma::mat& cross, const arma::rowvec& sums,
+                        double n, arma::mat& z) const;
+  bool haveData;
+  unsigned int numSamples;
+  arma::mat standardized;
+  arma::mat totalCross;
+  arma::rowvec totalSums;
+  // current case group
+  bool haveCases;
+  unsigned int numCases;
+  std::vector<bool> caseMask;
+  arma::mat caseCross;
+  arma::rowvec caseSums;
+  // incremental updates since the last full rebuild; bounds rounding drift
+  unsigned int updatesSinceRebuild;
+  unsigned int numRebuilds;
+  unsigned int numUpdates;
+};
+
+#endif
@@ -19,6 +19,9 @@
 #include <map>
 #include <cmath>
 #include <numeric>
+#include <random>
+#include <omp.h>
+#include <algorithm>
 
 #include <armadillo>
 
@@ -28,11 +31,140 @@
 #include "StringUtils.h"
 
 #include "InteractionNetwork.h"
+#include "MatrixIO.h"
 
 using namespace std;
 using namespace insilico;
 using namespace arma;
 
+// modules at most this size are split with a dense eigendecomposition
+static const unsigned int DENSE_SPLIT_MAX_SIZE = 200;
+// restarted Lanczos for the leading eigenvector of larger modules
+static const uword LANCZOS_KRYLOV_DIM = 40;
+static const unsigned int LANCZOS_MAX_RESTARTS = 100;
+static const double LANCZOS_TOLERANCE = 1e-8;
+
+// A restricted to the given nodes, local indices in node order
+static void subnetwork(const sp_mat& A, const vector<unsigned int>& nodes,
+		sp_mat& sub)
+{
+	vector<long long> localIndex(A.n_rows, -1);
+	for(unsigned int i=0; i < nodes.size(); ++i) {
+		localIndex[nodes[i]] = i;
+	}
+	vector<uword> subRows;
+	vector<uword> subCols;
+	vector<double> subValues;
+	for(unsigned int col=0; col < nodes.size(); ++col) {
+		uword globalCol = nodes[col];
+		for(uword k=A.col_ptrs[globalCol]; k < A.col_ptrs[globalCol + 1]; ++k) {
+			long long row = localIndex[A.row_indices[k]];
+			if(row >= 0) {
+				subRows.push_back(row);
+				subCols.push_back(col);
+				subValues.push_back(A.values[k]);
+			}
+		}
+	}
+	umat locations(2, subValues.size());
+	for(uword k=0; k < subValues.size(); ++k) {
+		locations(0, k) = subRows[k];
+		locations(1, k) = subCols[k];
+	}
+	sub = sp_mat(locations, vec(subValues), nodes.size(), nodes.size());
+}
+
+// y = A * x for symmetric A, row i read as column i
+static void symmetricProduct(const sp_mat& A, const vec& x, vec& y)
+{
+	uword n = A.n_cols;
+	y.set_size(n);
+#pragma omp parallel for schedule(dynamic, 256)
+	for(uword i=0; i < n; ++i) {
+		double rowTotal = 0;
+		for(uword k=A.col_ptrs[i]; k < A.col_ptrs[i + 1]; ++k) {
+			rowTotal += A.values[k] * x(A.row_indices[k]);
+		}
+		y(i) = rowTotal;
+	}
+}
+
+// column sums; the degrees of a symmetric network
+static vec sparseDegrees(const sp_mat& A)
+{
+	vec k(A.n_cols);
+	for(uword col=0; col < A.n_cols; ++col) {
+		double colTotal = 0;
+		for(uword i=A.col_ptrs[col]; i < A.col_ptrs[col + 1]; ++i) {
+			colTotal += A.values[i];
+		}
+		k(col) = colTotal;
+	}
+
+	return k;
+}
+
+// largest algebraic eigenpair of a symmetric operator; Lanczos with full
+// reorthogonalization, restarted from the current Ritz vector
+template <class Operator>
+static bool lanczosLeading(const Operator& apply, uword n, double& eigval,
+		vec& eigvec)
+{
+	uword krylovDim = std::min(n, LANCZOS_KRYLOV_DIM);
+	// fixed start for reproducible splits; the ones vector is in the null
+	// space of a modularity matrix
+	mt19937 rng(n);
+	uniform_real_distribution<double> unit(-1.0, 1.0);
+	vec start(n);
+	for(uword i=0; i < n; ++i) {
+		start(i) = unit(rng);
+	}
+	mat V(n, krylovDim + 1);
+	vec alpha(krylovDim);
+	vec beta(krylovDim);
+	for(unsigned int restart=0; restart < LANCZOS_MAX_RESTARTS; ++restart) {
+		V.col(0) = start / norm(start);
+		uword steps = 0;
+		for(uword j=0; j < krylovDim; ++j) {
+			vec w = apply(V.col(j));
+			alpha(j) = dot(w, V.col(j));
+			w -= V.cols(0, j) * (V.cols(0, j).t() * w);
+			w -= V.cols(0, j) * (V.cols(0, j).t() * w);
+			beta(j) = norm(w);
+			steps = j + 1;
+			if(beta(j) <= LANCZOS_TOLERANCE * std::max(1.0, fabs(alpha(j)))) {
+				// invariant subspace, the Ritz values are exact
+				beta(j) = 0;
+				break;
+			}
+			V.col(j + 1) = w / beta(j);
+		}
+		mat T = zeros<mat>(steps, steps);
+		for(uword j=0; j < steps; ++j) {
+			T(j, j) = alpha(j);
+			if(j + 1 < steps) {
+				T(j, j + 1) = T(j + 1, j) = beta(j);
+			}
+		}
+		vec theta;
+		mat S;
+		if(!eig_sym(theta, S, T)) {
+			return false;
+		}
+		// eigenvalues in ascending order
+		eigval = theta(steps - 1);
+		vec y = S.col(steps - 1);
+		eigvec = V.cols(0, steps - 1) * y;
+		double residual = fabs(beta(steps - 1) * y(steps - 1));
+		if(residual <= LANCZOS_TOLERANCE * std::max(1.0, fabs(eigval))) {
+			return true;
+		}
+		start = eigvec;
+	}
+
+	return false;
+}
+
 InteractionNetwork::InteractionNetwork(string matrixFileParam,
 		 MatrixFileType fileType, bool isUpperTriangular, Plink* pp)
 {
@@ -77,7 +209,6 @@ InteractionNetwork::InteractionNetwork(string matrixFileParam,
 	maxMergeOrder = 4;
 	maxModuleSize = 10;
 	minModuleSize = 200;
-	connMatrix = adjMatrix;
 }
 
 InteractionNetwork::InteractionNetwork(double** variablesMatrix,
@@ -109,7 +240,6 @@ InteractionNetwork::InteractionNetwork(double** variablesMatrix,
 	maxMergeOrder = 4;
 	maxModuleSize = 10;
 	minModuleSize = 200;
-	connMatrix = adjMatrix;
 	debugMode = false;
 }
 
@@ -118,36 +248,61 @@ InteractionNetwork::~InteractionNetwork()
 
 bool InteractionNetwork::PrepareConnectivityMatrix() {
 
-	// keep original adjacency matrix
-	connMatrix = adjMatrix;
-	numNodes = connMatrix.n_cols;
+	numNodes = adjMatrix.n_cols;
 	this->PrintSummary();
 
-	// convert the adjacency matrix to a connectivity matrix
-	connMatrix.diag() = zeros<vec>(numNodes);
-	for(unsigned int i=0; i < numNodes; ++i) {
-		for(unsigned int j=0; j < numNodes; ++j) {
-			double edgeValue = connMatrix(i, j);
+	// threshold the adjacency matrix straight into the sparse connectivity
+	// matrix, column by column, leaving the diagonal empty
+	uword n = adjMatrix.n_cols;
+	vector<vector<uword> > colRows(n);
+	vector<vector<double> > colValues(n);
+#pragma omp parallel for schedule(dynamic, 256)
+	for(uword j=0; j < n; ++j) {
+		for(uword i=0; i < n; ++i) {
+			if(i == j) {
+				continue;
+			}
+			double edgeValue = adjMatrix(i, j);
 			if(useConnectivityThreshold) {
 				if(connectivityThresholdAbs) {
 					edgeValue = fabs(edgeValue);
 				}
 				if(edgeValue <= connectivityThreshold) {
-					connMatrix(i, j) = 0.0;
+					edgeValue = 0.0;
 				} else {
-	        if(useBinaryThreshold) {
-	          connMatrix(i, j) = 1.0;
-	        } else {
-            // else use weight
-            connMatrix(i, j) = edgeValue;
-          }
+					if(useBinaryThreshold) {
+						edgeValue = 1.0;
+					}
+					// else use weight
 				}
 			}
+			if(edgeValue != 0) {
+				colRows[j].push_back(i);
+				colValues[j].push_back(edgeValue);
+			}
 		}
 	}
+	uword numNonZero = 0;
+	for(uword j=0; j < n; ++j) {
+		numNonZero += colRows[j].size();
+	}
+	umat locations(2, numNonZero);
+	vec values(numNonZero);
+	uword k = 0;
+	for(uword j=0; j < n; ++j) {
+		for(uword r=0; r < colRows[j].size(); ++r, ++k) {
+			locations(0, k) = colRows[j][r];
+			locations(1, k) = j;
+			values(k) = colValues[j][r];
+		}
+		vector<uword>().swap(colRows[j]);
+		vector<double>().swap(colValues[j]);
+	}
+	// locations are already in column-major order
+	connSparse = sp_mat(locations, values, n, n, false, false);
 	inbixEnv->printLOG("--- Connectivity matrix finalized\n");
 
-	degrees = sum(connMatrix, 0);
+	degrees = trans(sparseDegrees(connSparse));
 	numEdges = 0.5 * sum(degrees);
 	
 	this->PrintSummary();
@@ -189,7 +344,7 @@ arma::mat InteractionNetwork::GetAdjacencyMatrix() {
 }
 
 arma::mat InteractionNetwork::GetConnectivityMatrix() {
-	return connMatrix;
+	return mat(connSparse);
 }
 
 vector<string> InteractionNetwork::GetNodeNames() {
@@ -216,10 +371,10 @@ void InteractionNetwork::PrintConnectivityMatrix() {
 		cout << setw(12) << nodeNames[i];
 	}
 	cout << endl;
-	for(unsigned int i=0; i < connMatrix.n_cols; ++i) {
-		for(unsigned int j=0; j < connMatrix.n_cols; ++j) {
+	for(unsigned int i=0; i < connSparse.n_cols; ++i) {
+		for(unsigned int j=0; j < connSparse.n_cols; ++j) {
 			if(j <= i) {
-				printf("%8.6f\t", connMatrix(i, j));
+				printf("%8.6f\t", (double) connSparse(i, j));
 			}
 		}
 		cout << endl;
@@ -239,9 +394,12 @@ void InteractionNetwork::PrintSummary()
 	inbixEnv->printLOG("Adjacency Matrix:\n");
   inbixEnv->printLOG("Minimum: " + dbl2str(adjMatrix.min()) + "\n");
   inbixEnv->printLOG("Maximum: " + dbl2str(adjMatrix.max()) + "\n");
-	inbixEnv->printLOG("Connectivity Matrix:\n");
-  inbixEnv->printLOG("Minimum: " + dbl2str(connMatrix.min()) + "\n");
-  inbixEnv->printLOG("Maximum: " + dbl2str(connMatrix.max()) + "\n");
+	if(connSparse.n_cols) {
+		// built by PrepareConnectivityMatrix
+		inbixEnv->printLOG("Connectivity Matrix:\n");
+		inbixEnv->printLOG("Minimum: " + dbl2str(connSparse.min()) + "\n");
+		inbixEnv->printLOG("Maximum: " + dbl2str(connSparse.max()) + "\n");
+	}
 }
 
 bool InteractionNetwork::WriteToFile(string outFile, MatrixFileType fileType,
@@ -297,13 +455,13 @@ bool InteractionNetwork::WriteDelimitedFile(string outFilename,
   
   if((matrixType == NET_MATRIX_CON) || (matrixType == NET_MATRIX_BOTH)) {
     outputFileHandle << endl << fixed << setprecision(8);
-    for(unsigned int i=0; i < connMatrix.n_cols; ++i) {
-      for(unsigned int j=0; j < connMatrix.n_cols; ++j) {
+    for(unsigned int i=0; i < connSparse.n_cols; ++i) {
+      for(unsigned int j=0; j < connSparse.n_cols; ++j) {
         if(j) {
-          outputFileHandle << delimiter << connMatrix(i , j);
+          outputFileHandle << delimiter << (double) connSparse(i , j);
         }
         else {
-          outputFileHandle << connMatrix(i , j);
+          outputFileHandle << (double) connSparse(i , j);
         }
       }
       outputFileHandle << endl;
@@ -331,11 +489,11 @@ bool InteractionNetwork::WriteSifFile(string outFilename,
   }
 
   if((matrixType == NET_MATRIX_CON) || (matrixType == NET_MATRIX_BOTH)) {
-    for(unsigned int i=0; i < connMatrix.n_cols; ++i) {
-      for(unsigned int j=i+1; j < connMatrix.n_cols; ++j) {
+    for(unsigned int i=0; i < connSparse.n_cols; ++i) {
+      for(unsigned int j=i+1; j < connSparse.n_cols; ++j) {
         if(adjMatrix(i , j)) {
           outputFileHandle
-            << nodeNames[i] << "\t" << connMatrix(i , j) << nodeNames[j] << endl;
+            << nodeNames[i] << "\t" << (double) connSparse(i , j) << nodeNames[j] << endl;
         }
       }
     }
@@ -348,10 +506,16 @@ bool InteractionNetwork::WriteSifFile(string outFilename,
 
 void InteractionNetwork::DebugMessage(string msg) {
 	if(debugMode) {
-		inbixEnv->printLOG("DEBUG: " + msg + "\n");	
+		LogMessage("DEBUG: " + msg + "\n");	
 	}
 }
 
+void InteractionNetwork::LogMessage(string msg) {
+	// ripM logs from concurrent tasks
+#pragma omp critical(networkLog)
+	inbixEnv->printLOG(msg);
+}
+
 bool InteractionNetwork::Merge(InteractionNetwork& toMerge,
 	                             double priorProbEdges,
 	                             double alpha,
@@ -497,78 +661,20 @@ bool InteractionNetwork::ReadCsvFile(string matrixFilename)
 
 bool InteractionNetwork::ReadGainFile(string gainFilename, bool isUpperTriangular)
 {
-	ifstream gainFileHandle(gainFilename.c_str());
-	if(!gainFileHandle.is_open()) {
-		cerr << "ERROR: Could not open (re)GAIN file: " << gainFilename << endl;
+	// text or binary matrix, rows parsed in parallel
+	if(!armaReadGainMatrix(gainFilename, adjMatrix, nodeNames, isUpperTriangular)) {
+		cerr << "ERROR: Could not read (re)GAIN file: " << gainFilename << endl;
 		return false;
 	}
-
-	string line;
-
-	// read first line (header)
-	getline(gainFileHandle, line);
-	trim(line);
-
-	// tokenize header
-  vector<string> lineParts;
-  split(lineParts, line, "\t");
-  for(unsigned int nn=0; nn < lineParts.size(); ++nn) {
-  	nodeNames.push_back(lineParts[nn]);
-  	nodeNameIndex[lineParts[nn]] = nn;
-  }
-
-	// initialize dimensions of data matrix
-	size_t numVars = nodeNames.size();
-	if(!numVars) {
-		cerr << "ERROR: Could not parse SNP names from (re)GAIN file header" << endl;
-		return false;
+	for(unsigned int nn=0; nn < nodeNames.size(); ++nn) {
+		nodeNameIndex[nodeNames[nn]] = nn;
 	}
-	adjMatrix.resize(numVars, numVars);
-	numNodes = numVars;
-
-	// read numeric data into G
-	size_t row = 0;
-	vector<string> lineTokens;
-	unsigned int tokensExpected = numVars;
+	numNodes = nodeNames.size();
 	numEdges = 0;
-	while(getline(gainFileHandle, line)) {
-		trim(line);
-		lineTokens.clear();
-		split(lineTokens, line, "\t");
-		if(lineTokens.size() != tokensExpected) {
-			cerr << "ERROR line:" << endl << endl << line << endl << endl;
-			cerr << "ERROR: Could not parse (re)GAIN file row: " << (row+2) << endl
-					<< "Expecting " << tokensExpected << " values, got "
-					<< lineTokens.size() << endl;
-			return false;
-		}
-		size_t startIndex = numVars - tokensExpected;
-		for (size_t tokenIndex=0, col=startIndex; col < numVars; ++tokenIndex, ++col) {
-			string token = lineTokens[tokenIndex];
-			trim(token);
-			if(token == "") {
-				cerr << "ERROR: parsing line " << row << " col " << col
-						<< " of (re)Gain file, token [" << token << "]" << endl;
-				return false;
-			}
-			double t;
-			if(!from_string<double>(t, token, std::dec)) {
-				error("Parsing failed in REGAIN line:\n" + line);
-			}
-			adjMatrix(row, col) = t;
-			if((row != col) && isUpperTriangular) {
-				adjMatrix(col, row) = t;
-				++numEdges;
-			}
-		}
-		row++;
-		if(isUpperTriangular) {
-			--tokensExpected;
-		}
+	if(isUpperTriangular) {
+		numEdges = numNodes * (numNodes - 1) / 2;
 	}
 
-	gainFileHandle.close();
-
 	return true;
 }
 
@@ -797,7 +903,7 @@ bool InteractionNetwork::ripM(unsigned int pStartMergeOrder,
 }
 
 ModuleList InteractionNetwork::RecursiveIndirectPathsModularity(ModuleIndices thisModuleIdx) {
-	inbixEnv->printLOG("\n\nRIPM: Running Newman modularity on module size: " + 
+	LogMessage("\n\nRIPM: Running Newman modularity on module size: " + 
 		                 int2str(thisModuleIdx.size()) + "\n");
 	ModuleList thisInvocationResults;
 
@@ -810,17 +916,17 @@ ModuleList InteractionNetwork::RecursiveIndirectPathsModularity(ModuleIndices th
 	// else look at the partition of modules; there should be at least 2!
 	unsigned int numModules = modResult.second.size();
 	double Q = modResult.first;
-	inbixEnv->printLOG("Total modularity Q = " + dbl2str(Q) + "\n");
-	inbixEnv->printLOG("Newman modularity found " + int2str(numModules) + " modules" + "\n");
+	LogMessage("Total modularity Q = " + dbl2str(Q) + "\n");
+	LogMessage("Newman modularity found " + int2str(numModules) + " modules" + "\n");
 	for(unsigned int i=0; i < numModules; ++i) {
-		inbixEnv->printLOG("RIPM: Module: " + int2str(i) + 
+		LogMessage("RIPM: Module: " + int2str(i) + 
 			                 " size: " + int2str(modResult.second[i].size()) + "\n");
 	}
 	if(Q == 0) {
 		// BASIS: cannot do anything with this module, so return from 
 		// this level of recursion
-		inbixEnv->printLOG("RIPM: Q=0, Cannot split this module, saving as is\n");
-		inbixEnv->printLOG("RIPM: Exiting recursive rip-M algorithm\n");
+		LogMessage("RIPM: Q=0, Cannot split this module, saving as is\n");
+		LogMessage("RIPM: Exiting recursive rip-M algorithm\n");
 		DebugMessage("Returning existing module after GetNewmanModules failed");
 		thisInvocationResults.push_back(thisModuleIdx);
 		return thisInvocationResults;
@@ -828,30 +934,54 @@ ModuleList InteractionNetwork::RecursiveIndirectPathsModularity(ModuleIndices th
 
 	// look at the modules list to see if they need merging or further splitting
 	ModuleList smallModules;
+	vector<unsigned int> largeModules;
 	for(unsigned int i=0; i < numModules; ++i) {
 		ModuleIndices thisModule = modResult.second[i];
 		if(thisModule.size() > maxModuleSize) {
-			// RECURSION
-			inbixEnv->printLOG("RIPM: Recursing into rip-M algorithm module size: " + 
-				                 int2str(thisModule.size()) + "\n");
-			// 'results' is by reference and gets populated recursivesly here
-			ModuleList subLists = this->RecursiveIndirectPathsModularity(thisModule);
-			for(Indices i=0; i < subLists.size(); ++i) {
-				thisInvocationResults.push_back(subLists[i]);
-			}
+			largeModules.push_back(i);
 		} else {
 			if(thisModule.size() < maxModuleSize) {
 				// collect all modules less than max module size for merge attempt
-				inbixEnv->printLOG("RIPM: Collecting small module size: " + 
+				LogMessage("RIPM: Collecting small module size: " + 
 				                 int2str(thisModule.size()) + "\n");
 				smallModules.push_back(thisModule);
 			} 
 		}
 	}
 
+	// RECURSION: sibling modules are independent, so each is a task; results
+	// are gathered in module order whichever task finishes first
+	vector<ModuleList> subLists(largeModules.size());
+	auto recurseLargeModules = [&]() {
+		for(unsigned int l=0; l < largeModules.size(); ++l) {
+#pragma omp task firstprivate(l) shared(modResult, subLists, largeModules)
+			{
+				ModuleIndices thisModule = modResult.second[largeModules[l]];
+				LogMessage("RIPM: Recursing into rip-M algorithm module size: " + 
+				           int2str(thisModule.size()) + "\n");
+				subLists[l] = this->RecursiveIndirectPathsModularity(thisModule);
+			}
+		}
+#pragma omp taskwait
+	};
+	if((largeModules.size() > 1) && !omp_in_parallel()) {
+		// first fork: start the team that runs all nested tasks
+#pragma omp parallel
+#pragma omp single
+		recurseLargeModules();
+	}
+	else {
+		recurseLargeModules();
+	}
+	for(unsigned int l=0; l < subLists.size(); ++l) {
+		for(Indices i=0; i < subLists[l].size(); ++i) {
+			thisInvocationResults.push_back(subLists[l][i]);
+		}
+	}
+
 	if(smallModules.size() > 1) {
 		// MERGE: attempt to merge small modules list as a matrix of its own
-		inbixEnv->printLOG("RIPM: Merging small module matrix size: " + 
+		LogMessage("RIPM: Merging small module matrix size: " + 
 				               int2str(smallModules.size()) + "\n");
 		ModuleList smallModuleResults;
 		if(this->MergeSmallModules(smallModules, smallModuleResults)) {
@@ -883,7 +1013,7 @@ bool InteractionNetwork::GetNewmanModules(ModuleIndices thisModuleIdx,
 	// }
 	// cout << endl;
 	unsigned int n = thisModuleIdx.size();
-	if(par::verbose) inbixEnv->printLOG("RIPM: GetNewmanModules, module size: " + int2str(n) + "\n");
+	if(par::verbose) LogMessage("RIPM: GetNewmanModules, module size: " + int2str(n) + "\n");
 	if(n < 2) {
 		results.first = 0;
 		results.second.push_back(thisModuleIdx);
@@ -891,18 +1021,13 @@ bool InteractionNetwork::GetNewmanModules(ModuleIndices thisModuleIdx,
 		return false;
 	}
 
-	mat A = connMatrix(conv_to<uvec>::from(thisModuleIdx), 
-		                 conv_to<uvec>::from(thisModuleIdx));
-	rowvec k = sum(A, 0);
-	double m = 0.5 * sum(k);
-	colvec nodeDegrees = k.t();
+	sp_mat A;
+	subnetwork(connSparse, thisModuleIdx, A);
+	colvec nodeDegrees = sparseDegrees(A);
+	double m = 0.5 * accu(nodeDegrees);
 	//inbixEnv->printLOG("RIPM: GetNewmanModules, m: " + int2str(m) + "\n");
 
-	// real symmetric modularity matrix B
-	//inbixEnv->printLOG("RIPM: GetNewmanModules, Computing B matrix\n");
-	mat B;
-	B.resize(n, n);
-	B = A - nodeDegrees * nodeDegrees.t() / (2.0 * m);
+	// the modularity matrix B = A - k * k' / 2m is applied, never formed
   
 	// ------------------------- I T E R A T I O N ------------------------------
 	//inbixEnv->printLOG("RIPM: GetNewmanModules, Preparing stack with first module\n");
@@ -925,35 +1050,20 @@ bool InteractionNetwork::GetNewmanModules(ModuleIndices thisModuleIdx,
 		processStack.pop();
 		unsigned int newDim = thisModule.size();
 		if(newDim == 1) {
-			if(par::verbose) inbixEnv->printLOG("RIPM: GetNewmanModules, WARNING: SINGLETON detected, saving and continuing\n");
+			if(par::verbose) LogMessage("RIPM: GetNewmanModules, WARNING: SINGLETON detected, saving and continuing\n");
 			ModuleIndices singleton;
-			if(par::verbose) inbixEnv->printLOG("RIPM: Singleton value: " + int2str(thisModule[0]) + \
+			if(par::verbose) LogMessage("RIPM: Singleton value: " + int2str(thisModule[0]) + \
 				" maps to " + int2str(thisModuleIdx[thisModule[0]]) + "\n");
 			singleton.push_back(thisModuleIdx[thisModule[0]]);
 			results.second.push_back(singleton);
 			continue;
 		}
 
-		// get the submatrix Bg defined by the indices of this module (Eqn 6)
-		//inbixEnv->printLOG("RIPM: GetNewmanModules, Computing Bg submatrix dim: " + int2str(newDim) + "\n");
-		mat Bg(newDim, newDim);
-		for(Indices l1=0; l1 < newDim; ++l1) {
-			for(Indices l2=0; l2 < newDim; ++l2) {
-				// if(newDim < 1000) cout << thisModule[l1] <<  ", " << thisModule[l2] << endl;
-				Bg(l1, l2) = B(thisModule[l1], thisModule[l2]);
-			}
-		}
-
-		// adjust the diagonal
-		//inbixEnv->printLOG("RIPM: GetNewmanModules, Setting Bg diagonal\n");
-		rowvec rowsums = arma::sum(Bg, 0);
-		for(Indices i=0; i < rowsums.size(); ++i) {
-			Bg(i, i) = Bg(i, i) - rowsums(i);
-		}
-
-		// call the community finding/modularity function
+		// split on the leading eigenvector of Bg, the modularity matrix of
+		// this module with adjusted diagonal (Eqn 6)
 		//inbixEnv->printLOG("RIPM: GetNewmanModules, Eigenvector best split\n");
-		pair<double, vec> sub_modules = ModularityBestSplit(Bg, m);
+		pair<double, vec> sub_modules = ModularitySplit(A, nodeDegrees, m, 
+			thisModule);
 		double deltaQ = sub_modules.first;
 		vec s = sub_modules.second;
 
@@ -1016,56 +1126,81 @@ bool InteractionNetwork::MergeSmallModules(ModuleList smallModules,
 			allSmallModIdx.push_back(thisMatrixIdx);
 		}
 	}
-	mat A = connMatrix(conv_to<uvec>::from(allSmallModIdx), 
-                     conv_to<uvec>::from(allSmallModIdx));
-  ModuleIndices mergeModuleIdx;
-  for(Indices i=0; i <= allSmallModIdx.size(); ++i) {
-    mergeModuleIdx.push_back(i);
-  }
-          
-	// try Newman modularity on different power series matrices for indirect paths
+	if(maxMergeOrder < startMergeOrder) {
+		return false;
+	}
+
+	// merge orders are tried as tasks a batch at a time; Newman modularity
+	// splits the small modules' connSparse network at every order
+	unsigned int numOrders = maxMergeOrder - startMergeOrder + 1;
+	unsigned int batchSize = omp_in_parallel()? omp_get_num_threads(): 
+		omp_get_max_threads();
+	batchSize = std::max(batchSize, 1u);
+	vector<ModularityResult> allTryResults(numOrders);
+	vector<char> tryOk(numOrders);
+
+	// the lowest order with all Goldilocks modules wins, as in the serial
+	// search, so later batches are skipped once one is found; otherwise the 
+	// order with the fewest modules
 	bool found = false;
-	unsigned int thisMergeOrder = startMergeOrder;
 	unsigned int bestOrder = startMergeOrder;
-	unsigned int bestSize = A.n_cols;
-	vector<ModuleList> allModLists;
-	while(!found && (thisMergeOrder <= maxMergeOrder)) {
-	  inbixEnv->printLOG("RIPM: Merge order: " + int2str(thisMergeOrder) + "\n");	
-		mat tryMatrix;
-		this->SumMatrixPowerSeries(A, thisMergeOrder, tryMatrix);
-		ModularityResult tryResults;
-		if(!this->GetNewmanModules(allSmallModIdx, tryResults)) {
-			inbixEnv->printLOG("RIPM: Merge order: " + int2str(thisMergeOrder) + " FAILED\n");	
-			allModLists.push_back(tryResults.second);
-  		++thisMergeOrder;	
-			continue;
+	unsigned int bestSize = allSmallModIdx.size();
+	for(unsigned int first=0; (first < numOrders) && !found; first += batchSize) {
+		unsigned int last = std::min(first + batchSize, numOrders);
+		auto tryMergeOrders = [&]() {
+			for(unsigned int t=first; t < last; ++t) {
+#pragma omp task firstprivate(t) shared(allTryResults, tryOk, allSmallModIdx)
+				{
+					unsigned int thisMergeOrder = startMergeOrder + t;
+					LogMessage("RIPM: Merge order: " + int2str(thisMergeOrder) + "\n");	
+					tryOk[t] = this->GetNewmanModules(allSmallModIdx, allTryResults[t]);
+					if(!tryOk[t]) {
+						LogMessage("RIPM: Merge order: " + int2str(thisMergeOrder) + " FAILED\n");	
+					}
+				}
+			}
+#pragma omp taskwait
+		};
+		if(!omp_in_parallel()) {
+#pragma omp parallel
+#pragma omp single
+			tryMergeOrders();
+		}
+		else {
+			tryMergeOrders();
 		}
-		if(CheckMergeResults(tryResults)) {
-			// SUCCESS! all Goldilocks modules, so save all
-		  inbixEnv->printLOG("RIPM: Merge successful with all Goldilocks modules!\n");	
-			for(unsigned int i=0; i < tryResults.second.size(); ++i) {
-				ModuleIndices thisModule = tryResults.second[i];
-				results.push_back(thisModule);
+
+		for(unsigned int t=first; (t < last) && !found; ++t) {
+			unsigned int thisMergeOrder = startMergeOrder + t;
+			if(!tryOk[t]) {
+				continue;
+			}
+			if(CheckMergeResults(allTryResults[t])) {
+				// SUCCESS! all Goldilocks modules, so save all
+			  LogMessage("RIPM: Merge order: " + int2str(thisMergeOrder) + 
+			             " successful with all Goldilocks modules!\n");	
+				for(unsigned int i=0; i < allTryResults[t].second.size(); ++i) {
+					results.push_back(allTryResults[t].second[i]);
+				}
+				found = true;
+			} else {
+				// merge success but not all 'goldilocks' size
+			  LogMessage("RIPM: Merge order: " + int2str(thisMergeOrder) + 
+			             " successful but not all Goldilocks modules\n");	
+				if(allTryResults[t].second.size() < bestSize) {
+					bestSize = allTryResults[t].second.size();
+					bestOrder = thisMergeOrder;
+				} 
 			}
-			found = true;
-		} else {
-			// merge success but not all 'goldilocks' size
-		  inbixEnv->printLOG("RIPM: Merge successful but not all Goldilocks modules\n");	
-			if(tryResults.second.size() < bestSize) {
-				bestSize = tryResults.second.size();
-				bestOrder = thisMergeOrder;
-			} 
-			allModLists.push_back(tryResults.second);
 		}
-		++thisMergeOrder;	
 	}
 
 	if(!found) {
 		// return best module partition found - smallest
 		Indices bestResultIdx = bestOrder - startMergeOrder;
-		ModuleList bestResults = allModLists[bestResultIdx];
-		inbixEnv->printLOG("RIPM: Merge not successful, saving best\n");	
-		inbixEnv->printLOG("RIPM: Best result index: " + int2str(bestResultIdx) + "\n");	
+		ModuleList bestResults = allTryResults[bestResultIdx].second;
+		LogMessage("RIPM: Merge not successful, saving best\n");	
+		LogMessage("RIPM: Best result index: " + int2str(bestResultIdx) + "\n");	
 		for(Indices i=0; i < bestResults.size(); ++i) {
 			ModuleIndices thisModule = bestResults[i];
 			results.push_back(thisModule);
@@ -1075,16 +1210,22 @@ bool InteractionNetwork::MergeSmallModules(ModuleList smallModules,
 	return found;
 }
 
-bool InteractionNetwork::SumMatrixPowerSeries(mat& A, 
+bool InteractionNetwork::SumMatrixPowerSeries(const mat& A, 
 	                                            unsigned int maxPower,
-	                                            mat& B) {
-  B = A;
-  mat currPowerOfA = A;
-  if(maxPower >= 2) {
-    for(unsigned int i=1; i < maxPower; ++i) {
-      currPowerOfA = currPowerOfA * A;
-      B = B + currPowerOfA;
-    }
+	                                            unsigned int& sumPower,
+	                                            mat& currPowerOfA,
+	                                            mat& partialSum) {
+  // extends partialSum = A + A^2 + ... + A^sumPower, with currPowerOfA =
+  // A^sumPower, up to maxPower; sumPower 0 starts a new series
+  if(sumPower == 0) {
+    currPowerOfA = A;
+    partialSum = A;
+    sumPower = 1;
+  }
+  while(sumPower < maxPower) {
+    currPowerOfA = currPowerOfA * A;
+    partialSum += currPowerOfA;
+    ++sumPower;
   }
 
   return true;
@@ -1104,15 +1245,9 @@ bool InteractionNetwork::CheckMergeResults(ModularityResult results) {
 ModularityResult InteractionNetwork::ModularityLeadingEigenvector() {
 
 	PrepareConnectivityMatrix();
-	mat A = connMatrix;
-	degrees = sum(A, 0);
-	numEdges = 0.5 * sum(degrees);
 	colvec nodeDegrees = degrees.t();
 
-	// real symmetric modularity matrix B
-	mat B;
-	B.resize(numNodes, numNodes);
-	B = A - nodeDegrees * nodeDegrees.t() / (2.0 * numEdges);
+	// the modularity matrix B = A - k * k' / 2m is applied, never formed
   
 	// ------------------------- I T E R A T I O N ------------------------------
 	stack<vector<unsigned int> > processStack;
@@ -1133,22 +1268,10 @@ ModularityResult InteractionNetwork::ModularityLeadingEigenvector() {
 		processStack.pop();
 		unsigned int newDim = thisModule.size();
 
-		// get the submatrix Bg defined by the indices of this module (Eqn 6)
-		mat Bg(newDim, newDim);
-		for(unsigned int l1=0; l1 < newDim; ++l1) {
-			for(unsigned int l2=0; l2 < newDim; ++l2) {
-				Bg(l1, l2) = B(thisModule[l1], thisModule[l2]);
-			}
-		}
-
-		// adjust the diagonal
-		rowvec rowsums = arma::sum(Bg, 0);
-		for(unsigned int i=0; i < rowsums.size(); ++i) {
-			Bg(i, i) = Bg(i, i) - rowsums(i);
-		}
-
-		// call the community finding/modularity function
-		pair<double, vec> sub_modules = ModularityBestSplit(Bg, numEdges);
+		// split on the leading eigenvector of Bg, the modularity matrix of
+		// this module with adjusted diagonal (Eqn 6)
+		pair<double, vec> sub_modules = ModularitySplit(connSparse, nodeDegrees, 
+			numEdges, thisModule);
 		double deltaQ = sub_modules.first;
 		vec s = sub_modules.second;
 
@@ -1196,9 +1319,17 @@ bool InteractionNetwork::Homophily(HomophilyResult& results) {
 	double globalHomophily = 0.0;
 	vector<double> localHomophilies;
 
-	unsigned int totalNodes = connMatrix.n_cols;
+	unsigned int totalNodes = connSparse.n_cols;
 	// cout << "Total nodes: " << totalNodes << endl;
 
+	// module of each node
+	vector<long long> nodeModule(totalNodes, -1);
+	for(unsigned int i=0; i < modules.size(); ++i) {
+		for(unsigned int mi=0; mi < modules[i].size(); ++mi) {
+			nodeModule[modules[i][mi]] = i;
+		}
+	}
+
 	// for each module in the modules list
 	for(unsigned int i=0; i < modules.size(); ++i) {
 
@@ -1206,34 +1337,26 @@ bool InteractionNetwork::Homophily(HomophilyResult& results) {
 		unsigned int modSize = modules[i].size();
 		// cout << "Module size: " << modSize << endl;
 
-		uvec modIndices;
-		modIndices.set_size(modSize);
+		// get the number of internal connections, the upper triangle of the 
+		// module's symmetric submatrix, and the number of external connections
+		// to nodes in the other modules
+		double internalConnections = 0.0;
+		double externalConnections = 0.0;
 		for(unsigned int mi=0; mi < modSize; ++mi) {
-			modIndices(mi) = modules[i][mi];
-		}
-		// modIndices.print("module indices");
-
-		// get the indices of the nodes not in the module
-		uvec notIndices;
-		unsigned int notIndex = 0;
-		notIndices.set_size(totalNodes - modSize);
-		for(unsigned int j=0; j < modules.size(); ++j) {
-			if(j != i) {
-				for(unsigned int k=0; k < modules[j].size(); ++k) {
-					notIndices(notIndex) = modules[j][k];
-					++notIndex;
+			uword col = modules[i][mi];
+			for(uword k=connSparse.col_ptrs[col]; k < connSparse.col_ptrs[col + 1]; 
+					++k) {
+				uword row = connSparse.row_indices[k];
+				if(nodeModule[row] == (long long) i) {
+					if(row <= col) {
+						internalConnections += connSparse.values[k];
+					}
+				}
+				else if(nodeModule[row] >= 0) {
+					externalConnections += connSparse.values[k];
 				}
 			}
 		}
-		// notIndices.print("indices NOT in module");
-
-		// get the number of internal connections
-		mat modMatrix = connMatrix(modIndices, modIndices);
-		double internalConnections = sum(sum(trimatu(modMatrix)));
-
-		// get the number of external connections
-		mat notMatrix = connMatrix(modIndices, notIndices);
-		double externalConnections = sum(sum(notMatrix));
 
 //		cout << "int: " << internalConnections
 //				<< ", ext: " << externalConnections << endl;
@@ -1287,15 +1410,28 @@ double InteractionNetwork::ComputeQ() {
 	}
 
 	// m = number of edges
-  double m = sum(sum(connMatrix)) * 0.5;
+  double m = accu(connSparse) * 0.5;
+  // q sums (A_ij - k_i * k_j / 2m) * s_ij, s_ij = 1 within a module and -1 
+  // between; the k_i * k_j terms collect into module degree totals
   double q = 0.0;
-  for(unsigned int i=0; i < connMatrix.n_cols; ++i) {
-    for(unsigned int j=0; j < connMatrix.n_cols; ++j) {
-      double temp = (connMatrix(i, j) - degrees(i) * degrees(j) / (2.0 * m)) *
-					((double) (allModules[i] == allModules[j]) - 0.5) * 2.0;
-      q += temp;
+  for(uword j=0; j < connSparse.n_cols; ++j) {
+    for(uword k=connSparse.col_ptrs[j]; k < connSparse.col_ptrs[j + 1]; ++k) {
+      uword i = connSparse.row_indices[k];
+      q += (allModules[i] == allModules[j])? connSparse.values[k]: 
+        -connSparse.values[k];
     }
   }
+  vector<double> moduleDegrees(modules.size(), 0.0);
+  double totalDegree = 0.0;
+  for(unsigned int i=0; i < connSparse.n_cols; ++i) {
+    moduleDegrees[allModules[i]] += degrees(i);
+    totalDegree += degrees(i);
+  }
+  double withinDegrees = 0.0;
+  for(unsigned int c=0; c < moduleDegrees.size(); ++c) {
+    withinDegrees += moduleDegrees[c] * moduleDegrees[c];
+  }
+  q -= (2.0 * withinDegrees - totalDegree * totalDegree) / (2.0 * m);
   q /= (4.0 * m);
 
   return q;
@@ -1387,6 +1523,57 @@ void InteractionNetwork::SaveModules(string saveFilename) {
 	outputFileHandle.close();
 }
 
+pair<double, vec> 
+  InteractionNetwork::ModularitySplit(const sp_mat& A, const vec& k, double m,
+                                      const ModuleIndices& group) {
+	// Bg * x = A_g * x - k_g * (k_g' * x) / 2m - d % x, where d holds the row
+	// sums of the unadjusted Bg
+	sp_mat Ag;
+	subnetwork(A, group, Ag);
+	uword n = group.size();
+	vec kg(n);
+	for(uword i=0; i < n; ++i) {
+		kg(i) = k(group[i]);
+	}
+	double twoM = 2.0 * m;
+	vec d = sparseDegrees(Ag) - kg * (accu(kg) / twoM);
+	if(n <= DENSE_SPLIT_MAX_SIZE) {
+		mat Bg = mat(Ag) - kg * kg.t() / twoM;
+		Bg.diag() -= d;
+		return ModularityBestSplit(Bg, m);
+	}
+
+	auto applyBg = [&](const vec& x) -> vec {
+		vec y;
+		symmetricProduct(Ag, x, y);
+		y -= kg * (dot(kg, x) / twoM);
+		y -= d % x;
+		return y;
+	};
+	double Q = 0;
+	double eigval = 0;
+	vec s_out;
+	if(!lanczosLeading(applyBg, n, eigval, s_out)) {
+		LogMessage("WARNING: Lanczos leading eigenvector did not converge\n");
+	}
+	if(s_out.n_elem != n) {
+		LogMessage("WARNING: Lanczos decomposition failed, setting Q = 0\n");
+		return make_pair(Q, s_out);
+	}
+	for(uword i=0; i < n; ++i) {
+		s_out(i) = (s_out(i) < 0)? -1: 1;
+	}
+	Q = dot(s_out, applyBg(s_out)) / (m * 4.0);
+
+	// for now just check for whacky values  
+	if(std::isnan(Q) || std::isinf(Q)) {
+		LogMessage("WHACK VALUE, ana or +/-inf, setting to 0\n");
+		Q = 0;
+	}
+
+	return make_pair(Q, s_out);
+}
+
 pair<double, vec> 
   InteractionNetwork::ModularityBestSplit(mat& B, double m) {
 
@@ -1418,12 +1605,12 @@ pair<double, vec>
     Q = Q_mat(0, 0);
     Q *= (1.0 / (m * 4.0));
   } else {
-    PP->printLOG("WARNING: eig_sym decomposition failed, setting Q = 0\n");
+    LogMessage("WARNING: eig_sym decomposition failed, setting Q = 0\n");
   }
 
 	// for now just check for whacky values  
   if(std::isnan(Q) || std::isinf(Q)) {
-  	PP->printLOG("WHACK VALUE, ana or +/-inf, setting to 0");
+  	LogMessage("WHACK VALUE, ana or +/-inf, setting to 0\n");
   	Q = 0;
   }
 
@@ -126,8 +126,11 @@ private:
 
 	// logging
 	void DebugMessage(std::string msg);
+	void LogMessage(std::string msg);
 
 	// modularity support methods
+	std::pair<double, arma::vec> ModularitySplit(const arma::sp_mat& A,
+		const arma::vec& k, double m, const ModuleIndices& group);
 	std::pair<double, arma::vec> ModularityBestSplit(arma::mat& B, double m);
 	vector<unsigned int> FlattenModules();
 
@@ -137,7 +140,9 @@ private:
 		                    ModularityResult& results);
 	bool MergeSmallModules(ModuleList smallModules,
 		                     ModuleList& results);
-	bool SumMatrixPowerSeries(arma::mat& A, unsigned int maxPower, arma::mat& B);
+	bool SumMatrixPowerSeries(const arma::mat& A, unsigned int maxPower,
+		                        unsigned int& sumPower, arma::mat& currPowerOfA,
+		                        arma::mat& partialSum);
 	bool CheckMergeResults(ModularityResult results);
 
 	// modules
@@ -152,8 +157,8 @@ private:
 
 	// adjacency matrix
 	arma::mat adjMatrix;
-	// connectivity matrix
-	arma::mat connMatrix;
+	// connectivity matrix, thresholded from the adjacency matrix
+	arma::sp_mat connSparse;
 
 	// node degrees - not necessarily discrete
 	arma::rowvec degrees;
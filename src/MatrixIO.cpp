@@ -0,0 +1,690 @@
+/* =============================================================================
+ * Filename: MatrixIO.cpp
+ *
+ * Description:  Parallel text and block-compressed binary matrix files.
+ * =============================================================================
+ */
+
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <stdint.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <omp.h>
+#include <armadillo>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#include "plink.h"
+#include "options.h"
+#include "helper.h"
+#include "StringUtils.h"
+#include "MatrixIO.h"
+#include "Insilico.h"
+
+using namespace std;
+using namespace arma;
+using namespace insilico;
+
+static const char MATRIX_MAGIC[8] = {'I', 'N', 'B', 'I', 'X', 'M', 'A', 'T'};
+static const uint32_t MATRIX_VERSION = 1;
+// rows formatted or parsed by each thread between sequential writes/reads
+static const uword TEXT_ROWS_PER_THREAD = 64;
+// uncompressed size of a binary block
+static const uword BINARY_BLOCK_BYTES = 8 << 20;
+
+// -------------------------- text formatting ---------------------------------
+
+static const double POW10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+static const double POW10_EXPONENT[] = {
+  1e-4, 1e-3, 1e-2, 1e-1, 1e0, 1e1, 1e2, 1e3, 1e4, 1e5
+};
+
+// six significant digits like the default stream output; fixed notation is
+// built from an integer mantissa, only exponent notation uses snprintf
+static int formatValue(double value, char* out) {
+  if(value == 0.0) {
+    if(signbit(value)) {
+      out[0] = '-';
+      out[1] = '0';
+      return 2;
+    }
+    out[0] = '0';
+    return 1;
+  }
+  double absValue = fabs(value);
+  if(!(absValue >= 1e-4 && absValue < 1e6)) {
+    // exponent notation, nan and inf
+    return snprintf(out, 32, "%g", value);
+  }
+  int exponent = 5;
+  while(absValue < POW10_EXPONENT[exponent + 4]) {
+    --exponent;
+  }
+  // round the scaled value half to even on its exact decimal expansion, as
+  // printf does; a tie in the scaled double may hide the product rounding
+  double scaled = absValue * POW10[5 - exponent];
+  double whole = floor(scaled);
+  double half = (scaled - whole) - 0.5;
+  long long mantissa = (long long) whole;
+  if(half == 0) {
+    double productError = fma(absValue, POW10[5 - exponent], -scaled);
+    if((productError > 0) || ((productError == 0) && (mantissa & 1))) {
+      ++mantissa;
+    }
+  } else if(half > 0) {
+    ++mantissa;
+  }
+  if(mantissa >= 1000000) {
+    mantissa /= 10;
+    ++exponent;
+    if(exponent > 5) {
+      return snprintf(out, 32, "%g", value);
+    }
+  }
+  char digits[6];
+  for(int d=5; d >= 0; --d) {
+    digits[d] = '0' + (mantissa % 10);
+    mantissa /= 10;
+  }
+  int numDigits = 6;
+  while(numDigits > 1 && digits[numDigits - 1] == '0') {
+    --numDigits;
+  }
+  int pos = 0;
+  if(value < 0) {
+    out[pos++] = '-';
+  }
+  if(exponent >= 0) {
+    for(int d=0; d <= exponent; ++d) {
+      out[pos++] = digits[d];
+    }
+    if(numDigits > exponent + 1) {
+      out[pos++] = '.';
+      for(int d=exponent + 1; d < numDigits; ++d) {
+        out[pos++] = digits[d];
+      }
+    }
+  } else {
+    out[pos++] = '0';
+    out[pos++] = '.';
+    for(int z=0; z < -exponent - 1; ++z) {
+      out[pos++] = '0';
+    }
+    for(int d=0; d < numDigits; ++d) {
+      out[pos++] = digits[d];
+    }
+  }
+
+  return pos;
+}
+
+// -------------------------- row sources -------------------------------------
+// the writers load a batch of rows, then read values of those rows only
+
+template <class eT>
+class DenseRows {
+public:
+  DenseRows(const Mat<eT>& matrix): m(matrix) {}
+  uword rows() const { return m.n_rows; }
+  uword cols() const { return m.n_cols; }
+  void load(uword firstRow, uword lastRow) {}
+  double operator()(uword i, uword j) const { return (double) m(i, j); }
+private:
+  const Mat<eT>& m;
+};
+
+// a sparse matrix is expanded one batch of rows at a time: rows of m are 
+// the contiguous columns of its transpose
+class SparseRows {
+public:
+  SparseRows(const sp_mat& matrix): mt(matrix.t()), batchFirstRow(0) {}
+  uword rows() const { return mt.n_cols; }
+  uword cols() const { return mt.n_rows; }
+  void load(uword firstRow, uword lastRow) {
+    batchFirstRow = firstRow;
+    batch = mat(mt.cols(firstRow, lastRow - 1));
+  }
+  double operator()(uword i, uword j) const { 
+    return batch(j, i - batchFirstRow); 
+  }
+private:
+  sp_mat mt;
+  mat batch;
+  uword batchFirstRow;
+};
+
+template <class Rows>
+static bool writeText(Rows& m, string filename,
+                      const vector<string>& names) {
+  ofstream outFile(filename.c_str(), ios::out | ios::binary);
+  if(outFile.fail()) {
+    cerr << "ERROR: Could not open matrix file for writing: " << filename << endl;
+    return false;
+  }
+  for(uword h=0; h < names.size(); ++h) {
+    if(h) {
+      outFile << "\t";
+    }
+    outFile << names[h];
+  }
+  outFile << "\n";
+
+  uword numRows = m.rows();
+  uword numCols = m.cols();
+  uword rowsPerBatch = TEXT_ROWS_PER_THREAD * omp_get_max_threads();
+  vector<string> rowText(rowsPerBatch);
+  for(uword firstRow=0; firstRow < numRows; firstRow += rowsPerBatch) {
+    uword lastRow = std::min(firstRow + rowsPerBatch, numRows);
+    m.load(firstRow, lastRow);
+#pragma omp parallel for schedule(dynamic, 1)
+    for(uword i=firstRow; i < lastRow; ++i) {
+      string& text = rowText[i - firstRow];
+      text.clear();
+      text.reserve(numCols * 12);
+      char buffer[32];
+      for(uword j=0; j < numCols; ++j) {
+        if(j) {
+          text += '\t';
+        }
+        int length = formatValue(m(i, j), buffer);
+        text.append(buffer, length);
+      }
+      text += '\n';
+    }
+    for(uword i=firstRow; i < lastRow; ++i) {
+      const string& text = rowText[i - firstRow];
+      outFile.write(text.data(), text.size());
+    }
+  }
+  bool ok = !outFile.fail();
+  outFile.close();
+
+  return ok;
+}
+
+bool armaWriteTextMatrix(const mat& m, string filename,
+                         const vector<string>& names) {
+  DenseRows<double> rows(m);
+  return writeText(rows, filename, names);
+}
+
+bool armaWriteTextMatrix(const fmat& m, string filename,
+                         const vector<string>& names) {
+  DenseRows<float> rows(m);
+  return writeText(rows, filename, names);
+}
+
+bool armaWriteTextMatrix(const sp_mat& m, string filename,
+                         const vector<string>& names) {
+  SparseRows rows(m);
+  return writeText(rows, filename, names);
+}
+
+// ---------------------------- text parsing ----------------------------------
+
+// parse one data row into m; upper triangular rows start at the diagonal
+static bool parseRow(const string& line, uword row, bool isUpperTriangular,
+                     mat& m) {
+  uword numVars = m.n_cols;
+  uword startCol = isUpperTriangular? row: 0;
+  const char* pos = line.c_str();
+  for(uword col=startCol; col < numVars; ++col) {
+    char* end = 0;
+    double value = strtod(pos, &end);
+    if(end == pos) {
+      return false;
+    }
+    if(*end && !isspace(*end)) {
+      return false;
+    }
+    pos = end;
+    m(row, col) = value;
+    if(isUpperTriangular && (row != col)) {
+      m(col, row) = value;
+    }
+  }
+  while(*pos) {
+    if(!isspace(*pos)) {
+      return false;
+    }
+    ++pos;
+  }
+
+  return true;
+}
+
+bool armaReadTextMatrix(string filename, mat& m, vector<string>& names,
+                        bool isUpperTriangular) {
+  ifstream inFile(filename.c_str());
+  if(!inFile.is_open()) {
+    cerr << "ERROR: Could not open matrix file: " << filename << endl;
+    return false;
+  }
+
+  // header of variable names; tab-delimited names may contain spaces
+  string line;
+  getline(inFile, line);
+  string header = trim(line);
+  names.clear();
+  if(header.find('\t') != string::npos) {
+    split(names, header, "\t");
+  } else {
+    split(names, header);
+  }
+  uword numVars = names.size();
+  if(!numVars) {
+    cerr << "ERROR: Could not parse variable names from matrix file header: "
+      << filename << endl;
+    return false;
+  }
+  m.set_size(numVars, numVars);
+
+  uword rowsPerBatch = TEXT_ROWS_PER_THREAD * omp_get_max_threads();
+  vector<string> rowText(rowsPerBatch);
+  vector<char> rowOk(rowsPerBatch);
+  uword row = 0;
+  bool moreLines = true;
+  while(moreLines) {
+    uword batchRows = 0;
+    while(batchRows < rowsPerBatch) {
+      if(!getline(inFile, rowText[batchRows])) {
+        moreLines = false;
+        break;
+      }
+      if(rowText[batchRows].find_first_not_of(" \t\r\n") == string::npos) {
+        continue;
+      }
+      ++batchRows;
+    }
+    if(row + batchRows > numVars) {
+      cerr << "ERROR: Matrix file has more rows than header variables: "
+        << filename << endl;
+      return false;
+    }
+#pragma omp parallel for schedule(dynamic, 1)
+    for(uword r=0; r < batchRows; ++r) {
+      rowOk[r] = parseRow(rowText[r], row + r, isUpperTriangular, m);
+    }
+    for(uword r=0; r < batchRows; ++r) {
+      if(!rowOk[r]) {
+        cerr << "ERROR: Could not parse matrix file row: " << (row + r + 2)
+          << endl << "Expecting "
+          << (isUpperTriangular? (numVars - row - r): numVars)
+          << " numeric values" << endl;
+        return false;
+      }
+    }
+    row += batchRows;
+  }
+  inFile.close();
+  if(row != numVars) {
+    cerr << "ERROR: Matrix file has " << row << " rows, expected " << numVars
+      << ": " << filename << endl;
+    return false;
+  }
+
+  return true;
+}
+
+// ------------------------------ binary --------------------------------------
+
+template <class T>
+static void writeValue(ofstream& outFile, T value) {
+  outFile.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <class T>
+static bool readValue(ifstream& inFile, T& value) {
+  inFile.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return !inFile.fail();
+}
+
+struct BinaryLayout {
+  uint32_t flags;
+  uword rows;
+  uword cols;
+  uword rowsPerBlock;
+  uword numBlocks;
+  size_t valueSize;
+  // offset of the first stored value of each row within its block
+  vector<uword> rowOffset;
+  // stored values of each block
+  vector<uword> blockValues;
+};
+
+static void setupLayout(BinaryLayout& layout) {
+  bool upper = layout.flags & MATRIX_BINARY_UPPER;
+  layout.valueSize = (layout.flags & MATRIX_BINARY_FLOAT)? sizeof(float):
+    sizeof(double);
+  layout.numBlocks = layout.rows?
+    ((layout.rows - 1) / layout.rowsPerBlock + 1): 0;
+  layout.rowOffset.resize(layout.rows);
+  layout.blockValues.assign(layout.numBlocks, 0);
+  for(uword i=0; i < layout.rows; ++i) {
+    uword block = i / layout.rowsPerBlock;
+    layout.rowOffset[i] = layout.blockValues[block];
+    layout.blockValues[block] += upper? (layout.cols - i): layout.cols;
+  }
+}
+
+// copy block rows into the stored layout, walking columns for contiguous reads
+template <class Rows>
+static void packBlock(const Rows& m, const BinaryLayout& layout,
+                      uword block, vector<char>& raw) {
+  bool upper = layout.flags & MATRIX_BINARY_UPPER;
+  bool single = layout.flags & MATRIX_BINARY_FLOAT;
+  uword firstRow = block * layout.rowsPerBlock;
+  uword lastRow = std::min(firstRow + layout.rowsPerBlock, layout.rows);
+  raw.resize(layout.blockValues[block] * layout.valueSize);
+  for(uword j=0; j < layout.cols; ++j) {
+    uword endRow = upper? std::min(lastRow, j + 1): lastRow;
+    for(uword i=firstRow; i < endRow; ++i) {
+      uword index = layout.rowOffset[i] + (upper? (j - i): j);
+      if(single) {
+        float value = (float) m(i, j);
+        memcpy(&raw[index * sizeof(float)], &value, sizeof(float));
+      } else {
+        double value = m(i, j);
+        memcpy(&raw[index * sizeof(double)], &value, sizeof(double));
+      }
+    }
+  }
+}
+
+static void unpackBlock(const vector<char>& raw, const BinaryLayout& layout,
+                        uword block, mat& m) {
+  bool upper = layout.flags & MATRIX_BINARY_UPPER;
+  bool single = layout.flags & MATRIX_BINARY_FLOAT;
+  uword firstRow = block * layout.rowsPerBlock;
+  uword lastRow = std::min(firstRow + layout.rowsPerBlock, layout.rows);
+  for(uword j=0; j < layout.cols; ++j) {
+    uword endRow = upper? std::min(lastRow, j + 1): lastRow;
+    for(uword i=firstRow; i < endRow; ++i) {
+      uword index = layout.rowOffset[i] + (upper? (j - i): j);
+      double value = 0;
+      if(single) {
+        float singleValue = 0;
+        memcpy(&singleValue, &raw[index * sizeof(float)], sizeof(float));
+        value = singleValue;
+      } else {
+        memcpy(&value, &raw[index * sizeof(double)], sizeof(double));
+      }
+      m(i, j) = value;
+      if(upper) {
+        m(j, i) = value;
+      }
+    }
+  }
+}
+
+template <class Rows>
+static bool writeBinary(Rows& m, string filename,
+                        const vector<string>& names, unsigned int flags) {
+  if((flags & MATRIX_BINARY_UPPER) && (m.rows() != m.cols())) {
+    PP->printLOG("WARNING: Writing the full matrix, not square: " +
+                 filename + "\n");
+    flags &= ~MATRIX_BINARY_UPPER;
+  }
+#ifndef WITH_ZLIB
+  if(flags & MATRIX_BINARY_ZLIB) {
+    PP->printLOG("WARNING: Writing uncompressed matrix, no zlib support: " +
+                 filename + "\n");
+    flags &= ~MATRIX_BINARY_ZLIB;
+  }
+#endif
+  ofstream outFile(filename.c_str(), ios::out | ios::binary);
+  if(outFile.fail()) {
+    cerr << "ERROR: Could not open matrix file for writing: " << filename << endl;
+    return false;
+  }
+
+  BinaryLayout layout;
+  layout.flags = flags;
+  layout.rows = m.rows();
+  layout.cols = m.cols();
+  size_t rowBytes = layout.cols *
+    ((flags & MATRIX_BINARY_FLOAT)? sizeof(float): sizeof(double));
+  layout.rowsPerBlock = rowBytes? std::max((uword) 1,
+                                           (uword) (BINARY_BLOCK_BYTES / rowBytes)): 1;
+  setupLayout(layout);
+
+  outFile.write(MATRIX_MAGIC, sizeof(MATRIX_MAGIC));
+  writeValue<uint32_t>(outFile, MATRIX_VERSION);
+  writeValue<uint32_t>(outFile, layout.flags);
+  writeValue<uint64_t>(outFile, layout.rows);
+  writeValue<uint64_t>(outFile, layout.cols);
+  writeValue<uint32_t>(outFile, names.size());
+  for(uword h=0; h < names.size(); ++h) {
+    writeValue<uint32_t>(outFile, names[h].size());
+    outFile.write(names[h].data(), names[h].size());
+  }
+  writeValue<uint32_t>(outFile, layout.rowsPerBlock);
+
+  // pack and compress a batch of blocks in parallel, then write in order
+  uword blocksPerBatch = omp_get_max_threads();
+  vector<vector<char> > raw(blocksPerBatch);
+  vector<vector<char> > stored(blocksPerBatch);
+  vector<char> blockOk(blocksPerBatch);
+  for(uword firstBlock=0; firstBlock < layout.numBlocks;
+      firstBlock += blocksPerBatch) {
+    uword batchBlocks = std::min(blocksPerBatch, layout.numBlocks - firstBlock);
+    m.load(firstBlock * layout.rowsPerBlock, 
+           std::min((firstBlock + batchBlocks) * layout.rowsPerBlock, 
+                    layout.rows));
+#pragma omp parallel for schedule(dynamic, 1)
+    for(uword b=0; b < batchBlocks; ++b) {
+      packBlock(m, layout, firstBlock + b, raw[b]);
+      blockOk[b] = true;
+#ifdef WITH_ZLIB
+      if((flags & MATRIX_BINARY_ZLIB) && raw[b].size()) {
+        uLongf storedBytes = compressBound(raw[b].size());
+        stored[b].resize(storedBytes);
+        blockOk[b] = compress2((Bytef*) &stored[b][0], &storedBytes,
+                               (const Bytef*) &raw[b][0], raw[b].size(),
+                               Z_BEST_SPEED) == Z_OK;
+        stored[b].resize(storedBytes);
+      }
+#endif
+    }
+    for(uword b=0; b < batchBlocks; ++b) {
+      if(!blockOk[b]) {
+        cerr << "ERROR: Compressing matrix block " << (firstBlock + b)
+          << ": " << filename << endl;
+        return false;
+      }
+      const vector<char>& bytes = (flags & MATRIX_BINARY_ZLIB)? stored[b]: raw[b];
+      writeValue<uint64_t>(outFile, bytes.size());
+      writeValue<uint64_t>(outFile, raw[b].size());
+      if(bytes.size()) {
+        outFile.write(&bytes[0], bytes.size());
+      }
+    }
+  }
+  bool ok = !outFile.fail();
+  outFile.close();
+
+  return ok;
+}
+
+bool armaWriteBinaryMatrix(const mat& m, string filename,
+                           const vector<string>& names, unsigned int flags) {
+  DenseRows<double> rows(m);
+  return writeBinary(rows, filename, names, flags);
+}
+
+bool armaWriteBinaryMatrix(const fmat& m, string filename,
+                           const vector<string>& names, unsigned int flags) {
+  DenseRows<float> rows(m);
+  return writeBinary(rows, filename, names, flags);
+}
+
+bool armaWriteBinaryMatrix(const sp_mat& m, string filename,
+                           const vector<string>& names, unsigned int flags) {
+  SparseRows rows(m);
+  return writeBinary(rows, filename, names, flags);
+}
+
+bool armaIsBinaryMatrixFile(string filename) {
+  ifstream inFile(filename.c_str(), ios::in | ios::binary);
+  if(!inFile.is_open()) {
+    return false;
+  }
+  char magic[sizeof(MATRIX_MAGIC)];
+  inFile.read(magic, sizeof(magic));
+  if(inFile.gcount() != sizeof(magic)) {
+    return false;
+  }
+
+  return memcmp(magic, MATRIX_MAGIC, sizeof(magic)) == 0;
+}
+
+bool armaReadBinaryMatrix(string filename, mat& m, vector<string>& names) {
+  ifstream inFile(filename.c_str(), ios::in | ios::binary);
+  if(!inFile.is_open()) {
+    cerr << "ERROR: Could not open matrix file: " << filename << endl;
+    return false;
+  }
+  char magic[sizeof(MATRIX_MAGIC)];
+  inFile.read(magic, sizeof(magic));
+  uint32_t version = 0;
+  uint32_t flags = 0;
+  uint64_t rows = 0;
+  uint64_t cols = 0;
+  uint32_t numNames = 0;
+  if(inFile.fail() || memcmp(magic, MATRIX_MAGIC, sizeof(magic)) ||
+     !readValue(inFile, version) || (version > MATRIX_VERSION) ||
+     !readValue(inFile, flags) || !readValue(inFile, rows) ||
+     !readValue(inFile, cols) || !readValue(inFile, numNames)) {
+    cerr << "ERROR: Not a binary matrix file or unsupported version: "
+      << filename << endl;
+    return false;
+  }
+#ifndef WITH_ZLIB
+  if(flags & MATRIX_BINARY_ZLIB) {
+    cerr << "ERROR: Compressed matrix file needs zlib support: " << filename
+      << endl;
+    return false;
+  }
+#endif
+  if((flags & MATRIX_BINARY_UPPER) && (rows != cols)) {
+    cerr << "ERROR: Upper triangular matrix file is not square: " << filename
+      << endl;
+    return false;
+  }
+  names.resize(numNames);
+  for(uint32_t h=0; h < numNames; ++h) {
+    uint32_t length = 0;
+    if(!readValue(inFile, length)) {
+      cerr << "ERROR: Reading matrix file names: " << filename << endl;
+      return false;
+    }
+    names[h].resize(length);
+    if(length) {
+      inFile.read(&names[h][0], length);
+    }
+  }
+  uint32_t rowsPerBlock = 0;
+  if(!readValue(inFile, rowsPerBlock) || !rowsPerBlock) {
+    cerr << "ERROR: Reading matrix file header: " << filename << endl;
+    return false;
+  }
+
+  BinaryLayout layout;
+  layout.flags = flags;
+  layout.rows = rows;
+  layout.cols = cols;
+  layout.rowsPerBlock = rowsPerBlock;
+  setupLayout(layout);
+  m.set_size(rows, cols);
+
+  // read a batch of blocks in order, then decompress and unpack in parallel
+  uword blocksPerBatch = omp_get_max_threads();
+  vector<vector<char> > raw(blocksPerBatch);
+  vector<vector<char> > stored(blocksPerBatch);
+  vector<char> blockOk(blocksPerBatch);
+  for(uword firstBlock=0; firstBlock < layout.numBlocks;
+      firstBlock += blocksPerBatch) {
+    uword batchBlocks = std::min(blocksPerBatch, layout.numBlocks - firstBlock);
+    for(uword b=0; b < batchBlocks; ++b) {
+      uint64_t storedBytes = 0;
+      uint64_t rawBytes = 0;
+      if(!readValue(inFile, storedBytes) || !readValue(inFile, rawBytes) ||
+         (rawBytes != layout.blockValues[firstBlock + b] * layout.valueSize)) {
+        cerr << "ERROR: Reading matrix block " << (firstBlock + b) << ": "
+          << filename << endl;
+        return false;
+      }
+      vector<char>& bytes = (flags & MATRIX_BINARY_ZLIB)? stored[b]: raw[b];
+      bytes.resize(storedBytes);
+      if(storedBytes) {
+        inFile.read(&bytes[0], storedBytes);
+      }
+      if(inFile.fail()) {
+        cerr << "ERROR: Truncated matrix file: " << filename << endl;
+        return false;
+      }
+      raw[b].resize(rawBytes);
+    }
+#pragma omp parallel for schedule(dynamic, 1)
+    for(uword b=0; b < batchBlocks; ++b) {
+      blockOk[b] = true;
+#ifdef WITH_ZLIB
+      if((flags & MATRIX_BINARY_ZLIB) && raw[b].size()) {
+        uLongf rawBytes = raw[b].size();
+        blockOk[b] = (uncompress((Bytef*) &raw[b][0], &rawBytes,
+                                 (const Bytef*) &stored[b][0],
+                                 stored[b].size()) == Z_OK) &&
+          (rawBytes == raw[b].size());
+      }
+#endif
+      if(blockOk[b]) {
+        unpackBlock(raw[b], layout, firstBlock + b, m);
+      }
+    }
+    for(uword b=0; b < batchBlocks; ++b) {
+      if(!blockOk[b]) {
+        cerr << "ERROR: Decompressing matrix block " << (firstBlock + b)
+          << ": " << filename << endl;
+        return false;
+      }
+    }
+  }
+  inFile.close();
+
+  return true;
+}
+
+bool armaReadGainMatrix(string filename, mat& m, vector<string>& names,
+                        bool isUpperTriangular) {
+  if(armaIsBinaryMatrixFile(filename)) {
+    return armaReadBinaryMatrix(filename, m, names);
+  }
+
+  return armaReadTextMatrix(filename, m, names, isUpperTriangular);
+}
+
+unsigned int matrixBinaryFlags() {
+  unsigned int flags = 0;
+  if(par::matrix_binary_upper) {
+    flags |= MATRIX_BINARY_UPPER;
+  }
+  if(par::matrix_binary_float32) {
+    flags |= MATRIX_BINARY_FLOAT;
+  }
+  if(par::matrix_binary_compress) {
+    flags |= MATRIX_BINARY_ZLIB;
+  }
+
+  return flags;
+}
@@ -0,0 +1,69 @@
+/*==============================================================================
+ *
+ * Filename:  MatrixIO.h
+ *
+ * Description:  Fast reading and writing of the large variable-by-variable
+ * matrices produced by dcGAIN, reGAIN and coexpression. Text matrices are
+ * formatted and parsed in row blocks on worker threads. The binary format is
+ * a header with dimensions and variable names followed by the raw values in
+ * row blocks; the blocks may hold only the upper triangle, single precision
+ * values or zlib-compressed bytes.
+ *
+ * Binary layout (native byte order):
+ *   char[8]  "INBIXMAT"
+ *   uint32   version
+ *   uint32   flags (MATRIX_BINARY_*)
+ *   uint64   rows, cols
+ *   uint32   number of names, then per name uint32 length and characters
+ *   uint32   rows per block
+ *   blocks   uint64 stored bytes and uint64 raw bytes, then the bytes
+ * =============================================================================
+ */
+
+#ifndef __MATRIX_IO_H__
+#define __MATRIX_IO_H__
+
+#include <string>
+#include <vector>
+
+#include <armadillo>
+
+const unsigned int MATRIX_BINARY_UPPER = 1;
+const unsigned int MATRIX_BINARY_FLOAT = 2;
+const unsigned int MATRIX_BINARY_ZLIB = 4;
+
+// true if the file starts with the binary matrix magic
+bool armaIsBinaryMatrixFile(std::string filename);
+// binary matrix files; reading always expands to the full matrix
+bool armaWriteBinaryMatrix(const arma::mat& m, std::string filename,
+                           const std::vector<std::string>& names,
+                           unsigned int flags);
+bool armaWriteBinaryMatrix(const arma::fmat& m, std::string filename,
+                           const std::vector<std::string>& names,
+                           unsigned int flags);
+// sparse matrices are expanded a block of rows at a time
+bool armaWriteBinaryMatrix(const arma::sp_mat& m, std::string filename,
+                           const std::vector<std::string>& names,
+                           unsigned int flags);
+bool armaReadBinaryMatrix(std::string filename, arma::mat& m,
+                          std::vector<std::string>& names);
+// tab-delimited text with a header line of names, formatted in parallel
+bool armaWriteTextMatrix(const arma::mat& m, std::string filename,
+                         const std::vector<std::string>& names);
+bool armaWriteTextMatrix(const arma::fmat& m, std::string filename,
+                         const std::vector<std::string>& names);
+bool armaWriteTextMatrix(const arma::sp_mat& m, std::string filename,
+                         const std::vector<std::string>& names);
+// header line of names then numeric rows, parsed in parallel; upper
+// triangular files have one value fewer on each row and are mirrored
+bool armaReadTextMatrix(std::string filename, arma::mat& m,
+                        std::vector<std::string>& names,
+                        bool isUpperTriangular);
+// binary or text, detected from the file contents
+bool armaReadGainMatrix(std::string filename, arma::mat& m,
+                        std::vector<std::string>& names,
+                        bool isUpperTriangular);
+// binary flags from the --matrix-binary options
+unsigned int matrixBinaryFlags();
+
+#endif
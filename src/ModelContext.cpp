@@ -0,0 +1,167 @@
+/* =============================================================================
+ * Filename: ModelContext.cpp
+ *
+ * Description:  Reusable per-thread regression models.
+ * =============================================================================
+ */
+
+#include <vector>
+#include <string>
+
+#include <omp.h>
+
+#include "plink.h"
+#include "options.h"
+#include "helper.h"
+#include "model.h"
+#include "linear.h"
+#include "logistic.h"
+#include "ModelContext.h"
+#include "Insilico.h"
+
+using namespace std;
+
+ModelContext::ModelContext(ModelContextCovariateOrder covarOrder, 
+                           bool forceLinear) {
+  covariateOrder = covarOrder;
+  // logistic regression for binary phenotypes (traits), linear otherwise
+  useLogistic = par::bt && !forceLinear;
+  // models are created by their threads on first use
+  ThreadSlot emptySlot;
+  emptySlot.model = 0;
+  emptySlot.varA = -1;
+  emptySlot.varB = -1;
+  emptySlot.labeled = false;
+  slots.resize(omp_get_max_threads(), emptySlot);
+}
+
+ModelContext::~ModelContext() {
+  for(uint i=0; i < slots.size(); ++i) {
+    if(slots[i].model) {
+      delete slots[i].model;
+    }
+  }
+}
+
+Model* ModelContext::reset(uint newVarA) {
+  ThreadSlot& slot = threadSlot();
+  Model* model = slot.model;
+  model->resetTerms();
+  model->setMissing();
+  slot.varA = newVarA;
+  slot.varB = -1;
+  slot.labeled = false;
+  addTerm(model, newVarA);
+  model->testParameter = 1; // single variable main effect
+  if(par::covar_file) {
+    for(uint i=0; i < par::clist_number; ++i) {
+      model->addCovariate(i);
+    }
+  }
+  // the parameter filter of buildDesignMatrix() selects labels
+  if(par::glm_user_parameters) {
+    addLabels(slot);
+  }
+
+  return model;
+}
+
+Model* ModelContext::reset(uint newVarA, uint newVarB) {
+  ThreadSlot& slot = threadSlot();
+  Model* model = slot.model;
+  model->resetTerms();
+  model->setMissing();
+  slot.varA = newVarA;
+  slot.varB = newVarB;
+  slot.labeled = false;
+  addTerm(model, newVarA);
+  addTerm(model, newVarB);
+  if(covariateOrder == MODEL_CONTEXT_COVARS_LAST) {
+    model->addInteraction(1, 2);
+  }
+  if(par::covar_file) {
+    for(uint i=0; i < par::clist_number; ++i) {
+      model->addCovariate(i);
+    }
+  }
+  if(covariateOrder == MODEL_CONTEXT_COVARS_BEFORE_EPI) {
+    model->addInteraction(1, 2);
+  }
+  model->testParameter = 3;
+  if(par::covar_file) {
+    model->testParameter += par::clist_number;
+  }
+  if(par::glm_user_parameters) {
+    addLabels(slot);
+  }
+
+  return model;
+}
+
+vector<string>& ModelContext::labels() {
+  ThreadSlot& slot = threadSlot();
+  if(!slot.labeled) {
+    addLabels(slot);
+  }
+
+  return slot.model->label;
+}
+
+ModelContext::ThreadSlot& ModelContext::threadSlot() {
+  // thread numbers restart at 0 in every nested team, so slots are only
+  // unique to a thread in the outermost parallel region
+  if(omp_get_level() > 1) {
+    error("Internal error: ModelContext used in a nested parallel region");
+  }
+  uint threadIndex = omp_get_thread_num();
+  if(threadIndex >= slots.size()) {
+    error("Internal error: ModelContext used by more threads than sized for");
+  }
+  ThreadSlot& slot = slots[threadIndex];
+  if(!slot.model) {
+    if(useLogistic) {
+      slot.model = new LogisticModel(PP);
+    } else {
+      slot.model = new LinearModel(PP);
+    }
+  }
+
+  return slot;
+}
+
+void ModelContext::addTerm(Model* model, uint varIndex) {
+  if(varIndex >= PP->nl_all) {
+    model->addNumeric(varIndex - PP->nl_all);
+  } else {
+    model->addAdditiveSNP(varIndex);
+  }
+}
+
+void ModelContext::addLabels(ThreadSlot& slot) {
+  vector<string>& label = slot.model->label;
+  label.resize(1); // intercept
+  label.push_back(attributeName(slot.varA));
+  if(slot.varB >= 0) {
+    label.push_back(attributeName(slot.varB));
+    if(covariateOrder == MODEL_CONTEXT_COVARS_LAST) {
+      label.push_back("EPI");
+    }
+  }
+  if(par::covar_file) {
+    for(uint i=0; i < par::clist_number; ++i) {
+      label.push_back(PP->clistname[i]);
+    }
+  }
+  if((slot.varB >= 0) && (covariateOrder == MODEL_CONTEXT_COVARS_BEFORE_EPI)) {
+    label.push_back("EPI");
+  }
+  slot.labeled = true;
+}
+
+string ModelContext::attributeName(uint varIndex) {
+  if(varIndex >= PP->nl_all) {
+    return PP->nlistname[varIndex - PP->nl_all];
+  }
+
+  return PP->locus[varIndex]->name;
+}
@@ -0,0 +1,60 @@
+/*==============================================================================
+ *
+ * Filename:  ModelContext.h
+ *
+ * Description:  Reusable per-thread regression models for the pairwise
+ * reGAIN and iQTL loops. Each OpenMP thread owns one linear (or logistic for
+ * binary traits) model that is reset to the next attribute pair instead of
+ * allocating a new Model, its design matrix and its labels for every test.
+ * The model storage is sized by the first fit and then reused; term labels
+ * are only created when results are written.
+ * =============================================================================
+ */
+
+#ifndef __MODEL_CONTEXT_H__
+#define __MODEL_CONTEXT_H__
+
+#include <vector>
+#include <string>
+
+#include "plink.h"
+#include "model.h"
+
+// placement of the covariate terms in interaction models
+typedef enum {
+  // A, B, A x B, covariates (reGAIN)
+  MODEL_CONTEXT_COVARS_LAST,
+  // A, B, covariates, A x B (iQTL)
+  MODEL_CONTEXT_COVARS_BEFORE_EPI
+} ModelContextCovariateOrder;
+
+class ModelContext {
+public:
+  // logistic models for binary traits unless forceLinear is set
+  ModelContext(ModelContextCovariateOrder covarOrder=MODEL_CONTEXT_COVARS_LAST,
+               bool forceLinear=false);
+  ~ModelContext();
+  // reset this thread's model to the main effect model of attribute A;
+  // attribute indices past the SNPs are numeric attributes
+  Model* reset(uint newVarA);
+  // reset this thread's model to the interaction model of attributes A, B
+  Model* reset(uint newVarA, uint newVarB);
+  // term labels of this thread's current model, created on first request
+  std::vector<std::string>& labels();
+private:
+  struct ThreadSlot {
+    Model* model;
+    int varA;
+    int varB;
+    bool labeled;
+  };
+  ThreadSlot& threadSlot();
+  void addTerm(Model* model, uint varIndex);
+  void addLabels(ThreadSlot& slot);
+  std::string attributeName(uint varIndex);
+  ModelContextCovariateOrder covariateOrder;
+  bool useLogistic;
+  std::vector<ThreadSlot> slots;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/* =============================================================================
+ * Filename: PvalueHistogram.cpp
+ *
+ * Description:  Log-scale p-value histogram for streaming FDR calculations.
+ * =============================================================================
+ */
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+
+#include "PvalueHistogram.h"
+
+using namespace std;
+
+PvalueHistogram::PvalueHistogram(unsigned int paramBinsPerDecade,
+                                 unsigned int paramNumDecades) {
+  binsPerDecade = paramBinsPerDecade? paramBinsPerDecade: 1;
+  numDecades = paramNumDecades? paramNumDecades: 1;
+  // bin 0 is the underflow bin
+  counts.resize(binsPerDecade * numDecades + 1, 0);
+  numTests = 0;
+}
+
+PvalueHistogram::~PvalueHistogram() {
+}
+
+void PvalueHistogram::add(double pvalue) {
+  ++counts[binIndex(pvalue)];
+  ++numTests;
+}
+
+bool PvalueHistogram::merge(const PvalueHistogram& other) {
+  if((other.binsPerDecade != binsPerDecade) ||
+     (other.numDecades != numDecades)) {
+    return false;
+  }
+  for(unsigned int i=0; i < counts.size(); ++i) {
+    counts[i] += other.counts[i];
+  }
+  numTests += other.numTests;
+
+  return true;
+}
+
+void PvalueHistogram::clear() {
+  fill(counts.begin(), counts.end(), 0);
+  numTests = 0;
+}
+
+double PvalueHistogram::getBHThreshold(double fdr) const {
+  if(!numTests) {
+    return 0;
+  }
+  // largest bin edge t such that t <= (number of p-values <= t) * fdr / m
+  double threshold = 0;
+  uint64_t cumulative = 0;
+  for(unsigned int i=0; i < counts.size(); ++i) {
+    cumulative += counts[i];
+    if(!cumulative) {
+      continue;
+    }
+    double edge = binUpperEdge(i);
+    if(edge <= ((double) cumulative * fdr / (double) numTests)) {
+      threshold = edge;
+    }
+  }
+
+  return threshold;
+}
+
+bool PvalueHistogram::save(string histogramFilename) const {
+  ofstream histogramFile(histogramFilename.c_str());
+  if(histogramFile.fail()) {
+    return false;
+  }
+  histogramFile << "PVALUE_HISTOGRAM\t" << binsPerDecade << "\t" 
+    << numDecades << "\t" << numTests << endl;
+  for(unsigned int i=0; i < counts.size(); ++i) {
+    histogramFile << counts[i] << "\n";
+  }
+  histogramFile.close();
+
+  return !histogramFile.fail();
+}
+
+bool PvalueHistogram::load(string histogramFilename) {
+  ifstream histogramFile(histogramFilename.c_str());
+  if(histogramFile.fail()) {
+    return false;
+  }
+  string tag;
+  unsigned int fileBinsPerDecade = 0;
+  unsigned int fileNumDecades = 0;
+  uint64_t fileNumTests = 0;
+  histogramFile >> tag >> fileBinsPerDecade >> fileNumDecades >> fileNumTests;
+  if(histogramFile.fail() || (tag != "PVALUE_HISTOGRAM") || 
+     !fileBinsPerDecade || !fileNumDecades) {
+    return false;
+  }
+  vector<uint64_t> fileCounts(fileBinsPerDecade * fileNumDecades + 1, 0);
+  uint64_t countSum = 0;
+  for(unsigned int i=0; i < fileCounts.size(); ++i) {
+    histogramFile >> fileCounts[i];
+    if(histogramFile.fail()) {
+      return false;
+    }
+    countSum += fileCounts[i];
+  }
+  if(countSum != fileNumTests) {
+    return false;
+  }
+  binsPerDecade = fileBinsPerDecade;
+  numDecades = fileNumDecades;
+  counts.swap(fileCounts);
+  numTests = fileNumTests;
+
+  return true;
+}
+
+unsigned int PvalueHistogram::binIndex(double pvalue) const {
+  unsigned int lastBin = counts.size() - 1;
+  // failed tests report NaN; count them as non-significant
+  if(std::isnan(pvalue) || (pvalue >= 1.0)) {
+    return lastBin;
+  }
+  double logP = log10(pvalue);
+  if((pvalue <= 0) || (logP <= -((double) numDecades))) {
+    return 0;
+  }
+  double binPos = ceil((logP + numDecades) * binsPerDecade);
+  if(binPos < 1) {
+    return 1;
+  }
+  if(binPos > lastBin) {
+    return lastBin;
+  }
+
+  return (unsigned int) binPos;
+}
+
+double PvalueHistogram::binUpperEdge(unsigned int binIdx) const {
+  return pow(10.0, -((double) numDecades) +
+                   ((double) binIdx / (double) binsPerDecade));
+}
@@ -0,0 +1,51 @@
+/*==============================================================================
+ *
+ * Filename:  PvalueHistogram.h
+ *
+ * Description:  Log-scale p-value histogram. Counts p-values from a stream of
+ * tests so Benjamini-Hochberg FDR thresholds can be computed without holding
+ * every p-value in memory. Histograms built from separate threads or runs
+ * over the same bins can be merged.
+ * =============================================================================
+ */
+
+#ifndef __PVALUE_HISTOGRAM_H__
+#define __PVALUE_HISTOGRAM_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class PvalueHistogram {
+public:
+  // bins are evenly spaced in log10(p) from 10^-numDecades to 1; p-values
+  // smaller than 10^-numDecades fall into a single underflow bin
+  PvalueHistogram(unsigned int paramBinsPerDecade = 100,
+                  unsigned int paramNumDecades = 20);
+  ~PvalueHistogram();
+  // count one p-value
+  void add(double pvalue);
+  // add the counts of another histogram with the same binning
+  bool merge(const PvalueHistogram& other);
+  void clear();
+  uint64_t getNumTests() const { return numTests; }
+  // Benjamini-Hochberg rejection threshold for the given FDR: all p-values
+  // <= the returned value are rejected; returns 0 if nothing is rejected.
+  // Bin upper edges are used as p-value bounds, so the threshold is
+  // conservative by at most one bin width.
+  double getBHThreshold(double fdr) const;
+  // text file of the binning and counts, so histograms of separate runs or
+  // shards can be merged for a global FDR threshold
+  bool save(std::string histogramFilename) const;
+  // replaces the binning and counts with those of a saved histogram
+  bool load(std::string histogramFilename);
+private:
+  unsigned int binIndex(double pvalue) const;
+  double binUpperEdge(unsigned int binIdx) const;
+  unsigned int binsPerDecade;
+  unsigned int numDecades;
+  std::vector<uint64_t> counts;
+  uint64_t numTests;
+};
+
+#endif
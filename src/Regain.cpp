@@ -483,92 +483,18 @@ bool Regain::checkValue(string coefLabel, double checkVal, double checkPval,
 }
 
 Model* Regain::createUnivariateModel(uint varIndex, bool varIsNumeric) {
-  currentModel = 0;
-  // logistic regression for binary phenotypes (traits), linear otherwise
-  if(par::bt) {
-    LogisticModel* m = new LogisticModel(PP);
-    currentModel = m;
-  } else {
-    LinearModel* m = new LinearModel(PP);
-    currentModel = m;
-  }
-  // Set missing data
-  currentModel->setMissing();
-  // label for regression model
-  string coefLabel = "";
-  if(varIsNumeric) {
-    coefLabel = PP->nlistname[varIndex - PP->nl_all];
-  } else {
-    coefLabel = PP->locus[varIndex]->name;
-  }
-  // Main effect of SNP/numeric attribute
-  if(varIsNumeric) {
-    currentModel->addNumeric(varIndex - PP->nl_all);
-  } else {
-    currentModel->addAdditiveSNP(varIndex);
-  }
-  currentModel->label.push_back(coefLabel);
-  testParameter = 1;
-  currentModel->testParameter = testParameter; // single variable main effect
-  // add covariates if specified
-  if(par::covar_file) {
-    addCovariates(*currentModel);
-  }
+  // reuse this thread's model; labels are not needed for the output files
+  currentModel = modelContext.reset(varIndex);
+  testParameter = currentModel->testParameter; // single variable main effect
 
   return currentModel;
 }
 
 Model* Regain::createInteractionModel(uint varIndex1, bool var1IsNumeric, 
                                       uint varIndex2, bool var2IsNumeric) {
-  // attempt to fit a model and retrieve the estimated parameters
-  double newVal = 0;
-  double newPval = 1.0;
-  currentModel = 0;
-  // logistic regression for binary phenotypes (traits), linear otherwise
-  if(par::bt) {
-    LogisticModel* m = new LogisticModel(PP);
-    currentModel = m;
-  } else {
-    LinearModel* m = new LinearModel(PP);
-    currentModel = m;
-  }
-  // Set missing data
-  currentModel->setMissing();
-  // labels in regression model
-  string coef1Label = "";
-  if(var1IsNumeric) {
-    coef1Label = PP->nlistname[varIndex1 - PP->nl_all];
-  } else {
-    coef1Label = PP->locus[varIndex1]->name;
-  }
-  string coef2Label = "";
-  if(var2IsNumeric) {
-    coef2Label = PP->nlistname[varIndex2 - PP->nl_all];
-  } else {
-    coef2Label = PP->locus[varIndex2]->name;
-  }
-  // Main effect of SNP/numeric attribute 1
-  if(var1IsNumeric) {
-    currentModel->addNumeric(varIndex1 - PP->nl_all);
-  } else {
-    currentModel->addAdditiveSNP(varIndex1);
-  }
-  currentModel->label.push_back(coef1Label);
-  // Main effect of SNP/numeric attribute 2
-  if(var2IsNumeric) {
-    currentModel->addNumeric(varIndex2 - PP->nl_all);
-  } else {
-    currentModel->addAdditiveSNP(varIndex2);
-  }
-  currentModel->label.push_back(coef2Label);
-  currentModel->addInteraction(1, 2);
-  currentModel->label.push_back("EPI");
-  testParameter = 3;
-  // add covariates if specified
-  if(par::covar_file) {
-    addCovariates(*currentModel);
-    testParameter += par::clist_number;
-  }
+  // reuse this thread's model; labels are not needed for the output files
+  currentModel = modelContext.reset(varIndex1, varIndex2);
+  testParameter = currentModel->testParameter;
 
   return currentModel;
 }
@@ -637,8 +563,6 @@ void Regain::mainEffect(uint varIndex, bool varIsNumeric) {
     }
   }
 
-  // free model memory
-  delete currentModel;
 }
 
 void Regain::addCovariates(Model &m) {
@@ -758,8 +682,6 @@ void Regain::interactionEffect(uint varIndex1, bool var1IsNumeric,
     }
   }
 
-  // free model memory
-  delete currentModel;
 }
 
 void Regain::pureInteractionEffect(uint varIndex1, bool var1IsNumeric,
@@ -20,6 +20,7 @@
 
 #include "zfstream.h"
 #include "model.h"
+#include "ModelContext.h"
 
 #include "Insilico.h"
 
@@ -143,6 +144,8 @@ private:
   matrix_t regainPMatrix;
   Model* currentModel;
   uint testParameter;
+  // reusable per-thread regression models
+  ModelContext modelContext;
 	// collection of all interaction terms as mat_el types
 	vector<matrixElement> gainIntPvals;
   // regression warnings - bcw - 4/30/13
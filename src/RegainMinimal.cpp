@@ -87,9 +87,6 @@ RegainMinimal::RegainMinimal() {
     attributeNames.push_back(coefLabel);
   }
   
-  sizeMatrix(regainMatrix, numAttributes, numAttributes);
-  sizeMatrix(regainPMatrix, numAttributes, numAttributes);
-  
   if(par::regainMatrixTransform == "abs") {
     setOutputTransform(REGAIN_MINIMAL_OUTPUT_TRANSFORM_ABS);
   } else {
@@ -116,6 +113,13 @@ void RegainMinimal::setDefaults() {
   minInteraction = 0;
   maxInteraction = 0;
   saveRuninfoFlag = false;
+  sparseOutput = false;
+  sparseEdgesFilename = "";
+  numEdgesWritten = 0;
+  haveInteractionStats = false;
+  usePrescreen = false;
+  prescreenPvalue = 1.0;
+  numScreenedOut = 0;
 }
 
 void RegainMinimal::setFailureValue(double fValue) {
@@ -165,11 +169,74 @@ bool RegainMinimal::writeRegainMinimalRunInfo(std::string newRunInfoFilename) {
   return true;
 }
 
+bool RegainMinimal::enablePrescreen(double screenPvalue) {
+  PP->printLOG("Building fast epistasis prescreen, screen p-value [ " + 
+               dbl2str(screenPvalue) + " ]\n");
+  if(!prescreen.build()) {
+    PP->printLOG("WARNING: prescreen disabled, all pairs will be fit\n");
+    usePrescreen = false;
+    return false;
+  }
+  usePrescreen = true;
+  prescreenPvalue = screenPvalue;
+  numScreenedOut = 0;
+  
+  return true;
+}
+
+bool RegainMinimal::setSparseOutput(string edgesFilename) {
+  PP->printLOG("Streaming REGAIN interactions to edge list [ " + 
+               edgesFilename + " ]\n");
+  if(!par::do_regain_pvalue_threshold && !useOutputThreshold) {
+    PP->printLOG("WARNING: no p-value or output threshold set, "
+                 "all interactions will be written\n");
+  }
+  sparseEdgesFilename = edgesFilename;
+  sparseEdgesFile.open(sparseEdgesFilename, true);
+  sparseEdgesFile << "VAR1\tVAR2\tVALUE\tPVALUE\n";
+  sparseOutput = true;
+  numEdgesWritten = 0;
+  haveInteractionStats = false;
+  interactionPvalHistogram.clear();
+  
+  return true;
+}
+
+bool RegainMinimal::closeSparseOutput() {
+  if(!sparseOutput) {
+    return false;
+  }
+  sparseEdgesFile.close();
+  PP->printLOG("Wrote [ " + int2str(numEdgesWritten) + " ] of [ " + 
+               dbl2str(interactionPvalHistogram.getNumTests()) + 
+               " ] interactions to [ " + sparseEdgesFilename + " ]\n");
+  if(par::save_pvalue_histogram) {
+    string histogramFilename = par::output_file_name + ".regain.phist";
+    PP->printLOG("Writing p-value histogram [ " + histogramFilename + " ]\n");
+    interactionPvalHistogram.save(histogramFilename);
+  }
+  if(par::regainFdrPrune) {
+    return fdrPruneEdgeFile(sparseEdgesFilename, 
+                            par::output_file_name + ".regain.edges.fdr.gz",
+                            par::regainFdr);
+  }
+  
+  return true;
+}
+
 void RegainMinimal::run() {
   // reset the warnings list
   warnings.clear();
   failures.clear();
   
+  if(sparseOutput) {
+    mainEffectValues.assign(numAttributes, 0);
+    mainEffectPvals.assign(numAttributes, 1.0);
+  } else {
+    sizeMatrix(regainMatrix, numAttributes, numAttributes);
+    sizeMatrix(regainPMatrix, numAttributes, numAttributes);
+  }
+  
   // all main effects
   PP->printLOG("Run all main effects models\n");
   #pragma omp parallel for
@@ -186,9 +253,17 @@ void RegainMinimal::run() {
       varIndex1 = numAttributes - varIndex1 - 1;
       varIndex2 = numAttributes - varIndex2;
     }
+    // main effects are kept separately in sparse mode
+    if(sparseOutput && (varIndex1 == varIndex2)) {
+      continue;
+    }
     interactionEffect(varIndex1, varIndex1 >= PP->nl_all,
                       varIndex2, varIndex2 >= PP->nl_all);
   } // Next pair of SNPs/numeric attributes
+  if(usePrescreen) {
+    PP->printLOG("Prescreen excluded [ " + int2str(numScreenedOut) + 
+                 " ] interaction models\n");
+  }
   
   writeWarnings();
   writeFailures();
@@ -200,95 +275,6 @@ void RegainMinimal::run() {
   }
 }
 
-Model* RegainMinimal::createUnivariateModel(uint varIndex, bool varIsNumeric) {
-  Model* thisModel = 0;
-  // logistic regression for binary phenotypes (traits), linear otherwise
-  if(par::bt) {
-    LogisticModel* m = new LogisticModel(PP);
-    thisModel = m;
-  } else {
-    LinearModel* m = new LinearModel(PP);
-    thisModel = m;
-  }
-  assert(thisModel);
-  // Set missing data
-  thisModel->setMissing();
-  // label for regression model
-  string coefLabel = "";
-  if(varIsNumeric) {
-    coefLabel = PP->nlistname[varIndex - PP->nl_all];
-  } else {
-    coefLabel = PP->locus[varIndex]->name;
-  }
-  // Main effect of SNP/numeric attribute
-  if(varIsNumeric) {
-    thisModel->addNumeric(varIndex - PP->nl_all);
-  } else {
-    thisModel->addAdditiveSNP(varIndex);
-  }
-  thisModel->label.push_back(coefLabel);
-  thisModel->testParameter = 1; // single variable main effect
-  if(par::covar_file) {
-    addCovariates(*thisModel);
-  }
-
-  return thisModel;
-}
-
-Model* RegainMinimal::createInteractionModel(uint varIndex1, bool var1IsNumeric, 
-                                             uint varIndex2, bool var2IsNumeric) {
-  // attempt to fit a model and retrieve the estimated parameters
-  Model* thisModel = 0;
-  // logistic regression for binary phenotypes (traits), linear otherwise
-  if(par::bt) {
-    LogisticModel* m = new LogisticModel(PP);
-    thisModel = m;
-  } else {
-    LinearModel* m = new LinearModel(PP);
-    thisModel = m;
-  }
-  assert(thisModel);
-  // Set missing data
-  thisModel->setMissing();
-  // labels in regression model
-  string coef1Label = "";
-  if(var1IsNumeric) {
-    coef1Label = PP->nlistname[varIndex1 - PP->nl_all];
-  } else {
-    coef1Label = PP->locus[varIndex1]->name;
-  }
-  string coef2Label = "";
-  if(var2IsNumeric) {
-    coef2Label = PP->nlistname[varIndex2 - PP->nl_all];
-  } else {
-    coef2Label = PP->locus[varIndex2]->name;
-  }
-  // Main effect of SNP/numeric attribute 1
-  if(var1IsNumeric) {
-    thisModel->addNumeric(varIndex1 - PP->nl_all);
-  } else {
-    thisModel->addAdditiveSNP(varIndex1);
-  }
-  thisModel->label.push_back(coef1Label);
-  // Main effect of SNP/numeric attribute 2
-  if(var2IsNumeric) {
-    thisModel->addNumeric(varIndex2 - PP->nl_all);
-  } else {
-    thisModel->addAdditiveSNP(varIndex2);
-  }
-  thisModel->label.push_back(coef2Label);
-  thisModel->addInteraction(1, 2);
-  thisModel->label.push_back("EPI");
-  thisModel->testParameter = 3;
-  // add covariates if specified
-  if(par::covar_file) {
-    addCovariates(*thisModel);
-    thisModel->testParameter += par::clist_number;
-  }
-
-  return thisModel;
-}
-
 bool RegainMinimal::fitModelParameters(Model* thisModel, uint thisCoefIdx) {
   assert(thisModel);
   bool success = true;
@@ -324,6 +310,7 @@ bool RegainMinimal::fitModelParameters(Model* thisModel, uint thisCoefIdx) {
         failMsg += "Regression invalid failure type detected: " + int2str(invalidReason);
         break;
     }
+    #pragma omp critical
     failures.push_back(failMsg);
     success = false;
   }
@@ -372,8 +359,8 @@ bool RegainMinimal::checkValue(string coefLabel,
 }
 
 void RegainMinimal::mainEffect(uint varIndex, bool varIsNumeric) {
-  // setup regression model
-  Model *thisModel = createUnivariateModel(varIndex, varIsNumeric);
+  // reset this thread's regression model
+  Model *thisModel = modelContext.reset(varIndex);
   // attempt to fit a model and retrieve the estimated parameters
   double newVal = 0;
   double newPval = 1.0;
@@ -383,9 +370,11 @@ void RegainMinimal::mainEffect(uint varIndex, bool varIsNumeric) {
   vector_t betaMainEffectCoefPvals;
   double mainEffectPval = 1.0;
   vector_t mainEffectModelSE;
+  // fit outside the critical section; the model belongs to this thread
+  bool fitted = fitModelParameters(thisModel, 1);
   #pragma omp critical
   {
-  if(fitModelParameters(thisModel, 1)) {
+  if(fitted) {
     // Obtain estimates and statistics
     betaMainEffectCoefs = thisModel->getCoefs();
     // p-values don't include intercept term
@@ -400,7 +389,8 @@ void RegainMinimal::mainEffect(uint varIndex, bool varIsNumeric) {
     }
     if(saveRuninfoFlag) {
       RunRecord runRecord;
-      copy(thisModel->label.begin(), thisModel->label.end(),
+      vector<string>& modelLabels = modelContext.labels();
+      copy(modelLabels.begin(), modelLabels.end(),
            back_inserter(runRecord.vars));
       copy(betaMainEffectCoefs.begin(), betaMainEffectCoefs.end(),
            back_inserter(runRecord.coefs));
@@ -416,44 +406,36 @@ void RegainMinimal::mainEffect(uint varIndex, bool varIsNumeric) {
       newVal = fabs(newVal);
     }
   }
-  regainMatrix[varIndex][varIndex] = newVal;
-  regainPMatrix[varIndex][varIndex] = newPval;
   if(par::do_regain_pvalue_threshold) {
     if(newPval > par::regainPvalueThreshold) {
-      regainMatrix[varIndex][varIndex] = 0;
-      regainPMatrix[varIndex][varIndex] = 1;
+      newVal = 0;
+      newPval = 1;
     }
   }
+  if(sparseOutput) {
+    mainEffectValues[varIndex] = newVal;
+    mainEffectPvals[varIndex] = newPval;
+  } else {
+    regainMatrix[varIndex][varIndex] = newVal;
+    regainPMatrix[varIndex][varIndex] = newPval;
   }
-  // free model memory
-  delete thisModel;
-}
-
-void RegainMinimal::addCovariates(Model &m) {
-  for(uint i = 0; i < par::clist_number; i++) {
-    // add covariate to the model
-    m.addCovariate(i);
-    m.label.push_back(PP->clistname[i]);
   }
 }
 
 void RegainMinimal::interactionEffect(uint varIndex1, bool var1IsNumeric,
                                       uint varIndex2, bool var2IsNumeric) {
-  // labels in regression model
-  string coef1Label = "";
-  if(var1IsNumeric) {
-    coef1Label = PP->nlistname[varIndex1 - PP->nl_all];
-  } else {
-    coef1Label = PP->locus[varIndex1]->name;
-  }
-  string coef2Label = "";
-  if(var2IsNumeric) {
-    coef2Label = PP->nlistname[varIndex2 - PP->nl_all];
-  } else {
-    coef2Label = PP->locus[varIndex2]->name;
+  // skip the regression fit for pairs failing the fast prescreen
+  if(usePrescreen && (varIndex1 != varIndex2) &&
+     !prescreen.passes(varIndex1, varIndex2, prescreenPvalue)) {
+    #pragma omp critical
+    {
+      ++numScreenedOut;
+      storeInteraction(varIndex1, varIndex2, failureValue, 1.0);
+    }
+    return;
   }
-  Model *thisModel = createInteractionModel(varIndex1, var1IsNumeric,
-                                            varIndex2, var2IsNumeric);
+  // reset this thread's regression model
+  Model *thisModel = modelContext.reset(varIndex1, varIndex2);
   assert(thisModel);
   // fit the model and get the estimated parameters
   vector_t betaCoefs;
@@ -465,9 +447,11 @@ void RegainMinimal::interactionEffect(uint varIndex1, bool var1IsNumeric,
   vector_t::const_iterator sIt;
   double newVal = 0;
   double newPval = 1.0;
+  // fit outside the critical section; the model belongs to this thread
+  bool fitted = fitModelParameters(thisModel, 3);
   #pragma omp critical
   {
-  if(fitModelParameters(thisModel, 3)) {
+  if(fitted) {
     // model converged, so get the estimated parameters and statistics
     betaCoefs = thisModel->getCoefs();
     interactionVal = betaCoefs[betaCoefs.size() - 1];
@@ -484,7 +468,8 @@ void RegainMinimal::interactionEffect(uint varIndex1, bool var1IsNumeric,
     }
     if(saveRuninfoFlag) {
       RunRecord runRecord;
-      copy(thisModel->label.begin(), thisModel->label.end(),
+      vector<string>& modelLabels = modelContext.labels();
+      copy(modelLabels.begin(), modelLabels.end(),
            back_inserter(runRecord.vars));
       copy(betaCoefs.begin(), betaCoefs.end(),
            back_inserter(runRecord.coefs));
@@ -501,23 +486,372 @@ void RegainMinimal::interactionEffect(uint varIndex1, bool var1IsNumeric,
   if(outputTransform == REGAIN_MINIMAL_OUTPUT_TRANSFORM_ABS) {
     newVal = fabs(newVal);
   }
-  regainMatrix[varIndex1][varIndex2] = newVal;
-  regainMatrix[varIndex2][varIndex1] = newVal;
-  if(par::do_regain_pvalue_threshold) {
-    if(newPval > par::regainPvalueThreshold) {
-      regainMatrix[varIndex1][varIndex2] = 0;
-      regainMatrix[varIndex2][varIndex1] = 0;
+  storeInteraction(varIndex1, varIndex2, newVal, newPval);
+  }
+}
+
+void RegainMinimal::storeInteraction(uint varIndex1, uint varIndex2, 
+                                     double value, double pvalue) {
+  if(sparseOutput) {
+    writeSparseEdge(varIndex1, varIndex2, value, pvalue);
+  } else {
+    regainMatrix[varIndex1][varIndex2] = value;
+    regainMatrix[varIndex2][varIndex1] = value;
+    if(par::do_regain_pvalue_threshold) {
+      if(pvalue > par::regainPvalueThreshold) {
+        regainMatrix[varIndex1][varIndex2] = 0;
+        regainMatrix[varIndex2][varIndex1] = 0;
+      }
+    }
+    regainPMatrix[varIndex1][varIndex2] = pvalue;
+    regainPMatrix[varIndex2][varIndex1] = pvalue;
+  }
+}
+
+void RegainMinimal::writeSparseEdge(uint varIndex1, uint varIndex2, 
+                                    double value, double pvalue) {
+  // statistics and FDR counts cover all tests, not just the edges written
+  interactionPvalHistogram.add(pvalue);
+  if(!haveInteractionStats) {
+    minInteraction = maxInteraction = value;
+    haveInteractionStats = true;
+  } else {
+    if(value < minInteraction) {
+      minInteraction = value;
+    }
+    if(value > maxInteraction) {
+      maxInteraction = value;
+    }
+  }
+  if(par::do_regain_pvalue_threshold && (pvalue > par::regainPvalueThreshold)) {
+    return;
+  }
+  if(useOutputThreshold && (fabs(value) <= outputThreshold)) {
+    return;
+  }
+  stringstream ss;
+  ss << attributeNames[varIndex1] << "\t" << attributeNames[varIndex2] << "\t"
+    << value << "\t" << pvalue << "\n";
+  sparseEdgesFile << ss.str();
+  ++numEdgesWritten;
+}
+
+bool RegainMinimal::runBlocks(uint blockIndex, uint numBlocks, uint tileSize, 
+                              bool resume) {
+  if(!numBlocks || !blockIndex || (blockIndex > numBlocks)) {
+    error("reGAIN block must be i/N with 1 <= i <= N, got " + 
+          int2str(blockIndex) + "/" + int2str(numBlocks));
+  }
+  if(!tileSize) {
+    error("reGAIN tile size must be greater than zero");
+  }
+  warnings.clear();
+  failures.clear();
+  
+  uint numTileRows = (numAttributes + tileSize - 1) / tileSize;
+  uint numTiles = numTileRows * (numTileRows + 1) / 2;
+  string checkpointFilename = par::output_file_name + ".regain.block." +
+    int2str(blockIndex) + "of" + int2str(numBlocks) + ".chk";
+  PP->printLOG("Running reGAIN block [ " + int2str(blockIndex) + " / " + 
+               int2str(numBlocks) + " ] of [ " + int2str(numTiles) + 
+               " ] tiles of size [ " + int2str(tileSize) + " ]\n");
+  set<string> completedUnits;
+  if(resume) {
+    readBlockCheckpoint(checkpointFilename, completedUnits);
+    PP->printLOG("Resuming from checkpoint [ " + checkpointFilename + 
+                 " ] with [ " + int2str(completedUnits.size()) + 
+                 " ] completed units\n");
+  } else {
+    // start a fresh checkpoint
+    ofstream checkpointFile(checkpointFilename);
+    checkpointFile.close();
+  }
+
+  // tiles are always written as edge lists, main effects as a vector
+  sparseOutput = true;
+  numEdgesWritten = 0;
+  haveInteractionStats = false;
+  interactionPvalHistogram.clear();
+  mainEffectValues.assign(numAttributes, 0);
+  mainEffectPvals.assign(numAttributes, 1.0);
+
+  // the first block owns the main effects
+  if((blockIndex == 1) && !completedUnits.count("main")) {
+    PP->printLOG("Run all main effects models\n");
+    #pragma omp parallel for
+    for(uint k=0; k < numAttributes; k++) {
+      mainEffect(k, k >= (uint) PP->nl_all);
+    }
+    writeRegainMinimalMainEffectsToFile(par::output_file_name + 
+                                        ".regain.main.tab");
+    writeBlockCheckpoint(checkpointFilename, "main");
+  }
+  
+  uint tileIdx = 0;
+  uint numTilesRun = 0;
+  for(uint tileRow=0; tileRow < numTileRows; ++tileRow) {
+    for(uint tileCol=tileRow; tileCol < numTileRows; ++tileCol, ++tileIdx) {
+      if((tileIdx % numBlocks) != (blockIndex - 1)) {
+        continue;
+      }
+      string tileUnit = "tile." + int2str(tileIdx);
+      if(completedUnits.count(tileUnit)) {
+        continue;
+      }
+      runTile(tileRow, tileCol, tileSize);
+      writeBlockCheckpoint(checkpointFilename, tileUnit);
+      ++numTilesRun;
+      if(par::verbose) {
+        PP->printLOG(Timestamp() + "Completed tile [ " + int2str(tileIdx) + 
+                     " ] of [ " + int2str(numTiles) + " ]\n");
+      }
     }
   }
-  regainPMatrix[varIndex1][varIndex2] = newPval;
-  regainPMatrix[varIndex2][varIndex1] = newPval;
+  PP->printLOG("Ran [ " + int2str(numTilesRun) + " ] tiles, wrote [ " + 
+               int2str(numEdgesWritten) + " ] edges\n");
+  if(usePrescreen) {
+    PP->printLOG("Prescreen excluded [ " + int2str(numScreenedOut) + 
+                 " ] interaction models\n");
   }
   
-  // free model memory
-  delete thisModel;
+  writeWarnings();
+  writeFailures();
+  if(nanCount) {
+    PP->printLOG("Detected [ " + int2str(nanCount) + " ] NaN's\n");
+  }
+  if(infCount) {
+    PP->printLOG("Detected [ " + int2str(infCount) + " ] Inf's\n");
+  }
+
+  return true;
+}
+
+void RegainMinimal::runTile(uint tileRow, uint tileCol, uint tileSize) {
+  uint rowStart = tileRow * tileSize;
+  uint rowEnd = min(rowStart + tileSize, numAttributes);
+  uint colStart = tileCol * tileSize;
+  uint colEnd = min(colStart + tileSize, numAttributes);
+  vector<pair<uint, uint> > tilePairs;
+  for(uint i=rowStart; i < rowEnd; ++i) {
+    for(uint j=max(colStart, i + 1); j < colEnd; ++j) {
+      tilePairs.push_back(make_pair(i, j));
+    }
+  }
+  // overwrites any partial output from an interrupted run
+  sparseEdgesFilename = tileFilename(tileRow, tileCol);
+  sparseEdgesFile.open(sparseEdgesFilename, true);
+  sparseEdgesFile << "VAR1\tVAR2\tVALUE\tPVALUE\n";
+  interactionPvalHistogram.clear();
+  #pragma omp parallel for schedule(dynamic)
+  for(size_t k=0; k < tilePairs.size(); k++) {
+    uint varIndex1 = tilePairs[k].first;
+    uint varIndex2 = tilePairs[k].second;
+    interactionEffect(varIndex1, varIndex1 >= (uint) PP->nl_all,
+                      varIndex2, varIndex2 >= (uint) PP->nl_all);
+  }
+  sparseEdgesFile.close();
+  if(par::save_pvalue_histogram) {
+    interactionPvalHistogram.save(tileHistogramFilename(tileRow, tileCol));
+  }
+}
+
+string RegainMinimal::tileFilename(uint tileRow, uint tileCol) {
+  return par::output_file_name + ".regain.tile." + int2str(tileRow) + "." + 
+    int2str(tileCol) + ".gz";
+}
+
+string RegainMinimal::tileHistogramFilename(uint tileRow, uint tileCol) {
+  return par::output_file_name + ".regain.tile." + int2str(tileRow) + "." + 
+    int2str(tileCol) + ".phist";
+}
+
+bool RegainMinimal::writeBlockCheckpoint(string checkpointFilename, 
+                                         string unit) {
+  ofstream checkpointFile(checkpointFilename, ios::app);
+  if(checkpointFile.fail()) {
+    return false;
+  }
+  checkpointFile << unit << endl;
+  checkpointFile.close();
+  
+  return true;
+}
+
+bool RegainMinimal::readBlockCheckpoint(string checkpointFilename, 
+                                        set<string>& completedUnits) {
+  completedUnits.clear();
+  ifstream checkpointFile(checkpointFilename);
+  if(checkpointFile.fail()) {
+    PP->printLOG("WARNING: no checkpoint file [ " + checkpointFilename + 
+                 " ], starting from the beginning\n");
+    return false;
+  }
+  string unit;
+  while(checkpointFile >> unit) {
+    completedUnits.insert(unit);
+  }
+  checkpointFile.close();
+  
+  return true;
+}
+
+bool RegainMinimal::mergeBlocks(uint tileSize) {
+  if(!tileSize) {
+    error("reGAIN tile size must be greater than zero");
+  }
+  uint numTileRows = (numAttributes + tileSize - 1) / tileSize;
+  PP->printLOG("Merging reGAIN tiles of size [ " + int2str(tileSize) + " ]\n");
+  // all tiles and the main effects must be present
+  string mainEffectsFilename = par::output_file_name + ".regain.main.tab";
+  vector<string> missingFiles;
+  if(!doesFileExist(mainEffectsFilename)) {
+    missingFiles.push_back(mainEffectsFilename);
+  }
+  for(uint tileRow=0; tileRow < numTileRows; ++tileRow) {
+    for(uint tileCol=tileRow; tileCol < numTileRows; ++tileCol) {
+      if(!doesFileExist(tileFilename(tileRow, tileCol))) {
+        missingFiles.push_back(tileFilename(tileRow, tileCol));
+      }
+      if(par::save_pvalue_histogram && 
+         !doesFileExist(tileHistogramFilename(tileRow, tileCol))) {
+        missingFiles.push_back(tileHistogramFilename(tileRow, tileCol));
+      }
+    }
+  }
+  if(missingFiles.size()) {
+    for(uint i=0; i < missingFiles.size(); ++i) {
+      PP->printLOG("Missing reGAIN block output [ " + missingFiles[i] + " ]\n");
+    }
+    return false;
+  }
+  
+  map<string, uint> attributeIndex;
+  for(uint i=0; i < numAttributes; ++i) {
+    attributeIndex[attributeNames[i]] = i;
+  }
+  
+  if(par::do_regain_sparse) {
+    sparseOutput = true;
+    sparseEdgesFilename = par::output_file_name + ".regain.edges.gz";
+    PP->printLOG("Writing merged edge list [ " + sparseEdgesFilename + " ]\n");
+    sparseEdgesFile.open(sparseEdgesFilename, true);
+    sparseEdgesFile << "VAR1\tVAR2\tVALUE\tPVALUE\n";
+  } else {
+    sparseOutput = false;
+    sizeMatrix(regainMatrix, numAttributes, numAttributes);
+    sizeMatrix(regainPMatrix, numAttributes, numAttributes);
+    for(uint i=0; i < numAttributes; ++i) {
+      for(uint j=0; j < numAttributes; ++j) {
+        regainPMatrix[i][j] = 1.0;
+      }
+    }
+  }
+  
+  // main effects
+  mainEffectValues.assign(numAttributes, 0);
+  mainEffectPvals.assign(numAttributes, 1.0);
+  ifstream mainEffectsFile(mainEffectsFilename);
+  string line;
+  getline(mainEffectsFile, line);
+  double value = 0;
+  double pvalue = 1.0;
+  while(getline(mainEffectsFile, line)) {
+    vector<string> tok = tokenizeLine(line);
+    if(tok.size() != 3) {
+      continue;
+    }
+    if(!attributeIndex.count(tok[0]) || 
+       !from_string<double>(value, tok[1], std::dec) ||
+       !from_string<double>(pvalue, tok[2], std::dec)) {
+      PP->printLOG("Error parsing main effects line: " + line + "\n");
+      return false;
+    }
+    uint varIndex = attributeIndex[tok[0]];
+    mainEffectValues[varIndex] = value;
+    mainEffectPvals[varIndex] = pvalue;
+    if(!sparseOutput) {
+      regainMatrix[varIndex][varIndex] = value;
+      regainPMatrix[varIndex][varIndex] = pvalue;
+    }
+  }
+  mainEffectsFile.close();
+  
+  // interactions
+  numEdgesWritten = 0;
+  for(uint tileRow=0; tileRow < numTileRows; ++tileRow) {
+    for(uint tileCol=tileRow; tileCol < numTileRows; ++tileCol) {
+      string thisTileFilename = tileFilename(tileRow, tileCol);
+      ZInput zin(thisTileFilename, compressed(thisTileFilename));
+      // skip header
+      vector<string> tok = zin.tokenizeLine();
+      while(!zin.endOfFile()) {
+        tok = zin.tokenizeLine();
+        if(tok.size() != 4) {
+          continue;
+        }
+        if(sparseOutput) {
+          sparseEdgesFile << tok[0] + "\t" + tok[1] + "\t" + tok[2] + "\t" + 
+            tok[3] + "\n";
+        } else {
+          if(!attributeIndex.count(tok[0]) || !attributeIndex.count(tok[1]) ||
+             !from_string<double>(value, tok[2], std::dec) ||
+             !from_string<double>(pvalue, tok[3], std::dec)) {
+            PP->printLOG("Error parsing edge in [ " + thisTileFilename + " ]\n");
+            zin.close();
+            return false;
+          }
+          uint varIndex1 = attributeIndex[tok[0]];
+          uint varIndex2 = attributeIndex[tok[1]];
+          regainMatrix[varIndex1][varIndex2] = value;
+          regainMatrix[varIndex2][varIndex1] = value;
+          regainPMatrix[varIndex1][varIndex2] = pvalue;
+          regainPMatrix[varIndex2][varIndex1] = pvalue;
+        }
+        ++numEdgesWritten;
+      }
+      zin.close();
+    }
+  }
+  if(sparseOutput) {
+    sparseEdgesFile.close();
+  }
+  PP->printLOG("Merged [ " + int2str(numEdgesWritten) + " ] edges\n");
+  if(par::save_pvalue_histogram) {
+    // tile histograms cover every test, including edges not written
+    interactionPvalHistogram.clear();
+    for(uint tileRow=0; tileRow < numTileRows; ++tileRow) {
+      for(uint tileCol=tileRow; tileCol < numTileRows; ++tileCol) {
+        PvalueHistogram tileHistogram;
+        if(!tileHistogram.load(tileHistogramFilename(tileRow, tileCol)) ||
+           !interactionPvalHistogram.merge(tileHistogram)) {
+          PP->printLOG("Error reading p-value histogram [ " + 
+                       tileHistogramFilename(tileRow, tileCol) + " ]\n");
+          return false;
+        }
+      }
+    }
+    string histogramFilename = par::output_file_name + ".regain.phist";
+    PP->printLOG("Writing p-value histogram of [ " + 
+                 dbl2str(interactionPvalHistogram.getNumTests()) + 
+                 " ] tests [ " + histogramFilename + " ]\n");
+    interactionPvalHistogram.save(histogramFilename);
+  }
+  
+  return true;
 }
 
 bool RegainMinimal::updateStats() {
+  if(sparseOutput) {
+    // interaction stats are accumulated as edges are streamed
+    if(!numAttributes) {
+      return false;
+    }
+    minMainEffect = *min_element(mainEffectValues.begin(), 
+                                 mainEffectValues.end());
+    maxMainEffect = *max_element(mainEffectValues.begin(), 
+                                 mainEffectValues.end());
+    return true;
+  }
   minMainEffect = maxMainEffect = regainMatrix[0][0];
   minInteraction = maxInteraction = regainMatrix[0][1];
   for(uint i = 0; i < numAttributes; ++i) {
@@ -622,6 +956,70 @@ void RegainMinimal::printFittedModel(Model* thisModel) {
 //  display(betaCoefsSEs);
 }
 
+bool RegainMinimal::writeRegainMinimalMainEffectsToFile(string newMainEffectsFilename) {
+  PP->printLOG("Writing REGAIN main effects [ " + newMainEffectsFilename + " ]\n");
+  ofstream outFile(newMainEffectsFilename);
+  if(outFile.fail()) {
+    return false;
+  }
+  outFile << "VAR\tVALUE\tPVALUE" << endl;
+  for(uint i = 0; i < numAttributes; ++i) {
+    if(sparseOutput) {
+      outFile << attributeNames[i] << "\t" << mainEffectValues[i] << "\t" 
+        << mainEffectPvals[i] << endl;
+    } else {
+      outFile << attributeNames[i] << "\t" << regainMatrix[i][i] << "\t" 
+        << regainPMatrix[i][i] << endl;
+    }
+  }
+  outFile.close();
+
+  return true;
+}
+
+bool RegainMinimal::fdrPruneEdgeFile(string edgesFilename, 
+                                     string prunedFilename, double fdr) {
+  PP->printLOG("Calculating Benjamini Hochberg FDR from p-value histogram\n");
+  double T = interactionPvalHistogram.getBHThreshold(fdr);
+  if(T == 0) {
+    PP->printLOG("No p-value meets BH threshold criteria, so nothing written\n");
+    return true;
+  }
+  PP->printLOG("BH rejection threshold: T = " + dbl2str(T) + " for FDR " + 
+               dbl2str(fdr) + " over [ " + 
+               dbl2str(interactionPvalHistogram.getNumTests()) + " ] tests\n");
+  PP->printLOG("Writing FDR pruned edge list [ " + prunedFilename + " ]\n");
+  checkFileExists(edgesFilename);
+  ZInput zin(edgesFilename, compressed(edgesFilename));
+  ZOutput zout(prunedFilename, true);
+  // copy header line
+  vector<string> tok = zin.tokenizeLine();
+  zout << "VAR1\tVAR2\tVALUE\tPVALUE\n";
+  uint numKept = 0;
+  double pvalue = 1.0;
+  while(!zin.endOfFile()) {
+    tok = zin.tokenizeLine();
+    if(tok.size() != 4) {
+      continue;
+    }
+    if(!from_string<double>(pvalue, tok[3], std::dec)) {
+      PP->printLOG("Error parsing p-value token:" + tok[3] + "\n");
+      zin.close();
+      zout.close();
+      return false;
+    }
+    if(pvalue <= T) {
+      zout << tok[0] + "\t" + tok[1] + "\t" + tok[2] + "\t" + tok[3] + "\n";
+      ++numKept;
+    }
+  }
+  zin.close();
+  zout.close();
+  PP->printLOG("Kept [ " + int2str(numKept) + " ] edges after FDR pruning\n");
+
+  return true;
+}
+
 bool RegainMinimal::readRegainMinimalFromFile(string regainFilename) {
   checkFileExists(regainFilename);
   ifstream REGAIN_MINIMAL(regainFilename, ios::in);
@@ -15,9 +15,13 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <set>
 
 #include "zfstream.h"
 #include "model.h"
+#include "PvalueHistogram.h"
+#include "EpistasisScreen.h"
+#include "ModelContext.h"
 
 #include "Insilico.h"
 
@@ -73,22 +77,53 @@ public:
   bool writeRegainMinimalToSifFile(std::string newSifFilename);
   bool saveRunInfo(bool paramSaveRunInfo);
   bool writeRegainMinimalRunInfo(std::string newRunInfoFilename);
+  // sparse output mode: stream interaction edges passing the p-value and/or
+  // output thresholds to a compressed edge list instead of dense matrices;
+  // must be called before run()
+  bool setSparseOutput(std::string edgesFilename);
+  // close the edge list and apply Benjamini-Hochberg FDR pruning if requested
+  bool closeSparseOutput();
+  // write main effects (diagonal) as name, value, p-value
+  bool writeRegainMinimalMainEffectsToFile(std::string newMainEffectsFilename);
+  // copy edges with p-values <= the BH threshold for fdr to a new edge list
+  bool fdrPruneEdgeFile(std::string edgesFilename, 
+                        std::string prunedFilename, double fdr);
+  // blocked execution: the upper triangle of the interaction matrix is cut
+  // into tileSize x tileSize tiles, numbered row-major; this process runs 
+  // tiles where (tile number % numBlocks) == (blockIndex - 1), writing each 
+  // tile to its own edge list and checkpointing after each tile
+  bool runBlocks(uint blockIndex, uint numBlocks, uint tileSize, bool resume);
+  // assemble tile edge lists from all blocks into a single edge list 
+  // (sparse output mode) or into the dense reGAIN and p-value matrices
+  bool mergeBlocks(uint tileSize);
+  // two-stage mode: only pairs with a fast screen p-value <= screenPvalue 
+  // are fit with the full regression model; the rest get the failure value
+  bool enablePrescreen(double screenPvalue);
 private:
-  Model* createUnivariateModel(uint varIndex, bool varIsNumeric);
-  Model* createInteractionModel(uint varIndex1, bool var1IsNumeric,
-                                uint varIndex2, bool var2IsNumeric);
   bool fitModelParameters(Model* thisModel, uint thisCoefIdx);
   bool checkValue(std::string coefLabel, double checkVal, double checkPval,
                   double& returnVal, double& returnPVal);
 	// calculate main effect regression coefficients for diagonal terms	
 	void mainEffect(uint varIndex, bool varIsNumeric);
-	// add covariate terms to model, handling multiple covariates
-	void addCovariates(Model &m);
 	// calculate epistatic interaction between two SNPs or numeric attributes,
 	// or a SNP and a numeric attribute
 	void interactionEffect(uint varIndex1, bool var1IsNumeric, 
                          uint varIndex2, bool var2IsNumeric);
   bool updateStats();
+  // store interaction value and p-value - call from critical section
+  void storeInteraction(uint varIndex1, uint varIndex2, 
+                        double value, double pvalue);
+  // record one interaction in the sparse edge list - call from critical section
+  void writeSparseEdge(uint varIndex1, uint varIndex2, 
+                       double value, double pvalue);
+  // blocked execution helpers
+  void runTile(uint tileRow, uint tileCol, uint tileSize);
+  std::string tileFilename(uint tileRow, uint tileCol);
+  // p-value counts of one tile, rewritten with the tile on resume
+  std::string tileHistogramFilename(uint tileRow, uint tileCol);
+  bool writeBlockCheckpoint(std::string checkpointFilename, std::string unit);
+  bool readBlockCheckpoint(std::string checkpointFilename, 
+                           std::set<std::string>& completedUnits);
   void writeFailures();
   void writeWarnings();
   void printFittedModel(Model* thisModel);
@@ -109,6 +144,22 @@ private:
 	// in memory arrays
   matrix_t regainMatrix;
   matrix_t regainPMatrix;
+  // sparse output mode: main effects in vectors, interactions streamed
+  bool sparseOutput;
+  std::string sparseEdgesFilename;
+  ZOutput sparseEdgesFile;
+  vector_t mainEffectValues;
+  vector_t mainEffectPvals;
+  PvalueHistogram interactionPvalHistogram;
+  uint numEdgesWritten;
+  bool haveInteractionStats;
+  // fast epistasis prescreen
+  bool usePrescreen;
+  double prescreenPvalue;
+  EpistasisScreen prescreen;
+  uint numScreenedOut;
+  // reusable per-thread regression models
+  ModelContext modelContext;
   // regression warnings - bcw - 4/30/13
   std::vector<std::string> warnings;
   // regression failures - bcw - 5/29/13
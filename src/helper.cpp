@@ -1602,6 +1602,13 @@ void sizeMatrix(matrix_t & m, int r, int c) {
 		m[i].resize(c, 0);
 }
 
+// As sizeMatrix(), but keeps the row allocations of a reused matrix
+void zeroMatrix(matrix_t & m, int r, int c) {
+	m.resize(r);
+	for (int i = 0; i < r; i++)
+		m[i].assign(c, 0);
+}
+
 void sizefMatrix(fmatrix_t & m, int r, int c) {
 	m.clear();
 	m.resize(r);
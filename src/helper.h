@@ -46,6 +46,7 @@ class CSNP;
 using namespace std;
 
 void sizeMatrix(matrix_t &, int,int);
+void zeroMatrix(matrix_t &, int,int);
 void sizefMatrix(fmatrix_t &,int,int);
 void sizeTable(table_t & , int, int);
 
@@ -50,6 +50,8 @@
 #include "CentralityRanker.h"
 #include "ArmadilloFuncs.h"
 #include "EpistasisEQtl.h"
+#include "GenotypeDosages.h"
+#include "CovariateProjection.h"
 
 // ReliefSeq project integration - bcw - 8/7/16
 #include "Dataset.h"
@@ -75,6 +77,9 @@
 #include "Deseq.h"
 #include "Edger.h"
 #include "RegainMinimal.h"
+#include "PvalueHistogram.h"
+#include "GlobalFdr.h"
+#include "DcPermutation.h"
 
 using namespace std;
 using namespace arma;
@@ -200,6 +205,18 @@ int main(int argc, char* argv[]) {
 		shutdown();
 	}
 
+	/////////////////////////
+	// Global FDR over saved p-value histograms and results files
+	if(par::do_global_fdr) {
+		GlobalFdr globalFdr;
+		if(!globalFdr.run(par::global_fdr, par::global_fdr_histograms, 
+			par::global_fdr_matrices, par::global_fdr_results, 
+			par::global_fdr_pvalue_column)) {
+			error("Global FDR failed");
+		}
+		shutdown();
+	}
+
 	//////////////////////////////////////////////////
 	// Main Input files
 
@@ -785,6 +802,9 @@ int main(int argc, char* argv[]) {
     // set parameters
     iqtl->SetLocalCis(par::iqtl_local_cis);
     iqtl->SetRadius(par::iqtl_radius);
+    iqtl->SetStreamResults(par::iqtl_stream, par::iqtl_stream_sorted);
+    iqtl->SetPartition(par::iqtl_partition_index, par::iqtl_num_partitions,
+                       par::iqtl_resume);
     // added 4/21/15
 	  if(par::do_iqtl_tf) {
 	    iqtl->SetTF(par::do_iqtl_tf);
@@ -800,6 +820,12 @@ int main(int argc, char* argv[]) {
 
     // run the analysis
   	P.SNP2Ind();
+    if(par::use_dosage_cache) {
+      GenotypeDosages::enable();
+    }
+    if(par::covar_file && par::use_covar_projection) {
+      CovariateProjection::enable();
+    }
     if(!iqtl->Run()) {
       error("iQTL analysis failed");
     }
@@ -912,6 +938,10 @@ int main(int argc, char* argv[]) {
 				error("Centrality ranking requires a reGAIN file");
 			}
 			P.printLOG(Timestamp() + "Ranking by network centrality: " + par::ranker_method + "\n");
+			if(par::ranker_permutations && 
+				 (par::ranker_method != "centrality_power")) {
+				error("--rank-permutations requires --rank-by centrality_power");
+			}
 			CentralityRanker cr(par::regainFile);
 			if(par::ranker_centrality_gamma > 0) {
 				P.printLOG(Timestamp() + "Network centrality gamma set to: " +
@@ -932,6 +962,11 @@ int main(int argc, char* argv[]) {
 					error("Centrality ranking failed");
 				}
 			}
+			if(par::ranker_permutations) {
+				if(!cr.Permute(par::ranker_permutations)) {
+					error("Centrality permutations failed");
+				}
+			}
 			if(par::verbose) {
 				cr.WriteToConsole(par::ranker_top_n);
 			}
@@ -1646,29 +1681,63 @@ int main(int argc, char* argv[]) {
 	// moved algorithm to armaDcgain function - bcw - 3/12/15
 	if(par::do_differential_coexpression) {
 		P.printLOG("\n" + Timestamp() + "Performing dcGAIN analysis\n");
-    int numVars = P.nlistname.size();
+    string dcgainFilename = par::output_file_name + ".dcgain.tab";
+    string dcgainPvalsFilename = par::output_file_name + ".pvals.dcgain.tab";
     mat zvals, pvals;
-    zvals.zeros(numVars, numVars);
-    pvals.ones(numVars, numVars);\
-    armaDcgain(zvals, pvals);
+    fmat zvalsFloat, pvalsFloat;
+    if(par::dcgain_float32) {
+      P.printLOG(Timestamp() + "dcGAIN results in single precision\n");
+      armaDcgain(zvalsFloat, pvalsFloat);
+    } else {
+      armaDcgain(zvals, pvals);
+    }
     // write results
     if(par::do_dcgain_abs) {
   		P.printLOG(Timestamp() + "Applying abs() transformation\n");
-      // iterate through the sparse matrix non-zero values
-      //      for(sp_mat::iterator i = results.begin(); 
-      //          i != results.end(); ++i) {
-      //        *i = abs(*i);
-      //      }
-      for(int i=0; i < zvals.n_rows; ++i) {
-        for(int j=0; j < zvals.n_cols; ++j) {
-          zvals(i, j) = abs(zvals(i, j));
+      zvals = abs(zvals);
+      zvalsFloat = abs(zvalsFloat);
+    }
+    if(par::dcgain_float32) {
+      armaWriteMatrix(zvalsFloat, dcgainFilename, P.nlistname);
+      armaWriteMatrix(pvalsFloat, dcgainPvalsFilename, P.nlistname);
+    } else {
+      armaWriteMatrix(zvals, dcgainFilename, P.nlistname);
+      armaWriteMatrix(pvals, dcgainPvalsFilename, P.nlistname);
+    }
+    if(par::dc_permutations) {
+      mat edgePvals, fwerPvals;
+      vector<double> maxZ;
+      if(!armaDcgainPermutation(edgePvals, fwerPvals, par::dc_permutations, 
+                                maxZ)) {
+        error("dcGAIN permutations failed");
+      }
+      armaWriteMatrix(edgePvals, par::output_file_name + 
+        ".perm.pvals.dcgain.tab", P.nlistname);
+      armaWriteMatrix(fwerPvals, par::output_file_name + 
+        ".fwer.pvals.dcgain.tab", P.nlistname);
+      string maxZFilename = par::output_file_name + ".perm.maxz.dcgain.txt";
+      P.printLOG(Timestamp() + "Writing permutation maximum Z [ " + 
+        maxZFilename + " ]\n");
+      ofstream maxZFile(maxZFilename);
+      for(uint perm=0; perm < maxZ.size(); ++perm) {
+        maxZFile << maxZ[perm] << endl;
+      }
+      maxZFile.close();
+    }
+    if(par::save_pvalue_histogram) {
+      PvalueHistogram dcgainHistogram;
+      uint numVars = P.nlistname.size();
+      for(uint i=0; i < numVars; ++i) {
+        for(uint j=i + 1; j < numVars; ++j) {
+          dcgainHistogram.add(par::dcgain_float32? 
+            (double) pvalsFloat(i, j): pvals(i, j));
         }
       }
+      string histogramFilename = par::output_file_name + ".dcgain.phist";
+      P.printLOG(Timestamp() + "Writing p-value histogram [ " + 
+        histogramFilename + " ]\n");
+      dcgainHistogram.save(histogramFilename);
     }
-    string dcgainFilename = par::output_file_name + ".dcgain.tab";
-    armaWriteMatrix(zvals, dcgainFilename, P.nlistname);
-    string dcgainPvalsFilename = par::output_file_name + ".pvals.dcgain.tab";
-    armaWriteMatrix(pvals, dcgainPvalsFilename, P.nlistname);
     shutdown();
   }
   
@@ -1677,98 +1746,10 @@ int main(int argc, char* argv[]) {
 	// from bam email modification of dcGAIN - 7/29/14
 	if(par::do_differential_modularity) {
 		P.printLOG(Timestamp() + "Performing dmGAIN analysis\n");
-    int numVars = P.nlistname.size();
-    sp_mat results(numVars, numVars);
-    mat pvals(numVars, numVars);
-
-    // t-test for diagonal
-    int nAff = 0;
-    int nUnaff = 0;
-    for(int i=0; i < PP->sample.size(); i++) {
-      if(PP->sample[i]->aff) {
-        ++nAff;
-      }
-      else {
-        ++nUnaff;
-      }
-    }
-    double df = nAff + nUnaff - 2;
-		P.printLOG(Timestamp() + "Performing z-tests\n");
-    for(int i=0; i < numVars; ++i) {
-      // double t;
-      // tTest(i, t);
-      // double p = pT(t, df);
-      // results(i, i) = t;
-      double z;
-      zTest(i, z);
-      double p = 1.0;
-      results(i, i) = z;
-      if(par::do_regain_pvalue_threshold) {
-        if(p > par::regainPvalueThreshold) {
-          results(i, i) = 0;
-        }
-      }
-      pvals(i, i) = p;
-    }
-
-    // z-test for off-diagonal elements
-    P.printLOG(Timestamp() + "Computing coexpression for CASES and CONTROLS.\n");
-    mat X;
-    mat Y;
-    if(!armaGetPlinkNumericToMatrixCaseControl(X, Y)) {
-      error("Cannot read numeric data into case-control matrices");
-    }
-    // compute covariances/correlations
-    mat covMatrixX;
-    mat corMatrixX;
-    if(!armaComputeCovariance(X, covMatrixX, corMatrixX)) {
-      error("Could not compute coexpression matrix for cases");
-    }
-    mat covMatrixY;
-    mat corMatrixY;
-    if(!armaComputeCovariance(Y, covMatrixY, corMatrixY)) {
-      error("Could not compute coexpression matrix for controls");
-    }
-
-    // algorithm from R script z_test.R, modified by bam email 7/29/14
-    colvec k_1 = sum(mat(corMatrixX), 1);
-		double two_m_1 = sum(k_1);
-		colvec k_2 = sum(mat(corMatrixY), 1);
-		double two_m_2 = sum(k_2);
-
-		P.printLOG(Timestamp() + "Performing Z-tests for interactions\n");
-    double n1 = nAff;
-    double n2 = nUnaff;
-    for(int i=0; i < numVars; ++i) {
-      for(int j=0; j < numVars; ++j) {
-        if(j <= i) {
-          continue;
-        }
-        double r_ij_1 = corMatrixX(i, j);
-        double r_ij_2 = corMatrixY(i, j);
-        double z_ij_1 = corMatrixX(i, j) - k_1(i) * k_1(j) / two_m_1;
-        double z_ij_2 = corMatrixY(i, j) - k_2(i) * k_2(j) / two_m_2;
-        double Z_ij = abs(z_ij_1 - z_ij_2) / sqrt((1/(n1 - 3) + 1 / (n2 - 3)));
-        double p = 2 * normdist(-abs(Z_ij));
-        results(i, j) = Z_ij;
-        results(j, i) = Z_ij;
-        if(par::do_regain_pvalue_threshold) {
-          if(p > par::regainPvalueThreshold) {
-            results(i, j) = 0;
-            results(j, i) = 0;
-          }
-        }
-        pvals(i, j) = p;
-        pvals(j, i) = p;
-      }
-    }
-    // write results
-    if(par::do_dmgain_abs) {
-      for(int i=0; i < results.n_rows; ++i) {
-        for(int j=0; j < results.n_cols; ++j) {
-          results(i, j) = abs(results(i, j));
-        }
-      }
+    sp_mat results;
+    mat pvals;
+    if(!armaDmgain(results, pvals)) {
+      error("armaDmgain failed");
     }
     string dmgainFilename = par::output_file_name + ".dmgain";
     armaWriteSparseMatrix(results, dmgainFilename, P.nlistname);
@@ -1782,6 +1763,12 @@ int main(int argc, char* argv[]) {
 	if(par::do_regain) {
 		P.printLOG(Timestamp() + "Performing REGAIN analysis\n");
 		P.SNP2Ind();
+    if(par::use_dosage_cache) {
+      GenotypeDosages::enable();
+    }
+    if(par::covar_file && par::use_covar_projection) {
+      CovariateProjection::enable();
+    }
     // from command line parameter
     if(par::do_numeric_standardize) {
       P.printLOG(Timestamp() + "Standardizing numeric variables.\n");
@@ -1794,16 +1781,47 @@ int main(int argc, char* argv[]) {
     }
     RegainMinimal regain;
     regain.saveRunInfo(par::do_regain_write_model_details);
+    if(par::do_regain_prescreen && !par::do_regain_merge) {
+      regain.enablePrescreen(par::regainPrescreenPvalue);
+    }
+    if(par::do_regain_blocks && !par::do_regain_merge) {
+      regain.runBlocks(par::regainBlockIndex, par::regainNumBlocks, 
+                       par::regainTileSize, par::do_regain_resume);
+      regain.logOutputOptions();
+      shutdown();
+    }
+    if(par::do_regain_merge) {
+      if(!regain.mergeBlocks(par::regainTileSize)) {
+        error("Merging reGAIN blocks failed");
+      }
+      if(!par::do_regain_sparse) {
+        regain.logMatrixStats();
+        regain.writeRegainMinimalToFile(par::output_file_name + ".regain.tab");
+        regain.writeRegainMinimalPvalsToFile(par::output_file_name + ".regain.pvals.tab");
+        if(par::do_regain_write_sif) {
+          regain.writeRegainMinimalToSifFile(par::output_file_name + ".regain.sif");
+        }
+      }
+      shutdown();
+    }
+    if(par::do_regain_sparse) {
+      regain.setSparseOutput(par::output_file_name + ".regain.edges.gz");
+    }
 		regain.run();
 		regain.logOutputOptions();
 		regain.logMatrixStats();
-		regain.writeRegainMinimalToFile(par::output_file_name + ".regain.tab");
-		regain.writeRegainMinimalPvalsToFile(par::output_file_name + ".regain.pvals.tab");
+    if(par::do_regain_sparse) {
+      regain.closeSparseOutput();
+      regain.writeRegainMinimalMainEffectsToFile(par::output_file_name + ".regain.main.tab");
+    } else {
+      regain.writeRegainMinimalToFile(par::output_file_name + ".regain.tab");
+      regain.writeRegainMinimalPvalsToFile(par::output_file_name + ".regain.pvals.tab");
+      if(par::do_regain_write_sif) {
+        regain.writeRegainMinimalToSifFile(par::output_file_name + ".regain.sif");
+      }
+    }
     if(par::do_regain_write_model_details) {
      regain.writeRegainMinimalRunInfo(par::output_file_name + ".runinfo.tab");
-    }
-    if(par::do_regain_write_sif) {
-      regain.writeRegainMinimalToSifFile(par::output_file_name + ".regain.sif");
     }
 		// stop inbix processing
 		shutdown();
@@ -2686,6 +2704,11 @@ int main(int argc, char* argv[]) {
 					//        linear & logistic models
 					//        2x2xK Cochran-Mantel-Haenszel
 
+					// covariate-adjusted --linear models share covariate QRs
+					if(par::assoc_glm && par::qt && par::covar_file &&
+						 par::use_covar_projection) {
+						CovariateProjection::enable();
+					}
 					P.calcAssociationWithPermutation(perm);
 				}
 
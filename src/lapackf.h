@@ -17,4 +17,28 @@
 bool svd_lapack(int,vector_t & A, vector_t & S,  matrix_t & V);
 bool eigen_lapack(int,vector_t & A, vector_t & S, matrix_t & V);
 
+// Least squares fit of y = X b for a column-major n x p design matrix X.
+// Returns b and (X'X)^-1 (p x p, column-major). Both return false when the
+// design is rank deficient or ill-conditioned so callers can fall back to SVD
+bool ls_cholesky_lapack(int n, int p, vector_t & X, vector_t & y, 
+			vector_t & b, vector_t & XtXinv);
+bool ls_qr_lapack(int n, int p, vector_t & X, vector_t & y, 
+		  vector_t & b, vector_t & XtXinv);
+
+// Thin QR of a column-major n x k matrix A: A is replaced by the orthonormal
+// n x k Q and Rinv is set to R^-1 (k x k, column-major, upper triangular).
+// Returns false for a rank deficient A
+bool qr_basis_lapack(int n, int k, vector_t & A, vector_t & Rinv);
+// Inverse of a symmetric positive definite p x p matrix (column-major, upper
+// triangle used) in place; false when singular or ill-conditioned
+bool sym_inverse_lapack(int p, vector_t & A);
+// Least squares fit of y = C bC + T bT when the n x k covariate block C = QR
+// is already factored (Q, Rinv from qr_basis_lapack). TY holds the n x t 
+// test columns followed by y (column-major). Only the test terms are fit on 
+// the covariate-residualized data; bC and the full (X'X)^-1 for X = [C T] 
+// ((k+t) x (k+t), column-major) are recovered from the block inverse
+bool ls_projected_lapack(int n, int k, int t, vector_t & Q, vector_t & Rinv,
+			 vector_t & TY, vector_t & bC, vector_t & bT, 
+			 vector_t & XtXinv);
+
 #endif
@@ -13,9 +13,11 @@
 #include <cmath>
 
 #include "linear.h"
+#include "lapackf.h"
 #include "helper.h"
 #include "options.h"
 #include "stats.h"
+#include "CovariateProjection.h"
 #include "Insilico.h"
 
 LinearModel::LinearModel(Plink * p_) {
@@ -36,6 +38,10 @@ void LinearModel::setDependent() {
 	}
 }
 
+void LinearModel::setDependent(const vector_t & y) {
+	Y = y;
+}
+
 void LinearModel::pruneY() {
 	//////////////////////////////////
 	// Prune out rows that are missing
@@ -241,6 +247,9 @@ void LinearModel::standardise() {
 
 void LinearModel::fitLM() {
 
+	// a reused model must not return the RSS cached from its last fit
+	RSS = -1;
+
 	if(par::algorithm_verbose) {
 		for(int i = 0; i < nind; i++) {
 			cout << "VO " << i << "\t"
@@ -256,8 +265,9 @@ void LinearModel::fitLM() {
 	//       display(X);
 	//       cout << "---\n";
 
-	coef.resize(np);
-	sizeMatrix(S, np, np);
+	// assign rather than resize, the model may be reused
+	coef.assign(np, 0);
+	zeroMatrix(S, np, np);
 
 	if(np == 0 || nind == 0) {
     invalidType = REGRESSION_INVALID_EMPTY;
@@ -272,8 +282,99 @@ void LinearModel::fitLM() {
 	setVariance();
 
 	// looks like the only place this ever gets set - bcw - 4/29/13
-	sig.resize(nind, sqrt(1.0 / sqrt((double) nind)));
+	sig.assign(nind, sqrt(1.0 / sqrt((double) nind)));
+
+	// Fast path: LAPACK Cholesky or QR least squares; falls back to the
+	// Numerical Recipes SVD fit on rank deficiency or ill-conditioning
+	matrix_t & S0 = lsS0;
+	bool solved = false;
+	if(CovariateProjection::isEnabled()) {
+		solved = fitProjected(S0);
+	}
+	if(!solved && par::linear_solver != "svd") {
+		solved = fitLapack(S0);
+	}
+	if(!solved && !fitSVD(S0)) {
+		return;
+	}
+
+	if(par::algorithm_verbose) {
+		cout << "beta...\n";
+		display(coef);
+		cout << "Sigma(S0b)\n";
+		display(S0);
+		cout << "\n";
+	}
+
+	////////////////////////
+	// Calculate s^2 (sigma)
+	if(!cluster) {
+		double sigma = 0.0;
+		for(int i = 0; i < nind; i++) {
+			double partial = 0.0;
+			for(int j = 0; j < np; j++) {
+				partial += coef[j] * X[i][j];
+			}
+			partial -= Y[i];
+			sigma += partial * partial;
+		}
+		sigma /= nind - np;
+
+		for(int i = 0; i < np; i++) {
+			for(int j = 0; j < np; j++) {
+				S[i][j] = S0[i][j] * sigma;
+			}
+		}
+	}
 
+	///////////////////////////
+	// Robust-cluster variance
+	if(cluster) {
+		vector<vector_t> sc(nc);
+		for(int i = 0; i < nc; i++) {
+			sc[i].resize(np, 0);
+		}
+
+		for(int i = 0; i < nind; i++) {
+			double partial = 0.0;
+			for(int j = 0; j < np; j++) {
+				partial += coef[j] * X[i][j];
+			}
+			partial -= Y[i];
+
+			for(int j = 0; j < np; j++) {
+				sc[clst[i]][j] += partial * X[i][j];
+			}
+		}
+
+		matrix_t meat;
+		sizeMatrix(meat, np, np);
+		for(int k = 0; k < nc; k++) {
+			for(int i = 0; i < np; i++) {
+				for(int j = 0; j < np; j++) {
+					meat[i][j] += sc[k][i] * sc[k][j];
+				}
+			}
+		}
+
+		matrix_t tmp1;
+		multMatrix(S0, meat, tmp1);
+		multMatrix(tmp1, S0, S);
+	}
+
+	if(par::algorithm_verbose) {
+		cout << "coefficients:\n";
+		display(coef);
+		cout << "var-cov matrix:\n";
+		display(S);
+		cout << "\n";
+	}
+
+	// update model fitting information - bcw - 4/26/13
+	converged = true;
+}
+
+bool LinearModel::fitSVD(matrix_t & S0) {
 	w.resize(np);
 	sizeMatrix(u, nind, np);
 	sizeMatrix(v, np, np);
@@ -320,7 +421,7 @@ void LinearModel::fitLM() {
 	if(!flag) {
 		all_valid = false;
     invalidType = REGRESSION_INVALID_SVDINV;
-		return;
+		return false;
 	}
 
 	wmax = 0.0;
@@ -383,7 +484,6 @@ void LinearModel::fitLM() {
 			Xt[j][i] = X[i][j];
 		}
 	}
-	matrix_t S0;
 	multMatrix(Xt, X, S0);
 	flag = true;
 	S0 = svd_inverse(S0, flag);
@@ -391,83 +491,123 @@ void LinearModel::fitLM() {
 		all_valid = false;
     converged = false;
     invalidType = REGRESSION_INVALID_SVDINV;
-  	return;
+  	return false;
 	}
 
-	if(par::algorithm_verbose) {
-		cout << "beta...\n";
-		display(coef);
-		cout << "Sigma(S0b)\n";
-		display(S0);
-		cout << "\n";
-	}
+	return true;
+}
 
-	////////////////////////
-	// Calculate s^2 (sigma)
-	if(!cluster) {
-		double sigma = 0.0;
-		for(int i = 0; i < nind; i++) {
-			double partial = 0.0;
-			for(int j = 0; j < np; j++) {
-				partial += coef[j] * X[i][j];
-			}
-			partial -= Y[i];
-			sigma += partial * partial;
+bool LinearModel::fitLapack(matrix_t & S0) {
+	// column-major copies of X and Y
+	lsX.resize(nind * np);
+	lsY.assign(Y.begin(), Y.end());
+	for(int i = 0; i < nind; i++) {
+		for(int j = 0; j < np; j++) {
+			lsX[i + j * nind] = X[i][j];
 		}
-		sigma /= nind - np;
+	}
 
-		for(int i = 0; i < np; i++) {
-			for(int j = 0; j < np; j++) {
-				S[i][j] = S0[i][j] * sigma;
-			}
+	bool solved = false;
+	if(par::linear_solver == "cholesky") {
+		solved = ls_cholesky_lapack(nind, np, lsX, lsY, lsB, lsXtXinv);
+	}
+	if(!solved) {
+		solved = ls_qr_lapack(nind, np, lsX, lsY, lsB, lsXtXinv);
+	}
+	if(!solved) {
+		return false;
+	}
+
+	coef.assign(lsB.begin(), lsB.end());
+	zeroMatrix(S0, np, np);
+	for(int i = 0; i < np; i++) {
+		for(int j = 0; j < np; j++) {
+			S0[i][j] = lsXtXinv[i + j * np];
 		}
 	}
 
-	///////////////////////////
-	// Robust-cluster variance
-	if(cluster) {
-		vector<vector_t> sc(nc);
-		for(int i = 0; i < nc; i++) {
-			sc[i].resize(np, 0);
+	chisq = 0.0;
+	for(int i = 0; i < nind; i++) {
+		double sum = 0.0;
+		for(int j = 0; j < np; j++) {
+			sum += coef[j] * X[i][j];
 		}
+		double tmp = (Y[i] - sum) / sig[i];
+		chisq += tmp * tmp;
+	}
 
-		for(int i = 0; i < nind; i++) {
-			double partial = 0.0;
-			for(int j = 0; j < np; j++) {
-				partial += coef[j] * X[i][j];
-			}
-			partial -= Y[i];
+	return true;
+}
 
-			for(int j = 0; j < np; j++) {
-				sc[clst[i]][j] += partial * X[i][j];
-			}
+bool LinearModel::fitProjected(matrix_t & S0) {
+	// Intercept and covariate columns, and the terms under test
+	if(cluster || par::glm_user_parameters || covariate.size() == 0) {
+		return false;
+	}
+	lsCovariateCols.clear();
+	lsTestCols.clear();
+	for(int p = 0; p < np; p++) {
+		if(type[p] == INTERCEPT || type[p] == COVARIATE) {
+			lsCovariateCols.push_back(p);
+		} else {
+			lsTestCols.push_back(p);
 		}
+	}
+	int k = lsCovariateCols.size();
+	int t = lsTestCols.size();
+	if(t == 0) {
+		return false;
+	}
 
-		matrix_t meat;
-		sizeMatrix(meat, np, np);
-		for(int k = 0; k < nc; k++) {
-			for(int i = 0; i < np; i++) {
-				for(int j = 0; j < np; j++) {
-					meat[i][j] += sc[k][i] * sc[k][j];
-				}
-			}
+	CovariateBasis * basis = 
+		CovariateProjection::get(miss, covariate, X, lsCovariateCols);
+	if(!basis) {
+		return false;
+	}
+
+	// column-major test columns followed by Y
+	lsX.resize(nind * (t + 1));
+	for(int i = 0; i < nind; i++) {
+		for(int j = 0; j < t; j++) {
+			lsX[i + j * nind] = X[i][lsTestCols[j]];
 		}
+		lsX[i + t * nind] = Y[i];
+	}
 
-		matrix_t tmp1;
-		multMatrix(S0, meat, tmp1);
-		multMatrix(tmp1, S0, S);
+	vector_t bC, bT;
+	if(!ls_projected_lapack(nind, k, t, basis->Q, basis->Rinv, lsX, 
+				bC, bT, lsXtXinv)) {
+		return false;
 	}
 
-	if(par::algorithm_verbose) {
-		cout << "coefficients:\n";
-		display(coef);
-		cout << "var-cov matrix:\n";
-		display(S);
-		cout << "\n";
+	// back to the column order of X
+	int p = k + t;
+	vector<int> & cols = lsCovariateCols;
+	cols.insert(cols.end(), lsTestCols.begin(), lsTestCols.end());
+	for(int c = 0; c < k; c++) {
+		coef[cols[c]] = bC[c];
+	}
+	for(int j = 0; j < t; j++) {
+		coef[cols[k + j]] = bT[j];
+	}
+	zeroMatrix(S0, np, np);
+	for(int i = 0; i < p; i++) {
+		for(int j = 0; j < p; j++) {
+			S0[cols[i]][cols[j]] = lsXtXinv[i + j * p];
+		}
 	}
 
-	// update model fitting information - bcw - 4/26/13
-	converged = true;
+	chisq = 0.0;
+	for(int i = 0; i < nind; i++) {
+		double sum = 0.0;
+		for(int j = 0; j < np; j++) {
+			sum += coef[j] * X[i][j];
+		}
+		double tmp = (Y[i] - sum) / sig[i];
+		chisq += tmp * tmp;
+	}
+
+	return true;
 }
 
 void LinearModel::fitUnivariateLM() {
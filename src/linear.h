@@ -25,6 +25,9 @@ public:
 	};
 
 	void setDependent();
+	// Y of the non-missing individuals, e.g., one of several traits fit with
+	// the same design matrix
+	void setDependent(const vector_t & y);
 	void fitLM();
 	void fitUnivariateLM();
 
@@ -60,8 +63,23 @@ private:
 
 	double RSS;
 
+	// least squares workspace, kept between fits of a reused model
+	vector_t lsX;
+	vector_t lsY;
+	vector_t lsB;
+	vector_t lsXtXinv;
+	matrix_t lsS0;
+	vector<int> lsCovariateCols;
+	vector<int> lsTestCols;
+
 	void function(const int i, vector<double> & p); // <- NEVER USED bcw 4/29/13
 	void setVariance();
+	// least squares backends for fitLM: set coef, chisq and S0 = (X'X)^-1
+	bool fitSVD(matrix_t & S0);
+	bool fitLapack(matrix_t & S0);
+	// covariate-projected fit with a cached covariate QR, see 
+	// CovariateProjection.h
+	bool fitProjected(matrix_t & S0);
 };
 
 
@@ -59,8 +59,9 @@ void LogisticModel::pruneY() {
 
 void LogisticModel::fitLM() {
 
-	coef.resize(np);
-	sizeMatrix(S, np, np);
+	// Newton-Raphson starts from zero, also for a reused model
+	coef.assign(np, 0);
+	zeroMatrix(S, np, np);
 
 	if(np == 0 || nind == 0) {
     invalidType = REGRESSION_INVALID_EMPTY;
@@ -55,6 +55,8 @@ Model::Model() {
 	// fitting information
 	converged = false;
 	numIterations = 0;
+
+	dosages = 0;
 }
 
 void Model::setDominant() {
@@ -191,6 +193,37 @@ void Model::addTypedInteraction(int a, ModelTermType typeA,
 	order.push_back(typed_interaction.size() - 1);
 }
 
+void Model::resetTerms() {
+	// Clear the model terms and fitting state, but keep the capacity of
+	// the term lists and the rows of X, so a single model object can be
+	// reused for many tests
+	additive.clear();
+	dominance.clear();
+	haplotype.clear();
+	covariate.clear();
+	numeric.clear();
+	interaction.clear();
+	typed_interaction.clear();
+	xchr.clear();
+	haploid.clear();
+	valid.clear();
+	sex_effect = false;
+
+	label.clear();
+	type.clear();
+	order.clear();
+	label.push_back("M"); // Intercept
+	type.push_back(INTERCEPT);
+	order.push_back(0);
+
+	np = nind = 0;
+	all_valid = true;
+	invalidType = REGRESSION_INVALID_NONE;
+	testParameter = 1;
+	converged = false;
+	numIterations = 0;
+}
+
 void Model::buildDesignMatrix() {
 	// Build X matrix (including intercept)
 	// Iterate a person at a time, entering only 
@@ -235,8 +268,26 @@ void Model::buildDesignMatrix() {
 
 	// cout << "buildDesignMatrix, number of parameters: " << np << endl;
 
+	// Use the shared genotype dosage table if enabled; the lookup reflects
+	// the current additive/dominant/recessive and X chromosome coding
+	dosages = has_snps ? GenotypeDosages::get() : 0;
+	if(dosages && (dosages->getNumIndividuals() != P->n)) {
+		dosages = 0;
+	}
+	if(dosages) {
+		dosageValue[DOSAGE_HOM_A1] = mAA;
+		dosageValue[DOSAGE_HET] = mAB;
+		dosageValue[DOSAGE_HOM_A2] = mBB;
+		dosageValue[DOSAGE_MALE_X_A1] = mA;
+		dosageValue[DOSAGE_MALE_X_A2] = mB;
+		dosageValue[DOSAGE_HAPLOID_A1] = 0;
+		dosageValue[DOSAGE_HAPLOID_A2] = 1;
+	}
+
 	///////////////////////////
-	// Consider each individual
+	// Consider each individual; rows of X are filled in place, so a
+	// reused model does not reallocate its design matrix
+	int nrow = 0;
 	for(int i = 0; i < P->n; i++) {
 
 		Individual * person = P->sample[i];
@@ -260,7 +311,12 @@ void Model::buildDesignMatrix() {
 
 		skip = false;
 
-		vector_t trow(np);
+		if(nrow == X.size()) {
+			X.push_back(vector_t(np));
+		} else {
+			X[nrow].resize(np);
+		}
+		vector_t & trow = X[nrow];
 
 		for(int p = 0; p < np; p++) {
 
@@ -272,7 +328,10 @@ void Model::buildDesignMatrix() {
 					trow[p] = buildIntercept();
 					break;
 				case ADDITIVE:
-					trow[p] = buildAdditive(person, order[p]);
+					if(dosages)
+						trow[p] = buildAdditiveDosage(i, order[p]);
+					else
+						trow[p] = buildAdditive(person, order[p]);
 					break;
 				case DOMDEV:
 					trow[p] = buildDominance(person, order[p]);
@@ -308,10 +367,12 @@ void Model::buildDesignMatrix() {
 		}
 
 		////////////////////////////
-		// Add row to design matrix
-		X.push_back(trow);
+		// Keep row in design matrix
+		nrow++;
 	}
 
+	// Drop rows left over from a previous build
+	X.resize(nrow);
 
 	/////////////////////////////////////////////////
 	// Set number of non-missing individuals
@@ -660,6 +721,15 @@ double Model::buildAdditive(Individual * person, int snp) {
 
 }
 
+double Model::buildAdditiveDosage(int i, int snp) {
+	signed char code = dosages->column(additive[snp])[i];
+	if(code < 0) {
+		skip = true;
+		return 0;
+	}
+	return dosageValue[code];
+}
+
 double Model::getSimpleSNPValue(Individual* person, int snp) {
 
   bool i1 = person->one[snp];
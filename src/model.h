@@ -15,6 +15,7 @@
 
 #include "plink.h"
 #include "Insilico.h"
+#include "GenotypeDosages.h"
         
 using namespace std;
 
@@ -53,6 +54,8 @@ public:
 	void addInteraction(int, int);
 	void addTypedInteraction(int, ModelTermType, int, ModelTermType);
 	void buildDesignMatrix();
+	// remove all terms but keep allocated storage for reuse of the model
+	void resetTerms();
 	bool checkVIF();
 	vector<bool> validParameters();
 
@@ -129,6 +132,8 @@ protected:
 
 	double buildIntercept();
 	double buildAdditive(Individual*, int);
+	// additive term from the shared genotype dosage table
+	double buildAdditiveDosage(int, int);
   double getSimpleSNPValue(Individual* person, int snp);
 	double buildDominance(Individual*, int);
 	double buildHaplotype(int, int);
@@ -151,6 +156,10 @@ protected:
 
 	double mA, mB;
 
+	// shared genotype dosage table and class-to-dosage lookup
+	GenotypeDosages* dosages;
+	double dosageValue[DOSAGE_NUM_CLASSES];
+
 	// List of dominance deviation SNP effects
 	vector<int> dominance;
 
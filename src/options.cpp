@@ -249,10 +249,17 @@ bool par::do_coexpression_casecontrol = false;
 bool par::do_numeric_summary = false;
 bool par::do_numeric_extract = false;
 string par::numeric_extract_file = "";
+// binary matrix output
+bool par::matrix_binary = false;
+bool par::matrix_binary_upper = false;
+bool par::matrix_binary_float32 = false;
+bool par::matrix_binary_compress = false;
 
 // differential coexpression analysis - bcw - 10/30/13
 bool par::do_differential_coexpression = false;
 bool par::do_dcgain_abs = false;
+bool par::dcgain_float32 = false;
+int par::dc_permutations = 0;
 
 // differential coexpression variant analysis - bcw - 2/22/15
 bool par::do_dcvar = false;
@@ -267,6 +274,8 @@ string par::dcvar_gene_expression_file = "";
 string par::dcvar_chip_seq_file = "";
 bool par::do_dcvar_chipseq = false;
 bool par::dcvar_resume_snp = false;
+bool par::dcvar_group_stats = true;
+int par::dcvar_pipeline_threads = 0;
 // added for radius searches - bcw - 1/10/18
 uint par::dcvar_radius = 1000;
 
@@ -298,6 +307,13 @@ bool par::regainCompress = false;
 bool par::regainComponents = false;
 double par::regainFdr = 0.5;
 bool par::regainFdrPrune = false;
+bool par::save_pvalue_histogram = false;
+bool par::do_global_fdr = false;
+double par::global_fdr = 0.05;
+string par::global_fdr_histograms = "";
+string par::global_fdr_matrices = "";
+string par::global_fdr_results = "";
+int par::global_fdr_pvalue_column = 0;
 bool par::regainSifFilter = false;
 double par::regainSifThreshold = -9999999;
 bool par::regainUseBetaValues = false;
@@ -310,6 +326,24 @@ string par::regainMatrixFormat = "full";
 bool par::regainMatrixThreshold = false;
 double par::regainMatrixThresholdValue = 0.0;
 bool par::regainMatrixToSif = false;
+// sparse streaming edge list output
+bool par::do_regain_sparse = false;
+// blocked execution with checkpoint/resume
+bool par::do_regain_blocks = false;
+int par::regainBlockIndex = 1;
+int par::regainNumBlocks = 1;
+int par::regainTileSize = 256;
+bool par::do_regain_resume = false;
+bool par::do_regain_merge = false;
+// fast epistasis prescreen before full regression
+bool par::do_regain_prescreen = false;
+double par::regainPrescreenPvalue = 0.01;
+// shared genotype dosage table for regression models
+bool par::use_dosage_cache = true;
+// cached covariate QR for covariate-adjusted linear models
+bool par::use_covar_projection = true;
+// LinearModel least squares backend: cholesky, qr or svd
+string par::linear_solver = "cholesky";
   // deconvolution - bcw - 10/22/13
 bool par::do_deconvolution = false;
 double par::deconvolutionAlpha = 1.0;
@@ -435,6 +469,10 @@ int par::ranker_top_n = -1;
 string par::ranker_save_data_file = "";
 string par::ranker_input_file = "";
 double par::ranker_centrality_gamma = 0.85;
+int par::ranker_max_iterations = 1000;
+double par::ranker_tolerance = 1.0E-4;
+int par::ranker_permutations = 0;
+string par::ranker_permute_null = "degree";
 // added for SNPrank permutation testing - bcw - 5/23/14
 bool par::do_ranker_permutation = false;
 int par::rankerPermNum = 100;
@@ -457,6 +495,12 @@ bool par::do_iqtl_tf = false;
 int par::iqtl_tf_radius = 0;
 string par::iqtl_tf_coord_file = "";
 double par::iqtl_pvalue = 0.5;
+int par::iqtl_transcript_batch = 0;
+bool par::iqtl_stream = false;
+bool par::iqtl_stream_sorted = false;
+int par::iqtl_partition_index = 1;
+int par::iqtl_num_partitions = 1;
+bool par::iqtl_resume = false;
 
 bool par::no_show_covar = false;
 bool par::dump_covar = false;
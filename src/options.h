@@ -347,10 +347,17 @@ public:
   static bool do_numeric_summary;
   static bool do_numeric_extract;
   static string numeric_extract_file;
+  // binary matrix output
+  static bool matrix_binary;
+  static bool matrix_binary_upper;
+  static bool matrix_binary_float32;
+  static bool matrix_binary_compress;
   
   // differential coexpression analysis - bcw - 10/30/13
   static bool do_differential_coexpression;
   static bool do_dcgain_abs;
+  static bool dcgain_float32;
+  static int dc_permutations;
   // added for Caleb's study of eQTL SNPS - bcw - 2/22/15
   static bool do_dcvar;
   static bool do_dcvar_pfilter;
@@ -364,6 +371,8 @@ public:
   static string dcvar_chip_seq_file;
   static bool do_dcvar_chipseq;
   static bool dcvar_resume_snp;
+  static bool dcvar_group_stats;
+  static int dcvar_pipeline_threads;
   // added for radius searches - bcw - 1/10/18
   static uint dcvar_radius;
   
@@ -395,6 +404,13 @@ public:
   static bool regainComponents;
   static double regainFdr;
   static bool regainFdrPrune;
+  static bool save_pvalue_histogram;
+  static bool do_global_fdr;
+  static double global_fdr;
+  static string global_fdr_histograms;
+  static string global_fdr_matrices;
+  static string global_fdr_results;
+  static int global_fdr_pvalue_column;
   static bool regainSifFilter;
   static double regainSifThreshold;
   static bool regainUseBetaValues;
@@ -407,6 +423,24 @@ public:
   static bool regainMatrixThreshold;
   static double regainMatrixThresholdValue;
   static bool regainMatrixToSif;
+  // sparse streaming edge list output
+  static bool do_regain_sparse;
+  // blocked execution with checkpoint/resume
+  static bool do_regain_blocks;
+  static int regainBlockIndex;
+  static int regainNumBlocks;
+  static int regainTileSize;
+  static bool do_regain_resume;
+  static bool do_regain_merge;
+  // fast epistasis prescreen before full regression
+  static bool do_regain_prescreen;
+  static double regainPrescreenPvalue;
+  // shared genotype dosage table for regression models
+  static bool use_dosage_cache;
+  // cached covariate QR for covariate-adjusted linear models
+  static bool use_covar_projection;
+  // LinearModel least squares backend: cholesky, qr or svd
+  static string linear_solver;
   // deconvolution - bcw - 10/22/13
   static bool do_deconvolution;
   static double deconvolutionAlpha;
@@ -533,6 +567,10 @@ public:
   static string ranker_save_data_file;
   static string ranker_input_file;
   static double ranker_centrality_gamma;
+  static int ranker_max_iterations;
+  static double ranker_tolerance;
+  static int ranker_permutations;
+  static string ranker_permute_null;
   // added for SNPrank permutation testing - bcw - 5/23/14
   static bool do_ranker_permutation;
   static string rankerPermMethod;
@@ -556,6 +594,12 @@ public:
   static int iqtl_tf_radius;
   static string iqtl_tf_coord_file;
   static double iqtl_pvalue;
+  static int iqtl_transcript_batch;
+  static bool iqtl_stream;
+  static bool iqtl_stream_sorted;
+  static int iqtl_partition_index;
+  static int iqtl_num_partitions;
+  static bool iqtl_resume;
 
   static bool no_show_covar;
   static bool dump_covar;
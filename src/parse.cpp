@@ -2794,6 +2794,23 @@ void setOptions(CArgs & a) {
     par::numeric_extract_file = a.value("--numeric-extract");
   }
 
+  // binary matrix output
+  if(a.find("--matrix-binary")) {
+    par::matrix_binary = true;
+  }
+  if(a.find("--matrix-binary-upper")) {
+    par::matrix_binary = true;
+    par::matrix_binary_upper = true;
+  }
+  if(a.find("--matrix-binary-float")) {
+    par::matrix_binary = true;
+    par::matrix_binary_float32 = true;
+  }
+  if(a.find("--matrix-binary-compress")) {
+    par::matrix_binary = true;
+    par::matrix_binary_compress = true;
+  }
+
   // data set transforms prior to analysis - bcw - 10/30/13
   if(a.find("--numeric-standardize")) {
     par::do_numeric_standardize = true;
@@ -2806,6 +2823,15 @@ void setOptions(CArgs & a) {
   if(a.find("--dcgain-abs")) {
     par::do_dcgain_abs = true;
   }
+  if(a.find("--dcgain-float")) {
+    par::dcgain_float32 = true;
+  }
+  if(a.find("--dc-permutations")) {
+    par::dc_permutations = a.value_int("--dc-permutations");
+    if(par::dc_permutations < 1) {
+      error("--dc-permutations must be at least 1");
+    }
+  }
 
   // for Caleb's project - bcw - 2/5/15
   // changed to dcvar - bcw - 2/22/15
@@ -2840,6 +2866,15 @@ void setOptions(CArgs & a) {
   if(a.find("--dcvar-resume-snp")) {
     par::dcvar_resume_snp = true;
   }
+  if(a.find("--dcvar-no-group-stats")) {
+    par::dcvar_group_stats = false;
+  }
+  if(a.find("--dcvar-pipeline-threads")) {
+    par::dcvar_pipeline_threads = a.value_int("--dcvar-pipeline-threads");
+    if(par::dcvar_pipeline_threads < 1) {
+      error("--dcvar-pipeline-threads must be at least 1");
+    }
+  }
   if(a.find("--dcvar-radius")) {
     par::dcvar_radius = a.value_int("--dcvar-radius");
   }
@@ -2912,6 +2947,37 @@ void setOptions(CArgs & a) {
     par::regainFdr = a.value_double("--regain-fdr");
   }
 
+  if(a.find("--save-pvalue-histogram")) {
+    par::save_pvalue_histogram = true;
+  }
+
+  if(a.find("--global-fdr")) {
+    par::do_global_fdr = true;
+    par::global_fdr = a.value_double("--global-fdr");
+    if((par::global_fdr <= 0) || (par::global_fdr >= 1)) {
+      error("--global-fdr rate must be between 0 and 1");
+    }
+  }
+
+  if(a.find("--global-fdr-histograms")) {
+    par::global_fdr_histograms = a.value("--global-fdr-histograms");
+  }
+
+  if(a.find("--global-fdr-matrices")) {
+    par::global_fdr_matrices = a.value("--global-fdr-matrices");
+  }
+
+  if(a.find("--global-fdr-results")) {
+    par::global_fdr_results = a.value("--global-fdr-results");
+  }
+
+  if(a.find("--global-fdr-pcol")) {
+    par::global_fdr_pvalue_column = a.value_int("--global-fdr-pcol");
+    if(par::global_fdr_pvalue_column < 1) {
+      error("--global-fdr-pcol must be at least 1");
+    }
+  }
+
   if(a.find("--regain-sif-threshold")) {
     par::regainSifFilter = true;
     par::regainSifThreshold = a.value_double("--regain-sif-threshold");
@@ -2934,6 +3000,70 @@ void setOptions(CArgs & a) {
     par::regainMatrixFormat = a.value("--regain-matrix-format");
   }
 
+  // sparse streaming edge list output
+  if(a.find("--regain-sparse-output")) {
+    par::do_regain_sparse = true;
+  }
+
+  // blocked execution with checkpoint/resume
+  if(a.find("--regain-block")) {
+    par::do_regain_blocks = true;
+    string blockSpec = a.value("--regain-block");
+    size_t slashPos = blockSpec.find("/");
+    if(slashPos == string::npos) {
+      error("--regain-block must be of the form i/N, e.g. 3/10");
+    }
+    par::regainBlockIndex = getInt(blockSpec.substr(0, slashPos), "--regain-block");
+    par::regainNumBlocks = getInt(blockSpec.substr(slashPos + 1), "--regain-block");
+    if((par::regainNumBlocks < 1) || (par::regainBlockIndex < 1) || 
+       (par::regainBlockIndex > par::regainNumBlocks)) {
+      error("--regain-block i/N requires 1 <= i <= N");
+    }
+  }
+  if(a.find("--regain-tile-size")) {
+    if(!a.find("--regain-block") && !a.find("--regain-merge-blocks")) {
+      error("--regain-tile-size requires --regain-block or --regain-merge-blocks");
+    }
+    par::regainTileSize = a.value_int("--regain-tile-size");
+    if(par::regainTileSize < 1) {
+      error("--regain-tile-size must be greater than zero");
+    }
+  }
+  if(a.find("--regain-resume")) {
+    if(!a.find("--regain-block")) {
+      error("--regain-resume requires --regain-block");
+    }
+    par::do_regain_resume = true;
+  }
+  if(a.find("--regain-merge-blocks")) {
+    par::do_regain_merge = true;
+  }
+
+  // shared genotype dosage table for regression models
+  if(a.find("--no-dosage-cache")) {
+    par::use_dosage_cache = false;
+  }
+
+  // cached covariate QR for covariate-adjusted linear models
+  if(a.find("--no-covar-projection")) {
+    par::use_covar_projection = false;
+  }
+
+  // LinearModel least squares backend
+  if(a.find("--linear-solver")) {
+    par::linear_solver = a.value("--linear-solver");
+    if((par::linear_solver != "cholesky") && (par::linear_solver != "qr") &&
+       (par::linear_solver != "svd")) {
+      error("--linear-solver must be one of: cholesky, qr, svd");
+    }
+  }
+
+  // fast epistasis prescreen before full regression
+  if(a.find("--regain-prescreen")) {
+    par::do_regain_prescreen = true;
+    par::regainPrescreenPvalue = a.value_double("--regain-prescreen");
+  }
+
   if(a.find("--regain-file")) {
     par::do_regain_post = true;
     par::regainFile = a.value("--regain-file");
@@ -3225,6 +3355,35 @@ void setOptions(CArgs & a) {
   if(a.find("--rank-centrality-gamma")) {
     par::ranker_centrality_gamma = a.value_double("--rank-centrality-gamma");
   }
+
+  if(a.find("--rank-max-iterations")) {
+    par::ranker_max_iterations = a.value_int("--rank-max-iterations");
+    if(par::ranker_max_iterations < 1) {
+      error("--rank-max-iterations must be at least 1");
+    }
+  }
+
+  if(a.find("--rank-tolerance")) {
+    par::ranker_tolerance = a.value_double("--rank-tolerance");
+    if(par::ranker_tolerance <= 0) {
+      error("--rank-tolerance must be greater than zero");
+    }
+  }
+
+  if(a.find("--rank-permutations")) {
+    par::ranker_permutations = a.value_int("--rank-permutations");
+    if(par::ranker_permutations < 1) {
+      error("--rank-permutations must be at least 1");
+    }
+  }
+
+  if(a.find("--rank-permute-null")) {
+    par::ranker_permute_null = a.value("--rank-permute-null");
+    if((par::ranker_permute_null != "degree") && 
+       (par::ranker_permute_null != "label")) {
+      error("--rank-permute-null must be degree or label");
+    }
+  }
   
   // added for SNPrank permutation testing - bcw - 5/23/14
   if(a.find("--permute-gain-method")) {
@@ -3290,6 +3449,37 @@ void setOptions(CArgs & a) {
   if(a.find("--iqtl-pvalue")) {
     par::iqtl_pvalue = a.value_double("--iqtl-pvalue");
   }
+  if(a.find("--iqtl-batch-transcripts")) {
+    par::iqtl_transcript_batch = a.value_int("--iqtl-batch-transcripts");
+    if(par::iqtl_transcript_batch < 1) {
+      error("--iqtl-batch-transcripts must be at least 1");
+    }
+  }
+  if(a.find("--iqtl-stream")) {
+    par::iqtl_stream = true;
+  }
+  if(a.find("--iqtl-stream-sorted")) {
+    par::iqtl_stream = true;
+    par::iqtl_stream_sorted = true;
+  }
+  if(a.find("--iqtl-partition")) {
+    string partitionSpec = a.value("--iqtl-partition");
+    size_t slashPos = partitionSpec.find("/");
+    if(slashPos == string::npos) {
+      error("--iqtl-partition must be of the form i/N, e.g. 3/10");
+    }
+    par::iqtl_partition_index = 
+      getInt(partitionSpec.substr(0, slashPos), "--iqtl-partition");
+    par::iqtl_num_partitions = 
+      getInt(partitionSpec.substr(slashPos + 1), "--iqtl-partition");
+    if((par::iqtl_num_partitions < 1) || (par::iqtl_partition_index < 1) || 
+       (par::iqtl_partition_index > par::iqtl_num_partitions)) {
+      error("--iqtl-partition i/N requires 1 <= i <= N");
+    }
+  }
+  if(a.find("--iqtl-resume")) {
+    par::iqtl_resume = true;
+  }
   
   ////////////////////////
   // Reference allele file
@@ -4471,6 +4661,10 @@ void setOptions(CArgs & a) {
             << "      --numeric-low-value-filter {percentile}     Remove variables with values below given percentile\n"
             << "      --numeric-low-variance-filter {percentile}  Remove variables with variance below given percentile\n"
             << "      --numeric-standardize                       Subtract the numeric variable means and divide by standard deviations before analysis\n"            
+            << "      --matrix-binary                             Write variable matrices as binary <file>.bmat\n"
+            << "      --matrix-binary-upper                       Binary matrices store only the upper triangle\n"
+            << "      --matrix-binary-float                       Binary matrices store single precision values\n"
+            << "      --matrix-binary-compress                    Binary matrices store zlib-compressed blocks\n"
             << "\n"
             << "      --regain                                    Perform a reGAIN analysis\n"
             << "      --regain-write-sif                          Write reGAIN analysis as SIF\n"
@@ -4479,9 +4673,24 @@ void setOptions(CArgs & a) {
             << "      --regain-pure-interactions                  Exclude main effects from interactions\n"
             << "      --regain-fail-value {value}                 Value to use if regression failure\n"
             << "      --regain-pvalue-threshold {value}           P-value threshold for writing reGAIN values\n"
+            << "      --regain-sparse-output                      Stream thresholded reGAIN interactions to a compressed edge list\n"
+            << "      --regain-fdr {rate}                         BH FDR pruning of sparse reGAIN edge list\n"
+            << "      --save-pvalue-histogram                     Save p-value histograms of all dcVar/dcGAIN/reGAIN/iQTL tests\n"
+            << "      --global-fdr {rate}                         BH FDR over merged p-value histograms and matrices\n"
+            << "      --global-fdr-histograms {file}              List of saved p-value histogram files\n"
+            << "      --global-fdr-matrices {file}                List of p-value matrix files (dcGAIN, reGAIN)\n"
+            << "      --global-fdr-results {file}                 List of results files to filter with the global threshold\n"
+            << "      --global-fdr-pcol {n}                       P-value column of the results files (default last)\n"
+            << "      --regain-block {i/N}                        Run block i of N of the reGAIN interaction tiles\n"
+            << "      --regain-tile-size {size}                   reGAIN tile size for blocks and merges (default 256)\n"
+            << "      --regain-resume                             Resume a --regain-block run from its checkpoint\n"
+            << "      --regain-merge-blocks                       Merge blocked reGAIN tile outputs\n"
+            << "      --regain-prescreen {p-value}                Fit only pairs passing a fast epistasis screen\n"
+            << "      --no-dosage-cache                           Decode genotypes per model (reGAIN/iQTL)\n"
+            << "      --no-covar-projection                       Fit covariates in every linear model (--linear/reGAIN/iQTL)\n"
+            << "      --linear-solver {cholesky|qr|svd}           Linear regression least squares solver\n"
 //            << "      --regain-compress                           Compress reGAIN output      \n"
 //            << "      --regain-components                         Write reGAIN components     \n"
-//            << "      --regain-fdr {rate}                         Set reGAIN FDR              \n"
 //            << "      --regain-fdr-prune                          Perform reGAIN FDR pruning  \n"
             << "      --regain-sif-threshold {threshold}          Filter reGAIN SIF \n"
             << "      --regain-matrix-threshold-value {threshold} Filter reGAIN output\n"
@@ -4492,12 +4701,16 @@ void setOptions(CArgs & a) {
             << "\n"
             << "      --dcgain                                    Perform a differential coexpression analysis\n"
             << "      --dcgain-abs                                Take absolute value of dcgain matrix\n"
+            << "      --dcgain-float                              Compute and write dcGAIN matrices in single precision\n"
+            << "      --dc-permutations {n}                       Empirical dcGAIN/dcVar p-values from n label permutations\n"
             << "\n"
             << "      --dmgain                                    Perform a differential modularity analysis\n"
             << "      --dmgain-abs                                Take absolute value of dmgain matrix\n"
             << "\n"
             << "      --dcvar                                     Perform a differential coexpression variant analysis\n"
             << "      --dcvar-resume-snp                          Resume SNP phenotype loop from checkpoint file\n"
+            << "      --dcvar-no-group-stats                      Recompute correlations from split expression per SNP\n"
+            << "      --dcvar-pipeline-threads {n}                Format and write SNP results on n background threads each\n"
             << "      --dcvar-pfilter-value {value}               P-value filter value default 0.05\n"
             << "      --dcvar-pfilter-type {bon|fdr|custom}       P-value correction filter Bonferroni (default), FDR BH, custom pure cutoff\n"
             << "      --dcvar-var-model {dom|rec|hom}             Allelic SNP model\n"
@@ -4583,6 +4796,10 @@ void setOptions(CArgs & a) {
             << "      --rank-save-data {file name}                Save ranker results to new data file\n"
             << "      --rank-file {ranker file}                   Load an existing ranker file\n"
             << "      --rank-centrality-gamma {gamma}             Use a specified gamma\n"
+            << "      --rank-max-iterations {n}                   Power method iteration limit (default 1000)\n"
+            << "      --rank-tolerance {tol}                      Power method stop: sum |r_k - r_k-1| below tol (default 1e-4)\n"
+            << "      --rank-permutations {n}                     centrality_power p-values from n permuted networks\n"
+            << "      --rank-permute-null {null}                  Permuted networks: degree (rewired, weights shuffled when dense) | label\n"
             << "\n"
             << "      --permute-gain-method {method}              Permute GAIN method (regain|dcgain)\n"
             << "      --permute-gain-num {numPerms}               Permute GAIN+SNPrank numPerms times\n"
@@ -4601,6 +4818,11 @@ void setOptions(CArgs & a) {
             << "      --TF-radius {value}                         Number of kilobases considered within TF radius\n"
             << "      --TF-file {filename}                        Select coordinates file different from default\n"
             << "      --iqtl-pvalue {threshold}                   P-value threshold\n"
+            << "      --iqtl-batch-transcripts {n}                Fit cis-trans models for n transcripts at once\n"
+            << "      --iqtl-stream                               Write all eQTL and iQTL results to one compressed file\n"
+            << "      --iqtl-stream-sorted                        Stream results sorted by p-value per transcript\n"
+            << "      --iqtl-partition {i/N}                      Run partition i of N of the transcripts\n"
+            << "      --iqtl-resume                               Resume an iQTL run from its checkpoint\n"
             << "      --full                                      Consider all SNPs\n"
             << "\n"
             << "      --verbose                                   Verbose output\n"
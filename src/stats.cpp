@@ -58,16 +58,7 @@ long double factorial(int x) {
 }
 
 double normdist(double z) {
-  double sqrt2pi = 2.50662827463;
-  double t0, z1, p0;
-  t0 = 1 / (1 + 0.2316419 * fabs(z));
-  z1 = exp(-0.5 * z * z) / sqrt2pi;
-  p0 = z1 * t0
-          * (0.31938153 +
-          t0 * (-0.356563782 +
-          t0 * (1.781477937 +
-          t0 * (-1.821255978 +
-          1.330274429 * t0))));
+  double p0 = normdistTail(fabs(z));
   return z >= 0 ? 1 - p0 : p0;
 }
 
@@ -2274,11 +2265,13 @@ bool zTest(int varIndex, double& z) {
   vector_t g2_data;
   getNumericCaseControl(varIndex, g1_data, g2_data);
   if(g1_data.size() == 0) {
+    #pragma omp critical
     cerr << "Group 1 size = 0 in zTest" << endl;
     return false;
   }
   double g1_n = (double) g1_data.size();
   if(g2_data.size() == 0) {
+    #pragma omp critical
     cerr << "Group 2 size = 0 in zTest" << endl;
     return false;
   }
@@ -2300,6 +2293,8 @@ bool zTest(int varIndex, double& z) {
   z = abs(z_i_1 - z_i_2) / sqrt((1/(g1_n - 3) + 1 / (g2_n - 3)));
 
   if(std::isinf(z) || std::isnan(z)) {
+    // called from the parallel dcGAIN/dmGAIN diagonal loops
+    #pragma omp critical
     PP->printLOG("WARNING: Infinite or NaN in Z-test zTest() for variable index " + 
       int2str(varIndex) + "\n");
     return false;
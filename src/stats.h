@@ -14,6 +14,7 @@
 #include <string>
 #include <vector>
 #include <cstdio>
+#include <cmath>
 
 #include "plink.h"
 #include "model.h"
@@ -119,6 +120,21 @@ bool realnum(double);
 
 long double factorial(int);
 double normdist(double);
+
+// normal tail probability P(Z > |z|) for absZ = |z|, the polynomial
+// approximation used by normdist(); inline and branch-free so vectorized
+// loops can call it
+inline double normdistTail(double absZ) {
+  double t0 = 1 / (1 + 0.2316419 * absZ);
+  double z1 = exp(-0.5 * absZ * absZ) / 2.50662827463;
+  return z1 * t0
+          * (0.31938153 +
+          t0 * (-0.356563782 +
+          t0 * (1.781477937 +
+          t0 * (-1.821255978 +
+          1.330274429 * t0))));
+}
+
 double ltqnorm(double);
 double chi2x2(double, double, double, double);
 double chi2x2(table_t);